@@ -2,6 +2,8 @@
 
 option(ENABLE_BUILD_EXEC "Should build udp-relay as executable" ON)
 option(ENABLE_BUILD_TEST "Should build test functionality" ON)
+option(ENABLE_BUILD_MICROBENCH "Should build microbenchmarks, requires ENABLE_BUILD_TEST" OFF)
+option(ENABLE_XDP_FASTPATH "Build in-kernel xdp fast path for established channels (linux, requires clang and libbpf)" OFF)
 
 option(ENABLE_SANITIZER_ADDRESS "Enable address sanitizer" OFF)
 option(ENABLE_SANITIZER_LEAK "Enable leak sanitizer" OFF)
@@ -22,4 +22,12 @@ check_cxx_source_compiles("
 #error feature not available
 #endif
 int main() { std::cout << std::stacktrace::current() << std::endl;}
-" HAS_CPP_LIB_STACKTRACE)
\ No newline at end of file
+" HAS_CPP_LIB_STACKTRACE)
+
+check_cxx_source_compiles("
+#include <linux/io_uring.h>
+#if !defined(IORING_RECV_MULTISHOT) || !defined(IORING_CQE_BUFFER_SHIFT)
+#error io_uring headers too old
+#endif
+int main() { io_uring_buf_reg reg{}; io_uring_recvmsg_out out{}; return IORING_REGISTER_PBUF_RING + reg.bgid + out.namelen; }
+" HAS_LINUX_IO_URING)
@@ -0,0 +1,82 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include "udp-relay/net/socket_address.hxx"
+#include "udp-relay/net/udpsocket.hxx"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace ur
+{
+	// trace of received datagrams in memory-mapped pcap file reused as ring. Datagrams are stored as raw ip/udp packets
+	// (LINKTYPE_RAW) with source address, original size and first snap length bytes of payload.
+	// File is split in blocks every one starting with record, once file is full the oldest block is overwritten whole.
+	// Block tail that doesn't fit next record is taken by filler record with zero timestamp, unwritten tail is zeroed.
+	class capture_ring final
+	{
+	public:
+		static constexpr uint32_t blockSize = 64 * 1024;
+
+		// pcap global header preceding first block
+		static constexpr uint32_t fileHeaderSize = 24;
+
+		capture_ring() = default;
+		capture_ring(const capture_ring&) = delete;
+		capture_ring& operator=(const capture_ring&) = delete;
+		~capture_ring() noexcept;
+
+		// create or truncate file of size rounded down to whole blocks, recording 1 of sampleEvery datagrams
+		bool open(const std::string& path, uint64_t size, uint32_t snapLength, uint32_t sampleEvery, uint16_t localPort);
+
+		void close() noexcept;
+
+		bool isOpen() const noexcept { return m_data != nullptr; }
+
+		// record sampled datagrams of received batch, GRO runs segment by segment
+		void write(std::span<const net::datagram> datagrams) noexcept;
+
+		uint64_t getCaptured() const noexcept { return m_captured; }
+
+	private:
+		void writeRecord(const net::socket_address& from, const std::byte* data, uint32_t bytes, int64_t timestampNs) noexcept;
+
+		// fill rest of current block and move to next one, wrapping to first block at the end of file
+		void nextBlock() noexcept;
+
+		std::byte* m_data{};
+
+		std::size_t m_size{};
+
+		std::size_t m_offset{}; // where next record goes
+
+		std::size_t m_blockEnd{};
+
+		uint32_t m_snapLength{};
+
+		uint32_t m_sampleEvery{1};
+
+		uint32_t m_sampleCounter{};
+
+		uint16_t m_localPort{};
+
+		uint64_t m_captured{};
+	};
+
+	// udp datagram read back from capture
+	struct capture_record
+	{
+		int64_t m_timestampNs{}; // since unix epoch
+		net::socket_address m_source{};
+		uint16_t m_destPort{};
+		uint32_t m_size{};				 // original payload size
+		std::vector<std::byte> m_payload{}; // captured payload prefix
+	};
+
+	// read udp datagrams of pcap file with raw ip or ethernet link type, sorted by time. Return false if file isn't readable pcap
+	bool read_capture(const std::string& path, std::vector<capture_record>& records);
+} // namespace ur
@@ -0,0 +1,150 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include "udp-relay/guid.hxx"
+#include "udp-relay/net/socket_address.hxx"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace ur
+{
+	struct channel_stats
+	{
+		uint64_t m_bytesReceived{};
+		uint64_t m_bytesSent{};
+
+		uint32_t m_packetsReceived{};
+		uint32_t m_packetsSent{};
+
+		uint32_t m_packetsCoalesced{}; // packets received within GRO runs
+		uint32_t m_coalescedSends{};	  // GSO sends, each carrying run of packets
+
+		uint64_t m_bytesInKernel{};	  // forwarded by xdp fast path, not included in received & sent
+		uint32_t m_packetsInKernel{}; // forwarded by xdp fast path, not included in received & sent
+
+		uint32_t m_packetsQueued{};		   // waited in egress queue for socket send buffer
+		uint32_t m_packetsQueueDropped{}; // egress queue had no room for
+
+		uint32_t m_fanoutCopies{}; // sends beyond first one made for datagrams of group channel
+	};
+
+	// part of channel relaying datagram reads and writes, fits exactly one cache line
+	struct alignas(64) channel
+	{
+		// bytes counted in single delta before it's folded into channel_info, well below uint32_t overflow
+		static constexpr uint32_t foldThreshold = 1U << 31;
+
+		uint32_t m_generation{}; // odd while channel is open, bumped on open & close
+		uint32_t m_lastUpdated{}; // relay tick in ms, compare with unsigned subtraction. Next free slot while channel is closed
+		net::socket_address m_peerA{};
+		net::socket_address m_peerB{};
+
+		// traffic since last channel_arena::foldCounters()
+		uint32_t m_packetsReceived{};
+		uint32_t m_bytesReceived{};
+		uint32_t m_packetsSent{};
+		uint32_t m_bytesSent{};
+	};
+	static_assert(sizeof(channel) == 64);
+
+	// rarely accessed part of channel, kept apart from forwarding data
+	struct channel_info
+	{
+		guid m_guid{};
+		channel_stats m_stats{};
+		uint16_t m_relayPort{}; // dedicated port allocated to channel, 0 if none
+		uint32_t m_group{UINT32_MAX}; // group_pool index once third peer joined, UINT32_MAX while channel is pair
+	};
+
+	// reference to channel in channel_arena, valid until channel is released
+	struct channel_handle
+	{
+		uint32_t m_index{};
+		uint32_t m_generation{};
+
+		bool operator==(const channel_handle&) const = default;
+	};
+
+	// fixed-address channel storage grown by slabs. Opening & closing channels reuses slots through intrusive free list,
+	// allocator is used only when all slabs are full. Channels and infos live in separate arrays of each slab.
+	class channel_arena final
+	{
+	public:
+		channel_arena() noexcept = default;
+
+		channel_arena(const channel_arena&) = delete;
+		channel_arena& operator=(const channel_arena&) = delete;
+
+		~channel_arena() noexcept;
+
+		// back channels with huge pages when system allows it, using slabs that fill single 2MB page. Linux only.
+		// Ignored once arena has slabs.
+		void setHugePages(bool useHugePages) noexcept;
+
+		// take free slot, adding slab if none left. Slot is zeroed except generation. Return nullopt if slab allocation failed
+		std::optional<channel_handle> allocate() noexcept;
+
+		// return channel slot to free list, invalidating handles to it
+		void release(channel_handle handle) noexcept;
+
+		// channel handle refers to or nullptr if it was released since
+		channel* resolve(channel_handle handle) noexcept
+		{
+			channel& ch = at(handle.m_index);
+			return ch.m_generation == handle.m_generation ? &ch : nullptr;
+		}
+
+		channel& at(uint32_t index) noexcept
+		{
+			return m_slabs[index >> m_slabShift].m_channels[index & slabMask()];
+		}
+
+		channel_info& infoAt(uint32_t index) noexcept
+		{
+			return m_slabs[index >> m_slabShift].m_infos[index & slabMask()];
+		}
+
+		// true if slot holds open channel
+		bool isOpen(uint32_t index) noexcept { return at(index).m_generation & 1; }
+
+		// move traffic counters of channel into its info
+		void foldCounters(uint32_t index) noexcept;
+
+		// amount of slots, including free ones
+		uint32_t capacity() const noexcept { return static_cast<uint32_t>(m_slabs.size()) << m_slabShift; }
+
+		// amount of open channels
+		uint32_t size() const noexcept { return m_size; }
+
+		// memory taken by all slabs
+		size_t reservedBytes() const noexcept;
+
+		// release every channel and slab
+		void clear() noexcept;
+
+	private:
+		struct slab
+		{
+			channel* m_channels{};
+			channel_info* m_infos{};
+		};
+
+		uint32_t slabMask() const noexcept { return (1U << m_slabShift) - 1; }
+
+		bool addSlab() noexcept;
+
+		std::vector<slab> m_slabs{};
+
+		uint32_t m_freeHead{UINT32_MAX};
+
+		uint32_t m_size{};
+
+		uint32_t m_slabShift{12}; // channels per slab, log2
+
+		bool m_useHugePages{};
+	};
+} // namespace ur
@@ -0,0 +1,58 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include "udp-relay/net/socket_address.hxx"
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace ur
+{
+	// members of group channel beyond channel::m_peerA & m_peerB, kept inline in fixed-size block
+	struct channel_group
+	{
+		static constexpr uint32_t maxSize = 16; // members including m_peerA & m_peerB
+
+		std::array<net::socket_address, maxSize - 2> m_members{};
+		uint32_t m_count{};
+		uint32_t m_nextFree{}; // next free group while this one is free
+
+		std::span<const net::socket_address> members() const noexcept { return {m_members.data(), m_count}; }
+
+		bool contains(const net::socket_address& addr) const noexcept;
+	};
+
+	// group blocks reused through free list. Addressed by index, as storage grows when all blocks are taken
+	class group_pool final
+	{
+	public:
+		static constexpr uint32_t none = UINT32_MAX;
+
+		group_pool() noexcept = default;
+		group_pool(const group_pool&) = delete;
+		group_pool& operator=(const group_pool&) = delete;
+
+		// take empty group, growing storage if none is free
+		uint32_t allocate();
+
+		void release(uint32_t index) noexcept;
+
+		channel_group& at(uint32_t index) noexcept { return m_groups[index]; }
+
+		// groups taken now
+		uint32_t size() const noexcept { return m_size; }
+
+		// release every group and storage
+		void clear() noexcept;
+
+	private:
+		std::vector<channel_group> m_groups{};
+
+		uint32_t m_freeHead{none};
+
+		uint32_t m_size{};
+	};
+} // namespace ur
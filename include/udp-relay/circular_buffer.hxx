@@ -2,6 +2,8 @@
 
 #include <algorithm>
 #include <array>
+#include <cstddef>
+#include <utility>
 
 namespace ur
 {
@@ -28,15 +30,16 @@ namespace ur
 
 		std::size_t size() const { return Size; }
 
+		// overwrite oldest value
 		void assign(Value v)
 		{
-			*m_it = v;
-			if (++m_it == end())
-				m_it = begin();
+			m_c[m_next] = std::move(v);
+			if (++m_next == Size)
+				m_next = 0;
 		}
 
 	private:
 		container m_c{};
-		iterator m_it{begin()};
+		std::size_t m_next{}; // index rather than iterator, so buffer stays valid once copied or moved
 	};
 } // namespace ur
\ No newline at end of file
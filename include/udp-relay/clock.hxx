@@ -0,0 +1,37 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include <chrono>
+
+namespace ur
+{
+	// time source of relay, read once per loop iteration
+	class clock_source
+	{
+	public:
+		virtual ~clock_source() = default;
+
+		virtual std::chrono::steady_clock::time_point now() const noexcept = 0;
+	};
+
+	class steady_clock_source final : public clock_source
+	{
+	public:
+		std::chrono::steady_clock::time_point now() const noexcept override { return std::chrono::steady_clock::now(); }
+	};
+
+	// clock that moves only when told to, so hours of channel activity & expiry can be simulated in seconds
+	class virtual_clock final : public clock_source
+	{
+	public:
+		std::chrono::steady_clock::time_point now() const noexcept override { return m_now; }
+
+		void advance(std::chrono::steady_clock::duration by) noexcept { m_now += by; }
+
+		void set(std::chrono::steady_clock::time_point time) noexcept { m_now = time; }
+
+	private:
+		std::chrono::steady_clock::time_point m_now{};
+	};
+} // namespace ur
@@ -0,0 +1,119 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include "udp-relay/net/socket_address.hxx"
+#include "udp-relay/net/udpsocket.hxx"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace ur
+{
+	// what to drop when channel queue or whole pool is full
+	enum class egress_drop_policy : uint8_t
+	{
+		Tail,	// datagram being queued
+		Oldest, // oldest datagram of the same channel, making room for new one
+	};
+
+	enum class egress_push : uint8_t
+	{
+		Queued,
+		QueuedDroppedOldest,
+		Dropped,
+	};
+
+	// forwarded datagrams socket couldn't take as its send buffer was full, kept until socket becomes writable.
+	// Payloads are copied into fixed-size buffers of pool that grows by chunks up to capacity and recycles them through free list.
+	// Every channel has own bounded FIFO, channels with queued datagrams take turns when queue is drained.
+	class egress_queue final
+	{
+	public:
+		static constexpr std::size_t maxDatagramSize = 1472;
+
+		static constexpr uint32_t chunkSize = 256; // buffers added to pool at once
+
+		egress_queue() noexcept = default;
+		egress_queue(const egress_queue&) = delete;
+		egress_queue& operator=(const egress_queue&) = delete;
+
+		// drop everything and set limits. capacity of 0 disables queue
+		void init(uint32_t capacity, uint32_t channelLimit, egress_drop_policy policy);
+
+		// copy datagram into queue of channel, dropping one if channel or pool is full
+		egress_push push(uint32_t channel, const net::socket_address& to, const void* data, uint32_t bytes, int64_t rxTimestamp);
+
+		// point datagrams at queued ones, with channel of each in channels. Every channel gives its oldest datagrams and
+		// no more than its share of batch, starting with channel after the one that started previous peek.
+		// Queue must not be modified until consume(). Return amount of datagrams filled
+		std::size_t peek(std::span<net::datagram> datagrams, std::span<uint32_t> channels) noexcept;
+
+		// release datagrams returned by last peek(), channels being prefix of ones it returned
+		void consume(std::span<const uint32_t> channels) noexcept;
+
+		// drop every datagram queued for channel. Return how many were dropped
+		uint32_t purge(uint32_t channel) noexcept;
+
+		bool isEnabled() const noexcept { return m_capacity != 0; }
+
+		bool empty() const noexcept { return m_size == 0; }
+
+		// datagrams queued over all channels
+		uint32_t size() const noexcept { return m_size; }
+
+		// buffers taken from allocator so far, never shrinks until init()
+		uint32_t poolSize() const noexcept { return m_allocated; }
+
+	private:
+		static constexpr uint32_t none = UINT32_MAX;
+
+		struct entry
+		{
+			net::socket_address m_addr{};
+			int64_t m_rxTimestamp{};
+			uint32_t m_next{none}; // next datagram of the same channel, or next free buffer
+			uint32_t m_bytes{};
+			std::array<std::byte, maxDatagramSize> m_data;
+		};
+
+		struct channel_queue
+		{
+			uint32_t m_head{none};
+			uint32_t m_tail{none};
+			uint32_t m_count{};
+			uint32_t m_activeIndex{}; // position in m_active while m_count is non-zero
+		};
+
+		entry& at(uint32_t index) noexcept { return m_chunks[index / chunkSize][index % chunkSize]; }
+
+		// take buffer from free list or allocator. Return none if pool is at capacity
+		uint32_t allocate();
+
+		void popHead(uint32_t channel) noexcept;
+
+		std::vector<std::unique_ptr<entry[]>> m_chunks{};
+
+		std::vector<channel_queue> m_channels{}; // indexed by channel, grown on demand
+
+		std::vector<uint32_t> m_active{}; // channels with queued datagrams
+
+		uint32_t m_freeHead{none};
+
+		uint32_t m_allocated{};
+
+		uint32_t m_size{};
+
+		uint32_t m_capacity{};
+
+		uint32_t m_channelLimit{};
+
+		uint32_t m_cursor{}; // position in m_active next peek starts at
+
+		egress_drop_policy m_policy{};
+	};
+} // namespace ur
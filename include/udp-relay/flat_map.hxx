@@ -0,0 +1,366 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define UR_FLAT_MAP_SSE2 1
+#else
+#define UR_FLAT_MAP_SSE2 0
+#endif
+
+namespace ur
+{
+	// open-addressing hash map with entries stored inline in single array.
+	// Each entry has control byte with 7 bits of its hash, lookup compares 16 control bytes at once and touches entries only on hash match.
+	// Unlike std::unordered_map, growing rehashes entries in place: check willRehash() before inserting while holding references or iterators.
+	template <typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+	class flat_map
+	{
+		static constexpr std::size_t groupWidth = 16;
+
+		static constexpr int8_t ctrlEmpty = -128;
+		static constexpr int8_t ctrlDeleted = -2;
+
+		template <bool IsConst>
+		class iterator_base;
+
+	public:
+		using key_type = Key;
+		using mapped_type = Value;
+		using value_type = std::pair<const Key, Value>;
+		using size_type = std::size_t;
+		using iterator = iterator_base<false>;
+		using const_iterator = iterator_base<true>;
+
+		flat_map() noexcept = default;
+
+		flat_map(const flat_map&) = delete;
+		flat_map& operator=(const flat_map&) = delete;
+
+		flat_map(flat_map&& other) noexcept { swap(other); }
+		flat_map& operator=(flat_map&& other) noexcept
+		{
+			flat_map(std::move(other)).swap(*this);
+			return *this;
+		}
+
+		~flat_map() { release(); }
+
+		iterator begin() noexcept { return iterator(this, nextFull(0)); }
+		iterator end() noexcept { return iterator(this, m_capacity); }
+		const_iterator begin() const noexcept { return const_iterator(this, nextFull(0)); }
+		const_iterator end() const noexcept { return const_iterator(this, m_capacity); }
+
+		size_type size() const noexcept { return m_size; }
+		bool empty() const noexcept { return m_size == 0; }
+		size_type capacity() const noexcept { return m_capacity; }
+
+		// true if inserting new key would rehash and invalidate references & iterators
+		bool willRehash() const noexcept { return m_size + m_deleted + 1 > maxLoad(m_capacity); }
+
+		void clear() noexcept
+		{
+			destroyAll();
+			std::fill_n(m_ctrl.get(), m_capacity, ctrlEmpty);
+			m_size = 0;
+			m_deleted = 0;
+		}
+
+		// make room for count entries without rehashing
+		void reserve(size_type count)
+		{
+			size_type newCapacity = groupWidth;
+			while (maxLoad(newCapacity) < count)
+				newCapacity *= 2;
+			if (newCapacity > m_capacity)
+				rehash(newCapacity);
+		}
+
+		iterator find(const Key& key) noexcept { return iterator(this, findIndex(key)); }
+		const_iterator find(const Key& key) const noexcept { return const_iterator(this, findIndex(key)); }
+
+		bool contains(const Key& key) const noexcept { return findIndex(key) != m_capacity; }
+
+		template <typename... Args>
+		std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args)
+		{
+			const std::size_t hash = Hash{}(key);
+			if (const size_type index = findIndex(key, hash); index != m_capacity)
+				return {iterator(this, index), false};
+
+			const size_type index = prepareInsert(hash);
+			std::construct_at(&m_slots[index], std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+			return {iterator(this, index), true};
+		}
+
+		template <typename M>
+		std::pair<iterator, bool> insert_or_assign(const Key& key, M&& value)
+		{
+			auto result = try_emplace(key, std::forward<M>(value));
+			if (!result.second)
+				result.first->second = std::forward<M>(value);
+			return result;
+		}
+
+		Value& operator[](const Key& key) { return try_emplace(key).first->second; }
+
+		void erase(iterator it) noexcept { eraseIndex(it.m_index); }
+
+		size_type erase(const Key& key) noexcept
+		{
+			const size_type index = findIndex(key);
+			if (index == m_capacity)
+				return 0;
+			eraseIndex(index);
+			return 1;
+		}
+
+		// erase every entry pred returns true for. Return amount erased
+		template <typename Pred>
+		friend size_type erase_if(flat_map& map, Pred pred)
+		{
+			size_type erased = 0;
+			for (size_type i = map.nextFull(0); i < map.m_capacity; i = map.nextFull(i + 1))
+			{
+				if (pred(std::as_const(map.m_slots[i])))
+				{
+					map.eraseIndex(i);
+					++erased;
+				}
+			}
+			return erased;
+		}
+
+		void swap(flat_map& other) noexcept
+		{
+			std::swap(m_ctrl, other.m_ctrl);
+			std::swap(m_slots, other.m_slots);
+			std::swap(m_capacity, other.m_capacity);
+			std::swap(m_size, other.m_size);
+			std::swap(m_deleted, other.m_deleted);
+		}
+
+	private:
+		template <bool IsConst>
+		class iterator_base
+		{
+			using map_type = std::conditional_t<IsConst, const flat_map, flat_map>;
+
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = flat_map::value_type;
+			using difference_type = std::ptrdiff_t;
+			using reference = std::conditional_t<IsConst, const value_type&, value_type&>;
+			using pointer = std::conditional_t<IsConst, const value_type*, value_type*>;
+
+			iterator_base() noexcept = default;
+			iterator_base(map_type* map, size_type index) noexcept
+				: m_map{map}
+				, m_index{index}
+			{
+			}
+
+			operator iterator_base<true>() const noexcept
+				requires(!IsConst)
+			{
+				return iterator_base<true>(m_map, m_index);
+			}
+
+			reference operator*() const noexcept { return m_map->m_slots[m_index]; }
+			pointer operator->() const noexcept { return &m_map->m_slots[m_index]; }
+
+			iterator_base& operator++() noexcept
+			{
+				m_index = m_map->nextFull(m_index + 1);
+				return *this;
+			}
+
+			iterator_base operator++(int) noexcept
+			{
+				iterator_base prev = *this;
+				++*this;
+				return prev;
+			}
+
+			bool operator==(const iterator_base& other) const noexcept { return m_index == other.m_index; }
+
+		private:
+			friend class flat_map;
+
+			map_type* m_map{};
+			size_type m_index{};
+		};
+
+		// keep at least 1/8 of entries empty, so lookups of missing keys end quickly
+		static constexpr size_type maxLoad(size_type capacity) noexcept { return capacity - capacity / 8; }
+
+		static int8_t hashTag(std::size_t hash) noexcept { return static_cast<int8_t>(hash & 0x7F); }
+
+		// bit mask of control bytes in group equal to value
+		static uint32_t matchGroup(const int8_t* group, int8_t value) noexcept
+		{
+#if UR_FLAT_MAP_SSE2
+			const __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+			return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(value))));
+#else
+			uint32_t mask = 0;
+			for (std::size_t i = 0; i < groupWidth; ++i)
+				mask |= uint32_t(group[i] == value) << i;
+			return mask;
+#endif
+		}
+
+		// bit mask of empty or deleted control bytes in group
+		static uint32_t matchFree(const int8_t* group) noexcept
+		{
+#if UR_FLAT_MAP_SSE2
+			return static_cast<uint32_t>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(group))));
+#else
+			uint32_t mask = 0;
+			for (std::size_t i = 0; i < groupWidth; ++i)
+				mask |= uint32_t(group[i] < 0) << i;
+			return mask;
+#endif
+		}
+
+		size_type groupMask() const noexcept { return m_capacity / groupWidth - 1; }
+
+		size_type findIndex(const Key& key) const noexcept { return m_capacity ? findIndex(key, Hash{}(key)) : m_capacity; }
+
+		// index of key or m_capacity if not found
+		size_type findIndex(const Key& key, std::size_t hash) const noexcept
+		{
+			if (m_capacity == 0)
+				return m_capacity;
+
+			const int8_t tag = hashTag(hash);
+			size_type group = (hash >> 7) & groupMask();
+			// triangular probing visits every group once when group count is power of 2
+			for (size_type probe = 1; probe <= groupMask() + 1; ++probe)
+			{
+				const int8_t* ctrl = &m_ctrl[group * groupWidth];
+				for (uint32_t mask = matchGroup(ctrl, tag); mask; mask &= mask - 1)
+				{
+					const size_type index = group * groupWidth + std::countr_zero(mask);
+					if (KeyEqual{}(m_slots[index].first, key)) [[likely]]
+						return index;
+				}
+
+				if (matchGroup(ctrl, ctrlEmpty))
+					break;
+
+				group = (group + probe) & groupMask();
+			}
+			return m_capacity;
+		}
+
+		// grow if needed and claim free slot for new entry with hash
+		size_type prepareInsert(std::size_t hash)
+		{
+			if (willRehash())
+				rehash(m_size + 1 > maxLoad(m_capacity) / 2 ? std::max(m_capacity * 2, groupWidth) : m_capacity);
+
+			const size_type index = findFree(hash);
+			if (m_ctrl[index] == ctrlDeleted)
+				--m_deleted;
+			m_ctrl[index] = hashTag(hash);
+			++m_size;
+			return index;
+		}
+
+		size_type findFree(std::size_t hash) const noexcept
+		{
+			size_type group = (hash >> 7) & groupMask();
+			for (size_type probe = 1;; ++probe)
+			{
+				if (const uint32_t mask = matchFree(&m_ctrl[group * groupWidth]))
+					return group * groupWidth + std::countr_zero(mask);
+				group = (group + probe) & groupMask();
+			}
+		}
+
+		void eraseIndex(size_type index) noexcept
+		{
+			std::destroy_at(&m_slots[index]);
+			--m_size;
+
+			// lookups stop at group with empty entry anyway, tombstone needed only when group was full
+			const int8_t* group = &m_ctrl[index / groupWidth * groupWidth];
+			if (matchGroup(group, ctrlEmpty))
+			{
+				m_ctrl[index] = ctrlEmpty;
+			}
+			else
+			{
+				m_ctrl[index] = ctrlDeleted;
+				++m_deleted;
+			}
+		}
+
+		size_type nextFull(size_type index) const noexcept
+		{
+			while (index < m_capacity && m_ctrl[index] < 0)
+				++index;
+			return index;
+		}
+
+		void rehash(size_type newCapacity)
+		{
+			flat_map newMap{};
+			newMap.m_ctrl = std::make_unique_for_overwrite<int8_t[]>(newCapacity);
+			std::fill_n(newMap.m_ctrl.get(), newCapacity, ctrlEmpty);
+			newMap.m_slots = std::allocator<value_type>{}.allocate(newCapacity);
+			newMap.m_capacity = newCapacity;
+
+			for (size_type i = nextFull(0); i < m_capacity; i = nextFull(i + 1))
+			{
+				const std::size_t hash = Hash{}(m_slots[i].first);
+				const size_type index = newMap.findFree(hash);
+				newMap.m_ctrl[index] = hashTag(hash);
+				std::construct_at(&newMap.m_slots[index], std::move(m_slots[i]));
+				++newMap.m_size;
+			}
+
+			swap(newMap);
+		}
+
+		void destroyAll() noexcept
+		{
+			for (size_type i = nextFull(0); i < m_capacity; i = nextFull(i + 1))
+				std::destroy_at(&m_slots[i]);
+		}
+
+		void release() noexcept
+		{
+			destroyAll();
+			if (m_slots)
+				std::allocator<value_type>{}.deallocate(m_slots, m_capacity);
+			m_slots = nullptr;
+			m_ctrl.reset();
+			m_capacity = 0;
+			m_size = 0;
+			m_deleted = 0;
+		}
+
+		std::unique_ptr<int8_t[]> m_ctrl{}; // control byte per entry: empty, deleted or 7 bits of entry hash
+
+		value_type* m_slots{};
+
+		size_type m_capacity{}; // power of 2, multiple of groupWidth
+
+		size_type m_size{};
+
+		size_type m_deleted{};
+	};
+} // namespace ur
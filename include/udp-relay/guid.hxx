@@ -4,6 +4,7 @@
 
 #include "net/network_utils.hxx"
 
+#include "hash.hxx"
 #include "utils.hxx"
 
 #include <cstdint>
@@ -68,7 +69,10 @@ namespace std
 	{
 		std::size_t operator()(const guid& g) const noexcept
 		{
-			return std::hash<std::string_view>{}(std::string_view(reinterpret_cast<const char*>(&g), sizeof(g)));
+			// guids come from peers, mix them with seed so colliding ones can't be crafted
+			const uint64_t high = (uint64_t(g.m_a) << 32) | g.m_b;
+			const uint64_t low = (uint64_t(g.m_c) << 32) | g.m_d;
+			return static_cast<std::size_t>(ur::hash_mix(high ^ ur::hash_seed(), low));
 		}
 	};
 
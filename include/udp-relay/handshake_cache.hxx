@@ -0,0 +1,56 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include "udp-relay/circular_buffer.hxx"
+#include "udp-relay/hmac.hxx"
+#include "udp-relay/net/socket_address.hxx"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ur
+{
+	// handshakes which passed HMAC validation recently, so identical packet resent by same address skips it.
+	// Whole packet is compared, hence only packets up to maxPacketSize are cached. Sets of few entries each,
+	// the oldest entry of set is replaced on insert.
+	class handshake_cache final
+	{
+	public:
+		static constexpr size_t maxPacketSize = 128;
+		static constexpr size_t ways = 4;
+
+		// hold at least entries, rounded up to power of two. Zero disables cache
+		void init(size_t entries);
+
+		bool isEnabled() const noexcept { return !m_sets.empty(); }
+
+		// true if packet of such size could be cached
+		bool canCache(size_t size) const noexcept { return isEnabled() && size <= maxPacketSize; }
+
+		// true if exactly same packet from same address was inserted before
+		bool contains(const net::socket_address& addr, const hmac_sha256& mac, const void* packet, size_t size) const noexcept;
+
+		// remember packet that passed validation. Ignored if packet can't be cached
+		void insert(const net::socket_address& addr, const hmac_sha256& mac, const void* packet, size_t size) noexcept;
+
+		// amount of entries cache can hold
+		size_t capacity() const noexcept { return m_sets.size() * ways; }
+
+	private:
+		struct entry
+		{
+			net::socket_address m_addr{};
+			uint16_t m_size{}; // zero while entry is empty
+			std::array<std::byte, maxPacketSize> m_packet{};
+		};
+
+		using set = circular_buffer<entry, ways>;
+
+		size_t setIndex(const net::socket_address& addr, const hmac_sha256& mac) const noexcept;
+
+		std::vector<set> m_sets{};
+	};
+} // namespace ur
@@ -0,0 +1,59 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include "udp-relay/net/socket_address.hxx"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ur
+{
+	// handshake admission per source address and its prefix (/24 for ipv4, /64 for ipv6). Token buckets of all sources
+	// are approximated by count-min sketch, so memory stays the same whatever amount of sources sends handshakes.
+	// Sources sharing sketch cells might be limited earlier than configured, never later.
+	class handshake_limiter final
+	{
+	public:
+		static constexpr uint32_t depth = 4;
+		static constexpr uint32_t width = 4096;
+
+		// rates are handshakes per second, each source may burst up to burstSeconds of its rate. Zero disables limit
+		void init(uint32_t addressRate, uint32_t prefixRate, uint32_t nowMs);
+
+		bool isEnabled() const noexcept { return m_addressCost || m_prefixCost; }
+
+		// charge handshake to source, false if it must be shed. Shed handshake isn't charged
+		bool admit(const net::socket_address& addr, uint32_t nowMs) noexcept;
+
+	private:
+		static constexpr uint32_t unitsPerSecond = 1U << 16; // bucket debt is measured in 1/65536 of second
+		static constexpr uint32_t burstSeconds = 2;
+		static constexpr uint32_t capacity = unitsPerSecond * burstSeconds;
+		static constexpr uint32_t leakIntervalMs = 32;
+
+		using cells = std::array<uint32_t*, depth>;
+
+		// sketch cells of key, one per row, and smallest of their values
+		uint32_t locate(uint64_t key, cells& outCells) noexcept;
+
+		// pay off debt for time passed since last leak
+		void leak(uint32_t nowMs) noexcept;
+
+		uint64_t prefixKey(const net::socket_address& addr) const noexcept;
+
+		std::vector<uint32_t> m_sketch{}; // depth rows of width cells
+
+		std::array<uint64_t, depth> m_rowSeeds{};
+
+		uint64_t m_seed{}; // random per process, mixed into keys
+
+		uint32_t m_addressCost{};
+
+		uint32_t m_prefixCost{};
+
+		uint32_t m_lastLeakMs{};
+	};
+} // namespace ur
@@ -0,0 +1,39 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include <cstdint>
+#include <random>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace ur
+{
+	// mix two 64-bit words into well distributed hash with single wide multiplication
+	inline uint64_t hash_mix(uint64_t a, uint64_t b) noexcept
+	{
+		a ^= 0xA0761D6478BD642FULL;
+		b ^= 0xE7037ED1A0B428DBULL;
+#if defined(__SIZEOF_INT128__)
+		const __uint128_t product = static_cast<__uint128_t>(a) * b;
+		return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+#else
+		uint64_t high{};
+		const uint64_t low = _umul128(a, b, &high);
+		return low ^ high;
+#endif
+	}
+
+	// random per process, for hashing values peers choose, so they can't precompute colliding ones
+	inline uint64_t hash_seed() noexcept
+	{
+		static const uint64_t seed = []
+		{
+			std::random_device rd;
+			return (uint64_t(rd()) << 32) | rd();
+		}();
+		return seed;
+	}
+} // namespace ur
@@ -0,0 +1,74 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <vector>
+
+struct evp_mac_ctx_st; // EVP_MAC_CTX
+
+namespace ur
+{
+	using hmac_sha256 = std::array<std::byte, 32>;
+	using secret_key = std::vector<std::byte>;
+
+	// HMAC_sha256 with key schedule computed once on init. Each message only restores prepared inner & outer digest states,
+	// instead of hashing key again. Not thread safe, every thread needs own verifier.
+	class hmac_verifier final
+	{
+	public:
+		hmac_verifier() noexcept = default;
+
+		hmac_verifier(const hmac_verifier&) = delete;
+		hmac_verifier& operator=(const hmac_verifier&) = delete;
+
+		hmac_verifier(hmac_verifier&& other) noexcept;
+		hmac_verifier& operator=(hmac_verifier&& other) noexcept;
+
+		~hmac_verifier() noexcept;
+
+		// prepare key schedule. Empty key leaves verifier without key, so every message is accepted
+		bool init(const secret_key& key) noexcept;
+
+		// true if verifier was initialized with non-empty key
+		bool hasKey() const noexcept { return m_ctx != nullptr; }
+
+		// mac of data, as if hmac_sha256 sized field at macOffset was zero'd. Data is not modified nor copied.
+		// Return false if field is out of data bounds or digest failed
+		bool compute(const void* data, size_t dataSize, size_t macOffset, hmac_sha256& outMac) noexcept;
+
+		// compare mac of data (computed same as above) against expected one in constant time
+		bool verify(const void* data, size_t dataSize, size_t macOffset, const hmac_sha256& expected) noexcept;
+
+	private:
+		void reset() noexcept;
+
+		evp_mac_ctx_st* m_ctx{}; // keyed, reinitialized for each message
+	};
+} // namespace ur
+
+namespace std
+{
+	template <>
+	struct formatter<ur::hmac_sha256>
+	{
+	public:
+		constexpr auto parse(format_parse_context& ctx)
+		{
+			auto it = ctx.begin();
+			return it;
+		}
+
+		template <typename FormatContext>
+		auto format(const ur::hmac_sha256& v, FormatContext& ctx) const
+		{
+			auto it = ctx.out();
+			for (auto el : v)
+				it = std::format_to(ctx.out(), "{}", (uint8_t)el);
+			return it;
+		}
+	};
+} // namespace std
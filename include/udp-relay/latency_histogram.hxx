@@ -0,0 +1,54 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace ur
+{
+	// log-linear (HDR style) histogram of nanosecond durations. Every power of two range is split in subBuckets linear
+	// buckets, so values are kept with ~3% precision from 1ns up to maxValue with fixed memory and O(1) record.
+	class latency_histogram final
+	{
+	public:
+		static constexpr uint32_t subBucketBits = 5;
+		static constexpr uint32_t subBuckets = 1U << subBucketBits;
+		static constexpr uint32_t maxExponent = 40; // values above ~18 minutes are clamped
+		static constexpr uint64_t maxValue = (uint64_t(1) << (maxExponent + 1)) - 1;
+		static constexpr std::size_t bucketCount = (maxExponent - subBucketBits + 2) * subBuckets;
+
+		void record(uint64_t value) noexcept
+		{
+			++m_counts[indexOf(value)];
+			++m_count;
+			if (value > m_max)
+				m_max = value;
+		}
+
+		// add every value recorded by other
+		void merge(const latency_histogram& other) noexcept;
+
+		void reset() noexcept;
+
+		uint64_t count() const noexcept { return m_count; }
+
+		uint64_t max() const noexcept { return m_max; }
+
+		// highest value of bucket holding given percentile (0-100) of recorded values, 0 if empty
+		uint64_t percentile(double percent) const noexcept;
+
+		static std::size_t indexOf(uint64_t value) noexcept;
+
+		// highest value that falls into bucket
+		static uint64_t highestOf(std::size_t index) noexcept;
+
+	private:
+		std::array<uint64_t, bucketCount> m_counts{};
+
+		uint64_t m_count{};
+
+		uint64_t m_max{};
+	};
+} // namespace ur
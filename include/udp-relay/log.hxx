@@ -2,12 +2,20 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <chrono>
-#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <format>
-#include <iostream>
-#include <print>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 namespace ur
 {
@@ -50,21 +58,171 @@ namespace ur
 		}
 	}
 
+	// log message as queued by thread that logs it. Arguments are copied into payload and formatted later by logging thread
+	struct alignas(64) log_record
+	{
+		static constexpr std::size_t payloadCapacity = 208;
+
+		using format_fn = void (*)(const log_record& record, std::string& out);
+
+		format_fn m_format{};						  // appends message decoded from payload to out
+		std::string_view m_formatString{};			  // string literal
+		const char* m_category{};					  // string literal
+		std::chrono::system_clock::time_point m_time{};
+		uint16_t m_payloadSize{};
+		log_level m_level{};
+		std::array<std::byte, payloadCapacity> m_payload;
+	};
+	static_assert(sizeof(log_record) == 256);
+
+	// how argument of type T is kept in log_record payload. Trivially copyable values are copied as is
+	template <typename T>
+	struct log_arg
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "log argument must be trivially copyable or string");
+
+		using decoded = T;
+
+		static constexpr std::size_t fixedSize = sizeof(T);
+
+		static void encode(const T& value, std::byte*& it, std::size_t) noexcept
+		{
+			std::memcpy(it, &value, sizeof(T));
+			it += sizeof(T);
+		}
+
+		static decoded decode(const std::byte*& it) noexcept
+		{
+			T value;
+			std::memcpy(&value, it, sizeof(T));
+			it += sizeof(T);
+			return value;
+		}
+	};
+
+	// strings are copied as length & characters, truncated to space left in payload
+	struct log_string_arg
+	{
+		using decoded = std::string_view;
+
+		static constexpr std::size_t fixedSize = sizeof(uint16_t);
+
+		static void encode(std::string_view value, std::byte*& it, std::size_t available) noexcept
+		{
+			const uint16_t size = static_cast<uint16_t>(std::min(value.size(), available - fixedSize));
+			std::memcpy(it, &size, sizeof(size));
+			std::memcpy(it + sizeof(size), value.data(), size);
+			it += sizeof(size) + size;
+		}
+
+		static decoded decode(const std::byte*& it) noexcept
+		{
+			uint16_t size{};
+			std::memcpy(&size, it, sizeof(size));
+			const char* const data = reinterpret_cast<const char*>(it + sizeof(size));
+			it += sizeof(size) + size;
+			return std::string_view(data, size);
+		}
+	};
+
+	template <>
+	struct log_arg<std::string> : log_string_arg
+	{
+	};
+
+	template <>
+	struct log_arg<std::string_view> : log_string_arg
+	{
+	};
+
+	template <>
+	struct log_arg<const char*> : log_string_arg
+	{
+	};
+
+	template <>
+	struct log_arg<char*> : log_string_arg
+	{
+	};
+
+	template <typename... Args>
+	struct log_args
+	{
+		static constexpr std::array<std::size_t, sizeof...(Args) + 1> reserved = []
+		{
+			// payload bytes required by arguments following each one
+			std::array<std::size_t, sizeof...(Args) + 1> result{};
+			constexpr std::array<std::size_t, sizeof...(Args) + 1> sizes{log_arg<Args>::fixedSize..., 0};
+			for (std::size_t i = sizeof...(Args); i-- > 0;)
+				result[i] = result[i + 1] + sizes[i];
+			return result;
+		}();
+		static_assert(reserved[0] <= log_record::payloadCapacity, "log arguments don't fit into log_record");
+
+		static std::size_t encode(std::byte* payload, const Args&... args) noexcept
+		{
+			return encodeImpl(payload, std::index_sequence_for<Args...>{}, args...);
+		}
+
+		static void format(const log_record& record, std::string& out)
+		{
+			if constexpr (sizeof...(Args) == 0)
+			{
+				out += std::vformat(record.m_formatString, std::make_format_args());
+			}
+			else
+			{
+				const std::byte* it = record.m_payload.data();
+				std::tuple<typename log_arg<Args>::decoded...> values{log_arg<Args>::decode(it)...}; // braced init keeps left to right order
+				std::apply([&](auto&... value)
+					{ out += std::vformat(record.m_formatString, std::make_format_args(value...)); }, values);
+			}
+		}
+
+	private:
+		template <std::size_t... I>
+		static std::size_t encodeImpl(std::byte* payload, std::index_sequence<I...>, const Args&... args) noexcept
+		{
+			std::byte* it = payload;
+			const std::byte* const end = payload + log_record::payloadCapacity;
+			(log_arg<Args>::encode(args, it, static_cast<std::size_t>(end - it) - reserved[I + 1]), ...);
+			return static_cast<std::size_t>(it - payload);
+		}
+	};
+
+	// record slot of calling thread's queue, nullptr if queue is full and record has to be dropped
+	extern log_record* log_acquire() noexcept;
+
+	// queue record returned by log_acquire()
+	extern void log_commit() noexcept;
+
 	template <typename... Args>
 	static void log(const log_level level, const std::string_view category, const std::string_view format, const Args... args)
 	{
 		if (level > runtime_log_verbosity)
 			return;
 
-		const auto now = std::chrono::utc_clock::now();
-		const char* logLevelStr = log_level_to_string(level);
-		std::println(std::cout, "{0} {1}", std::vformat("[{0:%F}T{0:%T}] {1}: {2}:", std::make_format_args(now, category, logLevelStr)), std::vformat(format, std::make_format_args(args...)));
-	}
+		log_record* const record = log_acquire();
+		if (record == nullptr) [[unlikely]]
+			return;
 
-	static inline void log_flush()
-	{
-		std::cout.flush();
+		record->m_format = &log_args<Args...>::format;
+		record->m_formatString = format;
+		record->m_category = category.data();
+		record->m_time = std::chrono::system_clock::now();
+		record->m_level = level;
+		record->m_payloadSize = static_cast<uint16_t>(log_args<Args...>::encode(record->m_payload.data(), args...));
+		log_commit();
 	}
+
+	// ask logging thread to write out queued records and flush output. Doesn't wait for it
+	extern void log_flush() noexcept;
+
+	// write out every queued record and stop logging thread. Records logged afterwards start it again
+	extern void log_shutdown() noexcept;
+
+	// records dropped because queue of their thread was full
+	extern uint64_t log_dropped() noexcept;
 } // namespace ur
 
 #define LOG(level, category, format, ...)                            \
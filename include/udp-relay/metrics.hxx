@@ -0,0 +1,128 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ur
+{
+	// counters of single relay worker. Written only by worker itself with relaxed load & store, so updating them costs
+	// no more than plain increment. Readers (exporter) may see values of different moments, but each one is whole.
+	struct alignas(64) worker_metrics
+	{
+		static constexpr std::size_t batchBuckets = 7; // receive batch sizes up to 1, 2, 4 .. 64 datagrams
+
+		std::atomic<uint64_t> m_packetsIn{};
+		std::atomic<uint64_t> m_bytesIn{};
+		std::atomic<uint64_t> m_recvDropped{}; // dropped by kernel as receive buffer was full
+		std::atomic<uint64_t> m_packetsOut{};
+		std::atomic<uint64_t> m_bytesOut{};
+		std::atomic<uint64_t> m_sendFailures{}; // datagrams failed to send
+		std::atomic<uint64_t> m_sendEagain{};	// send calls stopped by full socket buffer
+		std::atomic<uint64_t> m_egressQueued{};
+		std::atomic<uint64_t> m_egressDropped{};
+		std::atomic<uint64_t> m_egressDepth{}; // gauge
+
+		std::atomic<uint64_t> m_handshakesValid{};
+		std::atomic<uint64_t> m_handshakesInvalid{}; // failed HMAC validation
+		std::atomic<uint64_t> m_handshakesShed{};
+
+		std::atomic<uint64_t> m_channelsPending{};	   // gauge, allocated and waiting for second peer
+		std::atomic<uint64_t> m_channelsEstablished{}; // gauge
+		std::atomic<uint64_t> m_channelsExpired{};
+		std::atomic<uint64_t> m_relayPorts{};		   // gauge, dedicated ports allocated to channels
+		std::atomic<uint64_t> m_relayPortsExhausted{}; // dedicated port requests refused as none was left
+
+		std::atomic<uint64_t> m_loopIterations{};
+		std::atomic<uint64_t> m_loopWorkNs{};  // loop time that received or forwarded datagrams, measured in busy latency modes
+		std::atomic<uint64_t> m_loopSpinNs{};  // loop time that found nothing without blocking
+		std::atomic<uint64_t> m_loopSleepNs{}; // loop time blocked waiting for socket
+		std::atomic<uint64_t> m_recvBatches{};
+		std::atomic<uint64_t> m_sendBatches{};
+		std::array<std::atomic<uint64_t>, batchBuckets> m_recvBatchSizes{}; // batches by size, not cumulative
+		std::atomic<uint64_t> m_recvBatchDatagrams{};						 // datagrams returned by those batches
+	};
+
+	// single writer update, no read-modify-write instruction needed
+	inline void metric_add(std::atomic<uint64_t>& metric, uint64_t value = 1) noexcept
+	{
+		metric.store(metric.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+
+	inline void metric_sub(std::atomic<uint64_t>& metric, uint64_t value = 1) noexcept
+	{
+		metric.store(metric.load(std::memory_order_relaxed) - value, std::memory_order_relaxed);
+	}
+
+	// histogram bucket of receive batch with count datagrams
+	inline std::size_t metric_batch_bucket(uint32_t count) noexcept
+	{
+		std::size_t bucket = 0;
+		while (bucket + 1 < worker_metrics::batchBuckets && (1U << bucket) < count)
+			++bucket;
+		return bucket;
+	}
+
+	struct metrics_header
+	{
+		static constexpr uint64_t magic = 0x5352544D454D5255; // "URMEMTRS"
+		static constexpr uint32_t version = 6;
+
+		uint64_t m_magic{};
+		uint32_t m_version{};
+		uint32_t m_workerSize{}; // sizeof(worker_metrics) of relay that created segment
+		uint32_t m_workers{};
+		uint16_t m_port{};
+		int64_t m_startTime{}; // unix seconds
+	};
+
+	// metrics of every worker of relay, kept in shared memory named after relay port so exporter can read it (linux).
+	// Elsewhere or when shared memory isn't available, segment is in private memory.
+	class metrics_segment final
+	{
+	public:
+		metrics_segment() noexcept = default;
+
+		metrics_segment(const metrics_segment&) = delete;
+		metrics_segment& operator=(const metrics_segment&) = delete;
+
+		~metrics_segment() noexcept;
+
+		// create segment for workers. Shared one is published only if shared is true
+		bool create(uint16_t port, uint32_t workers, bool shared);
+
+		// map segment published by relay on port, read only
+		bool open(uint16_t port);
+
+		bool isValid() const noexcept { return m_header != nullptr; }
+
+		const metrics_header& header() const noexcept { return *m_header; }
+
+		worker_metrics& worker(uint32_t index) noexcept { return m_workers[index]; }
+
+		const worker_metrics& worker(uint32_t index) const noexcept { return m_workers[index]; }
+
+		// shared memory object name of relay on port
+		static std::string nameOf(uint16_t port);
+
+	private:
+		void reset() noexcept;
+
+		metrics_header* m_header{};
+
+		worker_metrics* m_workers{};
+
+		std::size_t m_size{};
+
+		std::string m_sharedName{}; // unlinked on destruction, empty unless this segment created shared one
+
+		bool m_mapped{}; // memory is mapped rather than allocated
+	};
+
+	// render segment in prometheus text exposition format, one series per worker
+	void metrics_to_prometheus(const metrics_segment& segment, std::string& out);
+} // namespace ur
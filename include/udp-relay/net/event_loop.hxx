@@ -0,0 +1,100 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include "udp-relay/net/udpsocket.hxx"
+
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace ur::net
+{
+	// readiness flags reported by event_loop
+	enum event_flags : uint32_t
+	{
+		Readable = 1 << 0,
+		Writable = 1 << 1,
+		Timer = 1 << 2,
+		Wakeup = 1 << 3,
+	};
+
+	struct event
+	{
+		void* m_userData{}; // value provided on socket or timer registration
+		uint32_t m_flags{}; // combination of event_flags
+	};
+
+	// reactor for multiple sockets and deadline timers. Uses edge-triggered epoll on Linux and select() elsewhere.
+	// Readable is reported once per new data arrival, consumer should read socket until it would block.
+	class event_loop final
+	{
+	public:
+		event_loop() noexcept;
+
+		event_loop(const event_loop&) = delete;
+		event_loop& operator=(const event_loop&) = delete;
+
+		~event_loop() noexcept;
+
+		// create native resources, result must be checked
+		bool init() noexcept;
+
+		// true if init succeeded
+		bool isValid() const noexcept;
+
+		// start watching socket for readability
+		bool add(const udpsocket& socket, void* userData) noexcept;
+
+		// stop watching socket
+		bool remove(const udpsocket& socket) noexcept;
+
+		// enable or disable writability notifications. Intended to be enabled only while sends are backlogged.
+		bool setWantWrite(const udpsocket& socket, void* userData, bool wantWrite) noexcept;
+
+		// add timer reported once as Timer event when deadline passed. Return timer id.
+		uint64_t addTimer(std::chrono::steady_clock::time_point deadline, void* userData);
+
+		// cancel timer before it fired
+		void cancelTimer(uint64_t id) noexcept;
+
+		// allow wait() to be interrupted from other threads with wakeup(). Linux only
+		bool enableWakeup() noexcept;
+
+		// interrupt wait() from any thread, reported as Wakeup event. Safe to call from signal handler
+		void wakeup() noexcept;
+
+		// wait for socket events or timers up to timeout. Return number of events written or -1 on error.
+		int32_t wait(std::span<event> events, std::chrono::microseconds timeout) noexcept;
+
+	private:
+		struct timer
+		{
+			std::chrono::steady_clock::time_point m_deadline{};
+			uint64_t m_id{};
+			void* m_userData{};
+		};
+
+		// move due timers into events. Return number of events written
+		int32_t collectTimers(std::span<event> events, std::chrono::steady_clock::time_point now) noexcept;
+
+#if UR_PLATFORM_LINUX
+		int m_epoll{-1};
+		int m_wakeupFd{-1};
+#else
+		struct registration
+		{
+			udpsocket::socket_t m_socket{};
+			void* m_userData{};
+			bool m_wantWrite{};
+		};
+		std::vector<registration> m_registrations{};
+		bool m_initialized{};
+#endif
+
+		std::vector<timer> m_timers{};
+
+		uint64_t m_nextTimerId{1};
+	};
+} // namespace ur::net
@@ -0,0 +1,62 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include "udp-relay/net/socket_address.hxx"
+#include "udp-relay/net/udpsocket.hxx"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+
+namespace ur::net
+{
+	// completion-driven I/O for single udpsocket, built on io_uring.
+	// Datagrams are received by multishot recvmsg into a provided-buffer ring and sent back from the very same buffer.
+	// Only available on Linux when build has io_uring headers; init() fails otherwise and caller should fallback to udpsocket calls.
+	class io_uring_engine final
+	{
+	public:
+		io_uring_engine() noexcept;
+
+		io_uring_engine(const io_uring_engine&) = delete;
+		io_uring_engine& operator=(const io_uring_engine&) = delete;
+
+		~io_uring_engine() noexcept;
+
+		// true if build supports io_uring. Running kernel might still refuse it.
+		static bool isCompiledIn() noexcept;
+
+		// setup ring for socket with bufferCount (power of 2) buffers, each fitting datagram of bufferSize bytes. Socket must outlive the engine.
+		bool init(const udpsocket& socket, uint32_t bufferCount, uint32_t bufferSize) noexcept;
+
+		// enable ring and start receiving. Calling thread becomes the only one allowed to use the engine,
+		// so it must be the thread that runs recvBatch & send, not necessarily the one that called init()
+		bool start() noexcept;
+
+		// release ring and buffers
+		void shutdown() noexcept;
+
+		// true if init succeeded
+		bool isValid() const noexcept;
+
+		// submit pending sends and wait up to timeout for incoming datagrams. Return number of datagrams received or -1 on error.
+		// Every received datagram must be handed back with either send() or release().
+		int32_t recvBatch(std::span<datagram> datagrams, std::chrono::microseconds timeout) noexcept;
+
+		// queue datagram received with recvBatch to be sent to addr. Buffer returns to the engine once send completes.
+		void send(const datagram& dgram, uint32_t bytes, const socket_address& addr) noexcept;
+
+		// return datagram buffer received with recvBatch to the engine without sending
+		void release(const datagram& dgram) noexcept;
+
+		// amount of sends completed with error since init
+		uint64_t getSendFailures() const noexcept;
+
+	private:
+		struct state;
+		std::unique_ptr<state> m_state;
+	};
+} // namespace ur::net
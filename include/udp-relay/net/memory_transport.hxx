@@ -0,0 +1,86 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include "udp-relay/net/socket_address.hxx"
+#include "udp-relay/net/transport.hxx"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace ur::net
+{
+	// transport over two rings of datagrams: inbound is filled by caller and received by relay,
+	// outbound is filled by relay sends and taken by caller. Not thread safe, caller drives relay from the same thread.
+	class memory_transport final : public transport
+	{
+	public:
+		// largest datagram ring slot holds, same as relay receive buffer
+		static constexpr std::size_t maxDatagramSize = 1472;
+
+		struct slot
+		{
+			socket_address m_addr{}; // source of inbound, destination of outbound datagram
+			uint32_t m_bytes{};
+			std::array<std::byte, maxDatagramSize> m_data{};
+		};
+
+		// capacity of each ring is rounded up to power of two
+		explicit memory_transport(std::size_t capacity = 4096, uint16_t port = 6060);
+
+		// queue datagram for relay to receive. Return false if inbound ring is full or datagram doesn't fit slot
+		bool push(const socket_address& from, const void* data, std::size_t size) noexcept;
+
+		// oldest datagram sent by relay or nullptr if none. Valid until next pop() or relay send
+		const slot* front() const noexcept;
+
+		// release datagram returned by front()
+		void pop() noexcept;
+
+		// sent datagrams are counted only, not stored. Suits throughput runs that don't check output
+		void setDiscardSent(bool bDiscard) noexcept { m_discardSent = bDiscard; }
+
+		std::size_t pendingReceive() const noexcept { return m_inboundTail - m_inboundHead; }
+
+		std::size_t pendingSent() const noexcept { return m_outboundTail - m_outboundHead; }
+
+		uint64_t getSentDatagrams() const noexcept { return m_sentDatagrams; }
+
+		uint64_t getSentBytes() const noexcept { return m_sentBytes; }
+
+		// datagrams relay failed to send as outbound ring was full
+		uint64_t getSendDropped() const noexcept { return m_sendDropped; }
+
+		int32_t recvBatch(std::span<datagram> datagrams) noexcept override;
+
+		int32_t sendBatch(std::span<datagram> datagrams) noexcept override;
+
+		uint16_t getPort() const noexcept override { return m_port; }
+
+	private:
+		std::vector<slot> m_inbound{};
+
+		std::vector<slot> m_outbound{};
+
+		// free running positions, masked on access
+		std::size_t m_inboundHead{};
+		std::size_t m_inboundTail{};
+		std::size_t m_outboundHead{};
+		std::size_t m_outboundTail{};
+
+		std::size_t m_mask{};
+
+		uint64_t m_sentDatagrams{};
+
+		uint64_t m_sentBytes{};
+
+		uint64_t m_sendDropped{};
+
+		uint16_t m_port{};
+
+		bool m_discardSent{};
+	};
+} // namespace ur::net
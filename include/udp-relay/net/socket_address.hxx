@@ -58,6 +58,15 @@ namespace ur::net
 		// true if initialized as ipv6
 		bool isIpv6() const noexcept;
 
+		// true if initialized as ipv6 address mapping ipv4 one, ::ffff:a.b.c.d
+		bool isV4Mapped() const noexcept;
+
+		// 4 ip bytes of ipv4 or v4-mapped address, nullptr for other addresses
+		const std::byte* v4Bytes() const noexcept;
+
+		// hash of ip & port. Ipv4 and v4-mapped ipv6 addresses hash only meaningful 4 bytes of ip
+		std::size_t hash() const noexcept;
+
 		bool operator==(const socket_address& other) const noexcept;
 		bool operator!=(const socket_address& other) const noexcept;
 
@@ -75,13 +84,7 @@ namespace std
 	{
 		std::size_t operator()(const ur::net::socket_address& val) const noexcept
 		{
-			alignas(4) std::array<std::byte, 16 + 2> ipPort{};
-
-			std::memcpy(ipPort.data(), val.getRawIp().data(), 16);
-			uint16_t port = val.getPort();
-			std::memcpy(ipPort.data() + 16, &port, sizeof(port));
-
-			return std::hash<std::string_view>{}(std::string_view(reinterpret_cast<const char*>(ipPort.data()), ipPort.size()));
+			return val.hash();
 		}
 	};
 
@@ -0,0 +1,48 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include "udp-relay/net/udpsocket.hxx"
+
+#include <cstdint>
+#include <span>
+
+namespace ur::net
+{
+	// datagram source & sink relay runs on. Relay uses socket_transport over own socket by default,
+	// memory_transport lets relay logic run without network stack
+	class transport
+	{
+	public:
+		virtual ~transport() = default;
+
+		// same contract as udpsocket::recvBatch, except 0 is returned as well when nothing is pending
+		virtual int32_t recvBatch(std::span<datagram> datagrams) noexcept = 0;
+
+		// same contract as udpsocket::sendBatch
+		virtual int32_t sendBatch(std::span<datagram> datagrams) noexcept = 0;
+
+		// local port in host byte order
+		virtual uint16_t getPort() const noexcept = 0;
+	};
+
+	// transport over udpsocket owned elsewhere
+	class socket_transport final : public transport
+	{
+	public:
+		socket_transport() = default;
+		explicit socket_transport(const udpsocket* socket) noexcept
+			: m_socket(socket)
+		{
+		}
+
+		int32_t recvBatch(std::span<datagram> datagrams) noexcept override { return m_socket->recvBatch(datagrams); }
+
+		int32_t sendBatch(std::span<datagram> datagrams) noexcept override { return m_socket->sendBatch(datagrams); }
+
+		uint16_t getPort() const noexcept override { return m_socket->getPort(); }
+
+	private:
+		const udpsocket* m_socket{};
+	};
+} // namespace ur::net
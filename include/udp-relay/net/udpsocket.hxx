@@ -2,12 +2,26 @@
 
 #pragma once
 
+#include "udp-relay/net/socket_address.hxx"
+
 #include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <span>
 
 namespace ur::net
 {
+	// single datagram entry for batched send & receive operations
+	struct datagram
+	{
+		void* m_buffer{};		 // data buffer
+		uint32_t m_bufferSize{}; // buffer capacity on receive, data size on send
+		int32_t m_bytes{};		 // bytes received or sent, -1 on error
+		socket_address m_addr{}; // source address on receive, destination address on send
+		uint16_t m_segmentSize{}; // when non-zero buffer holds run of equal-sized datagrams (GRO on receive, GSO on send), last one might be shorter
+		int64_t m_rxTimestamp{};  // kernel receive time in ns since unix epoch, 0 unless enabled with setRxTimestamps
+		uint32_t m_rxDropped{};	  // datagrams socket dropped so far due to full receive buffer, 0 unless enabled with setRxDropCounter
+	};
 
 	// socket for UDP messaging
 	class udpsocket final
@@ -20,6 +34,12 @@ namespace ur::net
 		using socket_t = int;
 #endif
 
+		// maximum amount of datagrams processed by single native batch call
+		static constexpr std::size_t maxBatchSize = 64;
+
+		// maximum amount of segments kernel accepts in single GSO send
+		static constexpr std::size_t maxSendSegments = 64;
+
 		udpsocket() noexcept;
 
 		udpsocket(const udpsocket&) = delete;
@@ -59,12 +79,34 @@ namespace ur::net
 		// receives data. Return bytes received or -1 on error
 		int32_t recvFrom(void* buffer, size_t bufferSize, struct socket_address& addr) const noexcept;
 
+		// receives up to datagrams.size() datagrams with as few syscalls as possible. Return number of datagrams received or -1 on error
+		int32_t recvBatch(std::span<datagram> datagrams) const noexcept;
+
+		// sends all datagrams with as few syscalls as possible, skipping ones that failed. Return number of datagrams sent or -1 on error
+		int32_t sendBatch(std::span<datagram> datagrams) const noexcept;
+
 		// for ipv6 socket, set if socket should be ipv6 only or dual-stack
 		bool setOnlyIpv6(bool value) const noexcept;
 
 		// allow socket to reuse addr
 		bool setReuseAddr(bool bAllowReuse = true) const noexcept;
 
+		// allow multiple sockets bind the same address & port with kernel load balancing between them. Linux only
+		bool setReusePort(bool bAllowReuse = true) const noexcept;
+
+		// let kernel coalesce datagrams of single flow into one buffer, reported with datagram::m_segmentSize in recvBatch. Linux only
+		bool setGro(bool bEnable = true) const noexcept;
+
+		// let kernel stamp every received datagram, reported with datagram::m_rxTimestamp in recvBatch. Linux only
+		bool setRxTimestamps(bool bEnable = true) const noexcept;
+
+		// let kernel report how many datagrams socket dropped, with datagram::m_rxDropped in recvBatch. Linux only
+		bool setRxDropCounter(bool bEnable = true) const noexcept;
+
+		// let receives on empty socket poll device queue for up to timeout (SO_BUSY_POLL), going above net.core.busy_read
+		// requires CAP_NET_ADMIN. With bPrefer, busy polling takes precedence over interrupts when napi defers them. Linux only
+		bool setBusyPoll(std::chrono::microseconds timeout, bool bPrefer) const noexcept;
+
 		// set socket non-blocking behavior
 		bool setNonBlocking(bool bNonBlocking = true) const noexcept;
 
@@ -80,6 +122,9 @@ namespace ur::net
 		// return recv buffer size
 		int32_t getRecvBufferSize() const noexcept;
 
+		// sets recv buffer size above system limit (SO_RCVBUFFORCE), requires CAP_NET_ADMIN. Linux only
+		bool setRecvBufferSizeForce(int32_t size) const noexcept;
+
 		// set send operation timeout, used in blocking sockets. Return true on success.
 		bool setSendTimeout(std::chrono::microseconds timeout) const noexcept;
 
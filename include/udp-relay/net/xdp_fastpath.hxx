@@ -0,0 +1,51 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include "udp-relay/net/socket_address.hxx"
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+namespace ur::net
+{
+	// in-kernel forwarding of established channels with XDP program attached in generic mode.
+	// Relay keeps routes in sync with its address mappings and reads back counters of datagrams that never reached it.
+	// Only available on Linux builds with ENABLE_XDP_FASTPATH; init() fails otherwise. Only ipv4 (and v4-mapped) peers are forwarded.
+	class xdp_fastpath final
+	{
+	public:
+		xdp_fastpath() noexcept;
+
+		xdp_fastpath(const xdp_fastpath&) = delete;
+		xdp_fastpath& operator=(const xdp_fastpath&) = delete;
+
+		~xdp_fastpath() noexcept;
+
+		// true if build supports xdp fast path
+		static bool isCompiledIn() noexcept;
+
+		// load program object and attach to interface, forwarding datagrams sent to relayPort (host order)
+		bool init(std::string_view interfaceName, std::string_view objectPath, uint16_t relayPort, uint32_t handshakeMagicBe) noexcept;
+
+		// detach program and release maps
+		void shutdown() noexcept;
+
+		// true if init succeeded
+		bool isValid() const noexcept;
+
+		// forward datagrams received from `from` to `to` in kernel. Return false if addresses not supported or map is full
+		bool addRoute(const socket_address& from, const socket_address& to) noexcept;
+
+		// stop forwarding datagrams received from `from`
+		void removeRoute(const socket_address& from) noexcept;
+
+		// total datagrams and payload bytes forwarded in kernel from `from` since route was added
+		bool readCounters(const socket_address& from, uint64_t& packets, uint64_t& bytes) const noexcept;
+
+	private:
+		struct state;
+		std::unique_ptr<state> m_state;
+	};
+} // namespace ur::net
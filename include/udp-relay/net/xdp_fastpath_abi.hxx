@@ -0,0 +1,37 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+// map layouts shared between xdp_fastpath and in-kernel program relay_fastpath.bpf.c, must stay plain C
+
+#include <linux/types.h>
+
+#define UR_XDP_MAX_ROUTES 65536
+
+// ipv4 endpoint, network byte order
+struct ur_xdp_endpoint
+{
+	__be32 addr;
+	__be16 port;
+	__u16 pad;
+};
+
+// where datagrams from key endpoint are forwarded to, with counters of datagrams forwarded in kernel.
+// mac is source mac of last frame from key endpoint, which is next hop for datagrams to it; learned by program, zeroed by relay
+struct ur_xdp_route
+{
+	struct ur_xdp_endpoint peer;
+	__u64 packets;
+	__u64 bytes;
+	__u8 mac[6];
+	__u8 macKnown;
+	__u8 pad;
+};
+
+// single entry of config map, network byte order
+struct ur_xdp_config
+{
+	__be32 handshakeMagic; // datagrams starting with it are always passed to relay
+	__be16 relayPort;
+	__u16 pad;
+};
@@ -0,0 +1,76 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include "udp-relay/channel_arena.hxx"
+#include "udp-relay/net/udpsocket.hxx"
+
+#include <cstdint>
+#include <vector>
+
+namespace ur
+{
+	// socket of relay port dedicated to single channel
+	struct allocated_port
+	{
+		net::udpsocket m_socket{};
+		channel_handle m_channel{};
+		uint16_t m_port{};
+		bool m_readable{}; // not drained since last readable event, listed by relay until it is
+	};
+
+	// relay ports handed out to channels from configured range, each bound by own socket. Every port has fixed slot,
+	// so slot address given as socket event user data leads straight to channel without any lookup.
+	// Released ports are queued behind free ones, so port is reused as late as possible and late datagrams
+	// of closed channel don't leak into the next one.
+	class port_allocator final
+	{
+	public:
+		// ports tried to bind per allocation before giving up, when others are taken by other processes
+		static constexpr uint32_t maxBindAttempts = 16;
+
+		port_allocator() noexcept = default;
+		port_allocator(const port_allocator&) = delete;
+		port_allocator& operator=(const port_allocator&) = delete;
+
+		// take ports first..last, every stride-th one starting with first + offset, so shards get disjoint ports.
+		// Releases every allocated port, first of 0 disables allocator
+		void init(uint16_t first, uint16_t last, uint32_t stride, uint32_t offset, bool ipv6);
+
+		bool isEnabled() const noexcept { return !m_slots.empty(); }
+
+		// bind socket of next free port for channel. Return nullptr if none could be bound
+		allocated_port* allocate(channel_handle channel);
+
+		// close socket of port and queue it for reuse
+		void release(allocated_port& slot) noexcept;
+
+		// slot of allocated port or nullptr
+		allocated_port* find(uint16_t port) noexcept;
+
+		// ports allocated now
+		uint32_t size() const noexcept { return m_allocated; }
+
+		// ports in range
+		uint32_t capacity() const noexcept { return static_cast<uint32_t>(m_slots.size()); }
+
+	private:
+		void pushFree(uint32_t index) noexcept;
+
+		std::vector<allocated_port> m_slots{}; // slot i is port m_first + i * m_stride, never resized after init
+
+		std::vector<uint32_t> m_free{}; // ring of free slot indices, oldest released first
+
+		uint32_t m_freeHead{};
+
+		uint32_t m_freeCount{};
+
+		uint32_t m_allocated{};
+
+		uint32_t m_first{};
+
+		uint32_t m_stride{1};
+
+		bool m_ipv6{};
+	};
+} // namespace ur
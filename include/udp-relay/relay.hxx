@@ -2,11 +2,29 @@
 
 #pragma once
 
+#include "udp-relay/capture_ring.hxx"
+#include "udp-relay/channel_arena.hxx"
+#include "udp-relay/channel_group.hxx"
 #include "udp-relay/circular_buffer.hxx"
+#include "udp-relay/clock.hxx"
+#include "udp-relay/egress_queue.hxx"
+#include "udp-relay/flat_map.hxx"
 #include "udp-relay/guid.hxx"
+#include "udp-relay/handshake_cache.hxx"
+#include "udp-relay/handshake_limiter.hxx"
+#include "udp-relay/hmac.hxx"
+#include "udp-relay/latency_histogram.hxx"
+#include "udp-relay/metrics.hxx"
+#include "udp-relay/net/event_loop.hxx"
+#include "udp-relay/net/io_uring_engine.hxx"
 #include "udp-relay/net/network_utils.hxx"
 #include "udp-relay/net/socket_address.hxx"
+#include "udp-relay/net/transport.hxx"
 #include "udp-relay/net/udpsocket.hxx"
+#include "udp-relay/net/xdp_fastpath.hxx"
+#include "udp-relay/port_allocator.hxx"
+#include "udp-relay/spsc_ring.hxx"
+#include "udp-relay/timer_wheel.hxx"
 
 #include <array>
 #include <atomic>
@@ -15,7 +33,11 @@
 #include <cstdlib>
 #include <format>
 #include <memory>
-#include <unordered_map>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
 
 // initialize udp-relay library and it's components
 extern int ur_init();
@@ -28,44 +50,93 @@ extern void ur_shutdown();
 
 namespace ur
 {
-	struct channel_stats
+	// how relay loop waits for datagrams
+	enum class latency_mode : uint8_t
 	{
-		uint64_t m_bytesReceived{};
-		uint64_t m_bytesSent{};
-
-		uint32_t m_packetsReceived{};
-		uint32_t m_packetsSent{};
+		Wait,	  // block in event loop until socket is readable
+		Busy,	  // keep trying non-blocking receives for spin budget after last datagram, then block
+		Adaptive, // spin like Busy only while packet rate makes next datagram expected within spin budget
 	};
 
-	struct channel
-	{
-		channel() = default;
-		channel(guid inGuid, net::socket_address inPeerA, std::chrono::steady_clock::time_point inLastUpdated)
-			: m_guid{inGuid}
-			, m_peerA{inPeerA}
-			, m_lastUpdated{inLastUpdated}
-		{
-		}
+	// parse "wait", "busy" or "adaptive"
+	std::optional<latency_mode> latency_mode_from_string(std::string_view name) noexcept;
 
-		const guid m_guid{};
-		net::socket_address m_peerA{};
-		net::socket_address m_peerB{};
-		std::chrono::steady_clock::time_point m_lastUpdated{};
-		channel_stats m_stats{};
-	};
+	std::string_view latency_mode_to_string(latency_mode mode) noexcept;
 
 	struct relay_params
 	{
 		uint16_t m_primaryPort{6060};
 		uint32_t m_socketRecvBufferSize{0};
+		uint32_t m_socketRecvBufferMax{0}; // receive buffer is doubled up to that size while kernel drops datagrams, 0 disables
 		uint32_t m_socketSendBufferSize{0};
 		std::chrono::milliseconds m_cleanupTime{1800};
 		std::chrono::milliseconds m_cleanupInactiveChannelAfterTime{30000};
+		uint32_t m_expiryBudget{256}; // max expiry wheel steps per loop iteration, bounds time spent closing inactive channels
+		uint32_t m_handshakeCacheSize{1024}; // verified handshakes remembered to skip HMAC of repeated ones, 0 disables cache
+		uint32_t m_handshakeRate{64};		 // handshakes per second single address may have validated, 0 disables limit
+		uint32_t m_handshakePrefixRate{4096}; // same for /24 ipv4 or /64 ipv6 prefix, per worker. 0 disables limit
+		uint32_t m_batchSize{32}; // max datagrams received & sent per single batch, clamped to udpsocket::maxBatchSize
+		uint32_t m_egressQueueSize{4096};	// datagrams kept until socket becomes writable when its send buffer is full, 0 drops them right away
+		uint32_t m_egressChannelLimit{256}; // of those, max datagrams single channel may have queued
+		bool m_egressDropOldest{};			// make room in full queue by dropping oldest datagram of channel instead of new one
+		latency_mode m_latencyMode{};
+		uint32_t m_spinBudgetUs{200}; // time relay spins without traffic before blocking, in Busy & Adaptive modes
+		uint32_t m_busyPollUs{50};	  // SO_BUSY_POLL of socket in Busy & Adaptive modes (linux), 0 disables
+		int32_t m_cpu{-1};			  // cpu worker 0 is pinned to, others take following ones. -1 picks isolated cpus in Busy & Adaptive modes. Used by relay_group
+		uint32_t m_maxGroupSize{2}; // peers single channel may have, up to channel_group::maxSize. Above 2 every peer gets datagrams of all others
+		uint32_t m_workers{1};	  // amount of relay shards, each with own thread and socket sharing the port. Used by relay_group
 		bool ipv6{};
+		bool m_ioUring{}; // use io_uring engine when available, fallback to socket calls otherwise
+		bool m_gro{};	  // receive coalesced runs with UDP GRO and forward them with GSO (linux, socket calls only)
+		bool m_hugePages{}; // back channel storage with huge pages (linux)
+		bool m_residency{}; // measure time datagrams spend from kernel receive to send, logged with periodic stats (linux, socket calls only)
+		bool m_metrics{};	// publish worker metrics in shared memory for udp-relay-metrics exporter (linux). Used by relay_group
+
+		// range of ports channels get dedicated one from, when peer asks with handshake_flag_relay_port. 0 disables.
+		// Shards take every m_workers-th port of range (own socket only)
+		uint16_t m_relayPortFirst{};
+		uint16_t m_relayPortLast{};
+
+		std::string m_capturePath{};	 // pcap ring file received datagrams are traced to, disabled when empty. Shards add .<index> suffix
+		uint32_t m_captureSample{1};	 // trace 1 of that many datagrams
+		uint32_t m_captureSnapLength{64}; // payload bytes kept of each traced datagram
+		uint32_t m_captureSizeMb{64};	 // size of capture file, oldest records are overwritten once full
+
+		std::string m_xdpInterface{};					  // interface to attach in-kernel fast path to, disabled when empty
+		std::string m_xdpObject{"relay_fastpath.bpf.o"}; // compiled fast path program
 	};
 
-	using hmac_sha256 = std::array<std::byte, 32>;
-	using secret_key = std::vector<std::byte>;
+	// relay-wide counters, used to tune batch size
+	struct relay_stats
+	{
+		uint64_t m_recvBatches{};	// receive calls that returned at least one datagram
+		uint64_t m_recvDatagrams{}; // datagrams received by all batches
+		uint64_t m_sendBatches{};	// send calls made with at least one datagram
+		uint64_t m_sendDatagrams{}; // datagrams passed to send calls
+		uint64_t m_sendPartial{};	// send calls that failed to send every datagram
+		uint64_t m_sendDropped{};	// datagrams dropped by failed or partial sends
+		uint64_t m_recvDropped{};	// datagrams dropped by kernel as receive buffer was full
+		uint64_t m_egressQueued{};	// datagrams put in egress queue as socket send buffer was full
+		uint64_t m_egressDropped{}; // datagrams egress queue had no room for or dropped with closed channels
+		uint64_t m_fanoutCopies{};	// sends beyond first one made for datagrams of group channels
+
+		uint64_t m_handoffSent{};	  // datagrams handed over to shard owning their channel
+		uint64_t m_handoffReceived{}; // datagrams received from other shards
+		uint64_t m_handoffDropped{};  // datagrams dropped because handoff ring was full
+
+		uint64_t m_handshakeCacheHits{};   // handshakes accepted without HMAC, as same packet was verified before
+		uint64_t m_handshakeCacheMisses{}; // cacheable handshakes that needed HMAC
+		uint64_t m_handshakesShed{};	   // handshakes dropped before validation, as their source exceeded rate limit
+
+		uint64_t m_relayPortsAllocated{}; // dedicated ports handed to channels
+		uint64_t m_relayPortsExhausted{}; // requests for dedicated port refused as none could be bound
+		uint64_t m_relayPortStrays{};	  // datagrams received on dedicated port from neither of channel peers
+
+		// wall time of loop iterations, measured in Busy & Adaptive modes only
+		uint64_t m_loopWorkNs{};  // iterations that received or forwarded datagrams
+		uint64_t m_loopSpinNs{};  // iterations that found nothing without blocking
+		uint64_t m_loopSleepNs{}; // blocked waiting for socket
+	};
 
 	// MUST override or use UDP_RELAY_SECRET_KEY env var
 	constexpr std::string_view handshake_secret_key_base64 = "Zkw2SThGM2VndjZBcEMxNWZrSk85VTd4S2VERDZYdXI=";
@@ -91,8 +162,55 @@ namespace ur
 	};
 	static_assert(sizeof(handshake_extension_header) == 8);
 
+	// handshake_header::m_flags bit peer sets to ask for dedicated relay port of channel
+	constexpr uint16_t handshake_flag_relay_port = 1 << 0;
+
+	enum class handshake_extension_type : uint16_t
+	{
+		RelayPort = 1,
+	};
+
+	// extension of handshake relay answers with to peer that asked for dedicated port, once channel is established.
+	// Packet is handshake_header with the same guid & flags, m_length of extension and mac signed by relay, followed by it.
+	// Fields in network byte order, extension m_length covers whole extension
+	struct alignas(8) handshake_relay_port
+	{
+		handshake_extension_header m_header{};
+		uint16_t m_port{}; // datagrams sent to that port of relay go to other peer of channel
+		uint16_t m_reserved[3]{};
+	};
+	static_assert(sizeof(handshake_relay_port) == 16);
+
 	using recv_buffer = std::array<std::byte, 1472>;
 
+	// receive buffer for GRO runs, fits largest datagram kernel might coalesce
+	using gro_buffer = std::array<std::byte, 65535>;
+
+	// datagram moved from shard that received it to shard owning its channel
+	struct handoff_datagram
+	{
+		net::socket_address m_addr{};
+		int32_t m_bytes{};
+		int64_t m_rxTimestamp{};
+		bool m_isHandshake{};		 // m_header already verified by sending shard
+		handshake_header m_header{}; // host byte order
+		recv_buffer m_buffer;
+	};
+
+	using handoff_ring = spsc_ring<handoff_datagram, 256>;
+
+	// ring from one shard to another. Ring is large, so sending shard allocates it on first handoff and only pairs
+	// of shards that actually exchange datagrams pay for it
+	struct handoff_link
+	{
+		handoff_link() noexcept = default;
+		handoff_link(const handoff_link&) = delete;
+		handoff_link& operator=(const handoff_link&) = delete;
+		~handoff_link() { delete m_ring.load(std::memory_order_relaxed); }
+
+		std::atomic<handoff_ring*> m_ring{};
+	};
+
 	class relay
 	{
 	public:
@@ -107,39 +225,306 @@ namespace ur
 		// Begin spin loop
 		void run();
 
-		// Immediate stop
+		// single iteration of run loop without waiting, for driving relay by hand over custom transport
+		void poll();
+
+		// Immediate stop. Only sets flag and wakes run loop, so safe to call from signal handler
 		void stop();
 
 		// Wait until all existing connections closed and then stop. Also prevents new connections being created.
+		// Signal safe as stop()
 		void stopGracefully();
 
+		// relay-wide counters since init
+		const relay_stats& getStats() const noexcept { return m_stats; }
+
+		// bound port in host byte order
+		uint16_t getPort() const;
+
+		// counters are written to metrics instead of relay's own block. metrics must outlive relay
+		void setMetrics(worker_metrics* metrics) noexcept;
+
+		// receive & send over transport instead of own socket. Socket-only features (io_uring, GRO, xdp, residency,
+		// receive buffer tuning) are disabled. transport must outlive relay. Must be called before init.
+		void setTransport(net::transport* transport) noexcept { m_customTransport = transport; }
+
+		// read time from clock instead of steady_clock. clock must outlive relay. Must be called before init.
+		void setClock(const clock_source* clock) noexcept { m_clock = clock ? clock : &m_steadyClock; }
+
+		// make relay shard shardIndex of shards.size(), sharing the port via SO_REUSEPORT. Must be called before init.
+		// outgoing[i] is link to shard i and incoming[i] is link from shard i, both nullptr for itself.
+		void setShard(uint32_t shardIndex, std::span<relay* const> shards, std::span<handoff_link* const> outgoing, std::span<handoff_link* const> incoming);
+
 	private:
+		struct remote_route
+		{
+			uint32_t m_shard{};
+			std::chrono::steady_clock::time_point m_lastUpdated{};
+		};
+
+		// create, configure & bind own socket
+		bool initSocket(relay_params& params);
+
+		// loop iteration, waiting for socket events when bWait
+		void runOnce(bool bWait);
+
 		void processIncoming();
 
+		// receive & forward with io_uring, waiting up to timeout for datagrams
+		void processIncomingIoUring(std::chrono::microseconds timeout);
+
+		// handle single datagram received from socket
+		void processReceived(const net::datagram& dgram);
+
+		// handle GRO run of datagrams, forwarding it whole when possible
+		void processCoalesced(const net::datagram& dgram);
+
+		// deserialize header if datagram is valid handshake
+		std::pair<bool, handshake_header> readHeader(const net::datagram& dgram);
+
+		// handle single received datagram. Return index of channel datagram should be forwarded to or nullopt
+		std::optional<uint32_t> processDatagram(const net::datagram& dgram, const handshake_header* verifiedHeader);
+
+		// move datagram to shard owning its channel. Return true if datagram was taken
+		bool tryHandoff(const net::datagram& dgram, const handshake_header* verifiedHeader);
+
+		// process datagrams handed over by other shards
+		void processHandoffs();
+
+		// wake shards that received handoffs while waiting
+		void wakeShards();
+
+		// true if other shards handed over datagrams not processed yet
+		bool hasPendingHandoffs() const;
+
+		uint32_t shardOf(const guid& g) const;
+
+		// answer peer of established channel asking for dedicated port with handshake_relay_port, allocating port if needed
+		void replyRelayPort(channel_handle handle, const net::socket_address& peer);
+
+		// receive & forward datagrams of dedicated ports reported readable
+		void processRelayPorts();
+
+		// forward what was received on dedicated port to other peer of its channel, through the same port
+		void forwardRelayPort(allocated_port& port, int32_t received);
+
+		// send first count datagrams of m_sendBatch through dedicated port
+		void sendRelayPort(allocated_port& port, size_t count);
+
+		// count datagram received for channel, keeping it alive
+		void touchChannel(channel& ch, uint32_t channelIndex, const net::datagram& dgram);
+
+		// add receive batch to metrics
+		void recordReceived(int32_t batchSize, uint64_t packets, uint64_t bytes) noexcept;
+
+		// queue datagram to other peer of channel, or to every other member of group
+		void queueSend(const net::datagram& dgram, uint32_t channelIndex);
+
+		// queue datagram to single destination, all copies of fanned out datagram point at the same buffer
+		void queueSendTo(const net::datagram& dgram, uint32_t channelIndex, const net::socket_address& dest);
+
+		// add peer to established channel as group member, unless group is full
+		void joinGroup(channel_handle handle, channel& ch, const net::socket_address& peer);
+
+		// members of channel beyond m_peerA & m_peerB, empty for pairs
+		std::span<const net::socket_address> groupMembers(uint32_t channelIndex) noexcept;
+
+		// true if peer is m_peerA, m_peerB or group member of channel
+		bool isMember(const channel& ch, uint32_t channelIndex, const net::socket_address& peer) noexcept;
+
+		void flushSendBatch();
+
+		// copy datagram that socket had no room for into egress queue, GSO runs segment by segment
+		void queueEgress(uint32_t channelIndex, const net::datagram& dgram);
+
+		// send queued datagrams until queue is empty or socket is full again
+		void drainEgress();
+
+		// update channel & metrics counters with datagrams of send batch, those with m_bytes < 0 skipped
+		void recordSent(std::span<const net::datagram> sent, const uint32_t* channels);
+
+		// ask event loop to report socket writable, once send buffer is full
+		void waitWritable();
+
+		// grow receive buffer toward m_params.m_socketRecvBufferMax if kernel dropped datagrams since last call
+		void tuneRecvBuffer();
+
+		// record residency of datagrams sent by last batch
+		void recordResidency(std::span<const net::datagram> sent);
+
+		// open channel in free arena slot. Return nullopt if arena is out of memory
+		std::optional<channel_handle> allocateChannel(const guid& channelGuid, const net::socket_address& peerA);
+
+		// drop channel with its guid & address mappings, invalidating handles to it
+		void closeChannel(channel_handle handle);
+
+		// pull counters of datagrams forwarded in kernel, keeping channel alive while fast path has traffic
+		void syncKernelStats(uint32_t channelIndex);
+
 		void conditionalCleanup();
 
+		// close channels and erase routes due on expiry wheels or re-arm them, within m_params.m_expiryBudget steps
+		void expireInactive();
+
+		// expiry wheel tick channel becomes inactive for too long at
+		uint64_t expiryTickOf(const channel& ch) const;
+
+		// refresh m_lastTickTime, m_lastTickMs & m_expiryTick
+		void updateTickTime();
+
+		// close packet rate window once it's long enough
+		void updatePacketRate() noexcept;
+
+		// true if loop should try receiving again instead of blocking, as datagram is expected soon
+		bool shouldSpin() const noexcept;
+
+		// add iteration that started at start and finished waiting at waited to loop time counters
+		void recordLoopTime(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point waited, bool bBlocked, uint64_t processedBefore) noexcept;
+
+		// datagrams received directly & by handoffs, for telling working iterations from idle ones
+		uint64_t processedDatagrams() const noexcept { return m_stats.m_recvDatagrams + m_stats.m_handoffReceived; }
+
+		static constexpr uint32_t expiryTickMs = 64; // expiry wheel resolution
+
+		static constexpr uint32_t spinEventInterval = 16; // spinning iterations between event loop polls
+
+		static constexpr std::chrono::milliseconds rateWindow{10}; // packet rate is sampled over windows of at least that
+
 		relay_params m_params{};
 
-		secret_key m_secretKey{};
+		hmac_verifier m_hmac{}; // keyed with secret passed to init
+
+		handshake_cache m_handshakeCache{};
+
+		handshake_limiter m_handshakeLimiter{};
 
 		net::udpsocket m_socket{};
 
-		std::unordered_map<guid, channel> m_channels{};
+		net::socket_transport m_socketTransport{};
+
+		net::transport* m_customTransport{};
+
+		net::transport* m_transport{}; // m_socketTransport or m_customTransport, set by init
+
+		net::io_uring_engine m_ioUring{};
+
+		net::event_loop m_eventLoop{};
+
+		net::xdp_fastpath m_xdp{};
+
+		capture_ring m_capture{};
+
+		port_allocator m_relayPorts{};
+
+		std::vector<allocated_port*> m_readablePorts{}; // dedicated ports with datagrams left to receive
+
+		bool m_socketReadable{}; // socket wasn't drained since last readable event
+
+		bool m_socketSendBlocked{}; // waiting socket to become writable
+
+		bool m_expiryPending{}; // expiry budget ran out before wheels caught up
+
+		uint32_t m_kernelDropped{}; // last SO_RXQ_OVFL counter reported by socket, wraps
+
+		uint64_t m_recvDroppedTuned{}; // m_stats.m_recvDropped at last tuneRecvBuffer() call
+
+		channel_arena m_channelArena{};
+
+		group_pool m_groups{};
+
+		timer_wheel<channel_handle> m_expiryWheel{}; // every open channel, at tick it might expire
+
+		flat_map<guid, channel_handle> m_channels{};
+
+		flat_map<net::socket_address, channel_handle> m_addressChannels{};
+
+		std::vector<std::byte> m_recvStorage{}; // receive buffer for each m_recvBatch entry, recv_buffer or gro_buffer sized
+
+		std::vector<net::datagram> m_recvBatch{};
+
+		std::vector<net::datagram> m_sendBatch{};
+
+		std::vector<uint32_t> m_sendChannels{}; // channel index for each entry in m_sendBatch
+
+		size_t m_sendCount{};
+
+		egress_queue m_egress{};
+
+		relay_stats m_stats{};
+
+		latency_histogram m_residency{}; // ns from kernel receive to send, since last periodic stats
 
-		std::unordered_map<net::socket_address, guid> m_addressChannels{};
+		worker_metrics m_localMetrics{};
+
+		worker_metrics* m_metrics{&m_localMetrics}; // updated with relaxed stores only, read by exporter from other process
+
+		uint32_t m_shardIndex{};
+
+		std::vector<relay*> m_shards{};
+
+		std::vector<handoff_link*> m_outgoing{};
+
+		std::vector<handoff_link*> m_incoming{};
+
+		std::vector<uint8_t> m_shardsToWake{};
+
+		flat_map<net::socket_address, remote_route> m_remoteRoutes{}; // addresses of channels owned by other shards
+
+		timer_wheel<net::socket_address> m_routeExpiryWheel{}; // every remote route, at tick it might expire
+
+		std::atomic_bool m_sleeping{}; // waiting in event loop, other shards must wake it after handoff
+
+		std::atomic<size_t> m_channelCount{}; // channels size, visible to other shards
+
+		steady_clock_source m_steadyClock{};
+
+		const clock_source* m_clock{&m_steadyClock};
 
 		std::chrono::steady_clock::time_point m_lastTickTime{};
 
+		std::chrono::steady_clock::time_point m_startTime{};
+
+		uint32_t m_lastTickMs{}; // m_lastTickTime in ms since m_startTime, as stored in channel::m_lastUpdated
+
+		uint64_t m_expiryTick{}; // m_lastTickTime in expiry wheel ticks since m_startTime
+
+		std::chrono::steady_clock::time_point m_lastTraffic{}; // m_lastTickTime when datagrams were last received
+
+		std::chrono::steady_clock::time_point m_rateWindowStart{};
+
+		uint64_t m_rateWindowDatagrams{}; // received since m_rateWindowStart
+
+		double m_packetRate{}; // datagrams per second, smoothed over rate windows
+
+		uint32_t m_idleSpins{}; // spinning iterations since event loop was last polled
+
+		// loop time counters at last periodic report
+		uint64_t m_loopWorkReported{};
+		uint64_t m_loopSpinReported{};
+		uint64_t m_loopSleepReported{};
+
 		std::chrono::steady_clock::time_point m_nextCleanupTime{};
 
 		std::atomic_bool m_running{false};
 
 		std::atomic_bool m_gracefulStopRequested{false};
+
+		bool m_gracefulStopLogged{}; // run loop reports graceful stop once it sees request
 	};
 
 	struct relay_helpers
 	{
-		static std::pair<bool, handshake_header> tryDeserializeHeader(const secret_key& key, const recv_buffer& recvBuffer, size_t recvBytes);
+		// parse & validate handshake header. HMAC is checked only when verifier has key
+		static std::pair<bool, handshake_header> tryDeserializeHeader(hmac_verifier& verifier, const recv_buffer& recvBuffer, size_t recvBytes);
+
+		// parse & validate handshake header, except HMAC
+		static std::pair<bool, handshake_header> tryParseHeader(const recv_buffer& recvBuffer, size_t recvBytes);
+
+		// dedicated port from relay answer to handshake with handshake_flag_relay_port, 0 if packet isn't one. Doesn't check HMAC
+		static uint16_t tryParseRelayPort(const recv_buffer& recvBuffer, size_t recvBytes);
+
+		// true if mac of packet matches one in header
+		static bool verifyMac(hmac_verifier& verifier, const recv_buffer& recvBuffer, size_t recvBytes, const handshake_header& header);
 
 		// make secret key from base64 string or generate default key if empty
 		static secret_key makeSecret(std::string_view b64);
@@ -150,27 +535,4 @@ namespace ur
 		// decode base64 into byte array
 		static std::vector<std::byte> decodeBase64(std::string_view b64);
 	};
-} // namespace ur
-
-namespace std
-{
-	template <>
-	struct formatter<ur::hmac_sha256>
-	{
-	public:
-		constexpr auto parse(format_parse_context& ctx)
-		{
-			auto it = ctx.begin();
-			return it;
-		}
-
-		template <typename FormatContext>
-		auto format(const ur::hmac_sha256& v, FormatContext& ctx) const
-		{
-			auto it = ctx.out();
-			for (auto el : v)
-				it = std::format_to(ctx.out(), "{}", (uint8_t)el);
-			return it;
-		}
-	};
-} // namespace std
\ No newline at end of file
+} // namespace ur
\ No newline at end of file
@@ -0,0 +1,48 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include "udp-relay/metrics.hxx"
+#include "udp-relay/relay.hxx"
+
+#include <memory>
+#include <vector>
+
+namespace ur
+{
+	// set of relay shards sharing single port, each running in own thread.
+	// Kernel spreads incoming datagrams between shard sockets by address hash, datagrams for channels owned by other shard are handed over via spsc rings.
+	class relay_group
+	{
+	public:
+		relay_group() = default;
+		relay_group(const relay_group&) = delete;
+		relay_group(relay_group&&) = delete;
+		~relay_group() = default;
+
+		// Initialize params.m_workers relay shards
+		bool init(relay_params params, secret_key key);
+
+		// Run shards until all stopped. Single shard runs on calling thread
+		void run();
+
+		// Immediate stop of every shard
+		void stop();
+
+		// Graceful stop of every shard
+		void stopGracefully();
+
+		// counters summed over all shards. Only valid after run() returned
+		relay_stats getStats() const;
+
+	private:
+		metrics_segment m_metrics{}; // block for each shard, published when params.m_metrics set
+
+		std::vector<std::unique_ptr<relay>> m_relays{};
+
+		// m_links[from * count + to], unused when from == to
+		std::unique_ptr<handoff_link[]> m_links{};
+
+		std::vector<int32_t> m_cpus{}; // cpu each shard is pinned to, -1 if not pinned
+	};
+} // namespace ur
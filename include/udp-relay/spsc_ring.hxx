@@ -0,0 +1,76 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace ur
+{
+	// bounded lock-free queue for exactly one producer thread and one consumer thread.
+	// Elements are written and read in place to avoid copying large payloads twice.
+	template <typename Value, std::size_t Capacity>
+	class spsc_ring
+	{
+		static_assert(Capacity && (Capacity & (Capacity - 1)) == 0, "Capacity must be power of 2");
+
+	public:
+		// producer: slot to fill or nullptr if ring is full. Becomes visible to consumer after push()
+		Value* producerSlot() noexcept
+		{
+			const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+			if (tail - m_cachedHead == Capacity)
+			{
+				m_cachedHead = m_head.load(std::memory_order_acquire);
+				if (tail - m_cachedHead == Capacity)
+					return nullptr;
+			}
+			return &m_c[tail & (Capacity - 1)];
+		}
+
+		// producer: publish slot returned by producerSlot()
+		void push() noexcept
+		{
+			m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+
+		// consumer: element at offset from the front or nullptr if not available yet
+		Value* peek(std::size_t offset = 0) noexcept
+		{
+			const std::size_t head = m_head.load(std::memory_order_relaxed);
+			if (m_cachedTail - head <= offset)
+			{
+				m_cachedTail = m_tail.load(std::memory_order_acquire);
+				if (m_cachedTail - head <= offset)
+					return nullptr;
+			}
+			return &m_c[(head + offset) & (Capacity - 1)];
+		}
+
+		// consumer: release count elements from the front, must not exceed amount peeked
+		void pop(std::size_t count = 1) noexcept
+		{
+			m_head.store(m_head.load(std::memory_order_relaxed) + count, std::memory_order_release);
+		}
+
+		// any thread: true if no elements available at the moment
+		bool empty() const noexcept
+		{
+			return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+		}
+
+		static constexpr std::size_t capacity() noexcept { return Capacity; }
+
+	private:
+		// producer and consumer indices on separate cache lines to avoid false sharing
+		alignas(64) std::atomic<std::size_t> m_head{};
+		std::size_t m_cachedTail{}; // consumer's view of m_tail
+
+		alignas(64) std::atomic<std::size_t> m_tail{};
+		std::size_t m_cachedHead{}; // producer's view of m_head
+
+		alignas(64) std::array<Value, Capacity> m_c{};
+	};
+} // namespace ur
@@ -0,0 +1,136 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace ur
+{
+	// hierarchical timing wheel keyed by integer ticks. Each level has 64 slots, every slot of level N spans whole level N-1.
+	// Values are moved down a level once wheel reaches their slot, so expiring visits only values that are about due.
+	// Work is done in small steps, caller decides how many steps to spend at once.
+	template <typename Value, uint32_t Levels = 4>
+	class timer_wheel
+	{
+		static_assert(Levels > 0 && Levels * 6 < 64);
+
+		static constexpr uint32_t slotBits = 6;
+		static constexpr uint32_t slotCount = 1U << slotBits;
+		static constexpr uint64_t slotMask = slotCount - 1;
+
+	public:
+		// ticks reachable from current one without clamping to the last slot
+		static constexpr uint64_t range = uint64_t(1) << (slotBits * Levels);
+
+		// drop all values and start counting from tick
+		void reset(uint64_t tick)
+		{
+			for (auto& level : m_slots)
+			{
+				for (auto& slot : level)
+					slot.clear();
+			}
+			m_cascade.clear();
+			m_current = tick;
+			m_size = 0;
+		}
+
+		// add value due at deadline. Deadlines in the past are due on next popExpired()
+		void schedule(uint64_t deadline, Value value)
+		{
+			place(entry{deadline, std::move(value)});
+			++m_size;
+		}
+
+		// take value with deadline not later than now. Each value returned or moved between levels costs one unit of budget,
+		// passing empty slots is free as it's bounded by ticks elapsed. Return false once nothing is due or budget ran out.
+		bool popExpired(uint64_t now, Value& out, uint32_t& budget)
+		{
+			while (budget)
+			{
+				if (!m_cascade.empty())
+				{
+					--budget;
+					place(std::move(m_cascade.back()));
+					m_cascade.pop_back();
+					continue;
+				}
+
+				auto& slot = m_slots[0][m_current & slotMask];
+				if (!slot.empty())
+				{
+					--budget;
+					out = std::move(slot.back().m_value);
+					slot.pop_back();
+					--m_size;
+					return true;
+				}
+
+				if (m_current >= now)
+					return false;
+
+				advance();
+			}
+			return false;
+		}
+
+		// amount of scheduled values
+		size_t size() const noexcept { return m_size; }
+
+		// tick wheel has reached
+		uint64_t current() const noexcept { return m_current; }
+
+	private:
+		struct entry
+		{
+			uint64_t m_deadline{};
+			Value m_value{};
+		};
+
+		void place(entry e)
+		{
+			const uint64_t deadline = std::clamp(e.m_deadline, m_current, m_current + range - 1);
+
+			// highest level where deadline differs from current tick, so slot is reached before deadline passes
+			const uint32_t level = static_cast<uint32_t>(std::bit_width(deadline ^ m_current) + slotBits - 1) / slotBits;
+			const uint32_t clampedLevel = level ? std::min(level, Levels) - 1 : 0;
+
+			m_slots[clampedLevel][(deadline >> (slotBits * clampedLevel)) & slotMask].push_back(std::move(e));
+		}
+
+		// move to next tick, taking values of upper level slots that start at it for redistribution
+		void advance()
+		{
+			++m_current;
+			for (uint32_t level = 1; level < Levels; ++level)
+			{
+				if (m_current & ((uint64_t(1) << (slotBits * level)) - 1))
+					break;
+
+				auto& slot = m_slots[level][(m_current >> (slotBits * level)) & slotMask];
+				if (slot.empty())
+					continue;
+
+				if (m_cascade.empty())
+					std::swap(m_cascade, slot);
+				else
+					m_cascade.insert(m_cascade.end(), std::make_move_iterator(slot.begin()), std::make_move_iterator(slot.end()));
+				slot.clear();
+			}
+		}
+
+		std::array<std::array<std::vector<entry>, slotCount>, Levels> m_slots{};
+
+		std::vector<entry> m_cascade{}; // values waiting to be placed into lower levels
+
+		uint64_t m_current{};
+
+		size_t m_size{};
+	};
+} // namespace ur
@@ -1,6 +1,7 @@
 // Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
 
 #include "udp-relay/main_helpers.hxx"
+#include "udp-relay/net/event_loop.hxx"
 #include "udp-relay/net/network_utils.hxx"
 #include "udp-relay/net/socket_address.hxx"
 #include "udp-relay/net/udpsocket.hxx"
@@ -105,15 +106,33 @@ int main(int argc, char* argv[], char* envp[])
 		ur::recv_buffer recvBuffer{};
 		int32_t recvBytes{};
 
+		ur::net::event_loop eventLoop{};
+		if (!eventLoop.init() || !eventLoop.add(socketA, &socketA) || !eventLoop.add(socketB, &socketB)) [[unlikely]]
+		{
+			std::println("Failed to make event loop");
+			return 1;
+		}
+
 		const auto waitUntil = std::chrono::steady_clock::now() + cl::waitTime;
-		while (waitUntil > std::chrono::steady_clock::now())
+		eventLoop.addTimer(waitUntil, nullptr);
+
+		while (recvBytes <= 0)
 		{
-			if (socketA.waitForRead(cl::waitTime / 2))
-				recvBytes = socketA.recvFrom(recvBuffer.data(), recvBuffer.size(), recvAddr);
-			else if (socketB.waitForRead(cl::waitTime / 2))
-				recvBytes = socketB.recvFrom(recvBuffer.data(), recvBuffer.size(), recvAddr);
+			std::array<ur::net::event, 3> events{};
+			const int32_t eventCount = eventLoop.wait(events, cl::waitTime);
+			if (eventCount < 0)
+				break;
+
+			bool timedOut = false;
+			for (int32_t e = 0; e < eventCount && recvBytes <= 0; ++e)
+			{
+				if (events[e].m_flags & ur::net::event_flags::Timer)
+					timedOut = true;
+				else if (events[e].m_flags & ur::net::event_flags::Readable)
+					recvBytes = static_cast<ur::net::udpsocket*>(events[e].m_userData)->recvFrom(recvBuffer.data(), recvBuffer.size(), recvAddr);
+			}
 
-			if (recvBytes > 0)
+			if (timedOut)
 				break;
 		}
 
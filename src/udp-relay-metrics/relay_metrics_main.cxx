@@ -0,0 +1,178 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include "udp-relay/main_helpers.hxx"
+#include "udp-relay/metrics.hxx"
+#include "udp-relay/net/network_utils.hxx"
+#include "udp-relay/net/socket_address.hxx"
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <print>
+#include <string>
+#include <string_view>
+
+#if UR_PLATFORM_LINUX
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace cl
+{
+	static bool printHelp{};
+	static uint16_t relayPort{6060};
+	static uint16_t listenPort{0};
+	static std::string listenAddr{"127.0.0.1"};
+} // namespace cl
+
+// clang-format off
+static constexpr auto argList = std::array
+{
+	ur::cl_var_ref{"--help", cl::printHelp,			"--help	= print help" },
+	ur::cl_var_ref{"--port", cl::relayPort,			"--port 0-65535 = port of relay started with --metrics" },
+	ur::cl_var_ref{"--listen", cl::listenPort,		"--listen 0-65535 = serve metrics over http at /metrics on that port, print them once if 0" },
+	ur::cl_var_ref{"--listen-addr", cl::listenAddr,	"--listen-addr <value> = ipv4 address to listen on, 127.0.0.1 by default" },
+};
+// clang-format on
+
+// metrics of relay in prometheus text format, reopened each time so relay restarts are picked up
+static bool render_metrics(std::string& out)
+{
+	ur::metrics_segment segment{};
+	if (!segment.open(cl::relayPort))
+		return false;
+
+	ur::metrics_to_prometheus(segment, out);
+	return true;
+}
+
+#if UR_PLATFORM_LINUX
+static void send_all(int fd, std::string_view data)
+{
+	while (!data.empty())
+	{
+		const ssize_t sent = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+		if (sent <= 0)
+			return;
+		data.remove_prefix(sent);
+	}
+}
+
+static void serve_client(int fd)
+{
+	// request line is all that matters, rest of request is ignored
+	std::array<char, 1024> request{};
+	const ssize_t received = ::recv(fd, request.data(), request.size(), 0);
+	if (received <= 0)
+		return;
+
+	std::string_view requestLine(request.data(), received);
+	requestLine = requestLine.substr(0, requestLine.find('\r'));
+
+	std::string body{};
+	std::string_view status = "200 OK";
+	if (!requestLine.starts_with("GET /metrics ") && !requestLine.starts_with("GET / "))
+	{
+		status = "404 Not Found";
+		body = "not found\n";
+	}
+	else if (!render_metrics(body))
+	{
+		status = "503 Service Unavailable";
+		body = std::format("no metrics published for relay on port {}\n", cl::relayPort);
+	}
+
+	const std::string response = std::format("HTTP/1.1 {}\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: {}\r\nConnection: close\r\n\r\n", status, body.size());
+	send_all(fd, response);
+	send_all(fd, body);
+}
+
+static int serve()
+{
+	const int listenFd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (listenFd == -1)
+	{
+		std::println("Failed to create socket. Error code: {}", errno);
+		return 1;
+	}
+
+	const int reuse = 1;
+	::setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	auto addr = ur::net::socket_address::from_string(cl::listenAddr);
+	addr.setPort(cl::listenPort);
+	if (addr.isNull() || !addr.isIpv4())
+	{
+		std::println("Invalid listen address {}", cl::listenAddr);
+		::close(listenFd);
+		return 1;
+	}
+
+	sockaddr_in sin{};
+	sin.sin_family = AF_INET;
+	sin.sin_port = ur::net::hton16(cl::listenPort);
+	std::memcpy(&sin.sin_addr, addr.getRawIp().data(), sizeof(sin.sin_addr));
+	if (::bind(listenFd, reinterpret_cast<const sockaddr*>(&sin), sizeof(sin)) != 0 || ::listen(listenFd, 16) != 0)
+	{
+		std::println("Failed to listen on {}. Error code: {}", addr, errno);
+		::close(listenFd);
+		return 1;
+	}
+
+	std::println("Serving metrics of relay on port {} at http://{}/metrics", cl::relayPort, addr);
+
+	// scrapes are rare and cheap, serve them one by one
+	while (true)
+	{
+		const int clientFd = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+		if (clientFd == -1)
+		{
+			if (errno == EINTR)
+				continue;
+			std::println("Failed to accept connection. Error code: {}", errno);
+			break;
+		}
+
+		const timeval timeout{.tv_sec = 2, .tv_usec = 0};
+		::setsockopt(clientFd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		::setsockopt(clientFd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+		serve_client(clientFd);
+		::close(clientFd);
+	}
+
+	::close(listenFd);
+	return 1;
+}
+#endif
+
+int main(int argc, char* argv[])
+{
+	ur::parseArgs(argList, argc, argv);
+
+	if (cl::printHelp)
+	{
+		ur::printArgsHelp(argList);
+		return 0;
+	}
+
+#if UR_PLATFORM_LINUX
+	if (cl::listenPort)
+		return serve();
+
+	std::string out{};
+	if (!render_metrics(out))
+	{
+		std::println("No metrics published for relay on port {}. Relay must run with --metrics", cl::relayPort);
+		return 1;
+	}
+	std::print("{}", out);
+	return 0;
+#else
+	std::println("Metrics are published only on linux");
+	return 1;
+#endif
+}
@@ -0,0 +1,254 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include "udp-relay/capture_ring.hxx"
+#include "udp-relay/log.hxx"
+#include "udp-relay/main_helpers.hxx"
+#include "udp-relay/net/network_utils.hxx"
+#include "udp-relay/net/socket_address.hxx"
+#include "udp-relay/net/udpsocket.hxx"
+#include "udp-relay/relay.hxx"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if UR_PLATFORM_LINUX
+#include <sys/resource.h>
+#endif
+
+using namespace std::chrono_literals;
+
+namespace cl
+{
+	static bool printHelp{};
+	static std::string trace{};
+	static std::string relayAddr{};
+	static uint16_t relayPort{6060};
+	static int32_t speed{1};
+	static int32_t sockets{1024};
+	static std::string bindAddr{};
+	static int32_t bindSpread{1};
+	static int32_t loops{1};
+} // namespace cl
+
+// clang-format off
+static constexpr auto argList = std::array
+{
+	ur::cl_var_ref{"--help", cl::printHelp,					"--help								= print help" },
+	ur::cl_var_ref{"--trace", cl::trace,						"--trace <path>						= pcap file to replay, written by relay --capture or any raw ip / ethernet capture of udp" },
+	ur::cl_var_ref{"--relay-addr", cl::relayAddr,				"--relay-addr <value>				= address of relay server, 127.0.0.1 by default" },
+	ur::cl_var_ref{"--relay-port", cl::relayPort,				"--relay-port <value>				= relay server port, 6060 by default" },
+	ur::cl_var_ref{"--speed", cl::speed,						"--speed <value>					= replay that many times faster than captured, keeping proportions of gaps. 0 sends as fast as possible, 1 by default" },
+	ur::cl_var_ref{"--sockets", cl::sockets,					"--sockets <value>					= max local sockets distinct trace sources are spread over, 1024 by default" },
+	ur::cl_var_ref{"--bind-addr", cl::bindAddr,				"--bind-addr <value>				= local address sockets bind to, any by default" },
+	ur::cl_var_ref{"--bind-spread", cl::bindSpread,			"--bind-spread <value>				= spread sockets over that many consecutive ipv4 addresses starting from --bind-addr, 1 by default" },
+	ur::cl_var_ref{"--loops", cl::loops,						"--loops <value>					= replay trace that many times back to back, 1 by default" },
+};
+// clang-format on
+
+static std::atomic_bool g_running{true};
+
+static void replay_signal_handler(int sig)
+{
+	(void)sig;
+	g_running = false;
+}
+
+static void raise_fd_limit()
+{
+#if UR_PLATFORM_LINUX
+	rlimit limit{};
+	if (::getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+	{
+		limit.rlim_cur = limit.rlim_max;
+		::setrlimit(RLIMIT_NOFILE, &limit);
+	}
+#endif
+}
+
+// local sockets standing in for trace sources, created on first use
+class source_sockets
+{
+public:
+	source_sockets(const ur::net::socket_address& bindAddr, uint32_t bindSpread, uint32_t maxSockets)
+		: m_bindAddr{bindAddr}
+		, m_bindSpread{std::max<uint32_t>(bindSpread, 1)}
+		, m_maxSockets{std::max<uint32_t>(maxSockets, 1)}
+	{
+		m_sockets.reserve(m_maxSockets);
+	}
+
+	// socket for trace source, sources beyond socket limit share sockets round-robin
+	const ur::net::udpsocket* get(const ur::net::socket_address& source)
+	{
+		const uint32_t index = m_sourceIndex.try_emplace(source, uint32_t(m_sourceIndex.size())).first->second % m_maxSockets;
+		if (index < m_sockets.size())
+			return &m_sockets[index];
+
+		const bool bIpv6 = m_bindAddr.isIpv6();
+		auto bindAddr = m_bindAddr;
+		if (!bIpv6 && m_bindSpread > 1)
+			bindAddr = ur::net::socket_address::make_ipv4(ur::net::hton32(ur::net::ntoh32(ipv4Of(m_bindAddr)) + index % m_bindSpread), 0);
+
+		ur::net::udpsocket socket = ur::net::udpsocket::make(bIpv6);
+		if (!socket.isValid() || (bIpv6 && !socket.setOnlyIpv6(false)) || !socket.bind(bindAddr) || !socket.setNonBlocking(true))
+		{
+			LOG(Error, RelayReplay, "Failed to create socket {} bound to {}. Might be out of file descriptors or ports", index, bindAddr);
+			return nullptr;
+		}
+
+		m_sockets.push_back(std::move(socket));
+		return &m_sockets.back();
+	}
+
+	std::size_t getSources() const noexcept { return m_sourceIndex.size(); }
+
+	std::size_t getSockets() const noexcept { return m_sockets.size(); }
+
+private:
+	static uint32_t ipv4Of(const ur::net::socket_address& addr) noexcept
+	{
+		uint32_t ip{};
+		std::memcpy(&ip, addr.getRawIp().data(), sizeof(ip));
+		return ip;
+	}
+
+	ur::net::socket_address m_bindAddr{};
+
+	uint32_t m_bindSpread{};
+
+	uint32_t m_maxSockets{};
+
+	std::unordered_map<ur::net::socket_address, uint32_t> m_sourceIndex{};
+
+	// reserved upfront as get() hands out pointers
+	std::vector<ur::net::udpsocket> m_sockets{};
+};
+
+int main(int argc, char* argv[])
+{
+	ur_init();
+
+	std::signal(SIGINT, replay_signal_handler);
+	std::signal(SIGTERM, replay_signal_handler);
+
+	ur::parseArgs(argList, argc, argv);
+
+	if (cl::printHelp || cl::trace.empty())
+	{
+		ur::printArgsHelp(argList);
+		ur_shutdown();
+		return cl::printHelp ? 0 : 1;
+	}
+
+	if (cl::relayAddr.empty())
+		cl::relayAddr = "127.0.0.1";
+
+	auto relayAddr = ur::net::socket_address::from_string(cl::relayAddr);
+	relayAddr.setPort(cl::relayPort);
+	if (relayAddr.isNull())
+	{
+		LOG(Error, RelayReplay, "Invalid relay addr {}", cl::relayAddr);
+		ur_shutdown();
+		return 1;
+	}
+
+	auto bindAddr = relayAddr.isIpv6() ? ur::net::socket_address::make_ipv6(ur::net::anyIpv6(), 0) : ur::net::socket_address::make_ipv4(ur::net::anyIpv4(), 0);
+	if (!cl::bindAddr.empty())
+	{
+		bindAddr = ur::net::socket_address::from_string(cl::bindAddr);
+		if (bindAddr.isNull() || bindAddr.isIpv6() != relayAddr.isIpv6())
+		{
+			LOG(Error, RelayReplay, "Invalid bind addr {}", cl::bindAddr);
+			ur_shutdown();
+			return 1;
+		}
+	}
+
+	std::vector<ur::capture_record> records{};
+	if (!ur::read_capture(cl::trace, records) || records.empty())
+	{
+		LOG(Error, RelayReplay, "No udp datagrams to replay in {}", cl::trace);
+		ur_shutdown();
+		return 1;
+	}
+
+	const int64_t traceNs = records.back().m_timestampNs - records.front().m_timestampNs;
+	LOG(Info, RelayReplay, "Replaying {} datagrams spanning {:.3f} s to {} at {}x speed", records.size(), double(traceNs) / 1e9, relayAddr, cl::speed);
+
+	raise_fd_limit();
+
+	source_sockets sources(bindAddr, static_cast<uint32_t>(std::max(cl::bindSpread, 1)), static_cast<uint32_t>(std::max(cl::sockets, 1)));
+
+	// uncaptured part of payload is sent as zeroes so datagram keeps original size
+	std::array<std::byte, 1472> buffer{};
+
+	uint64_t sent{};
+	uint64_t sendFailures{};
+	uint64_t late{};
+	std::chrono::nanoseconds maxLag{};
+
+	const auto start = std::chrono::steady_clock::now();
+	for (int32_t loop = 0; loop < std::max(cl::loops, 1) && g_running; ++loop)
+	{
+		const auto loopStart = std::chrono::steady_clock::now();
+		for (const ur::capture_record& record : records)
+		{
+			if (!g_running)
+				break;
+
+			if (cl::speed > 0)
+			{
+				// gaps are kept relative to first datagram, so lag doesn't accumulate
+				const auto due = loopStart + std::chrono::nanoseconds((record.m_timestampNs - records.front().m_timestampNs) / cl::speed);
+				auto now = std::chrono::steady_clock::now();
+				if (due - now > 200us)
+				{
+					std::this_thread::sleep_until(due - 100us);
+					now = std::chrono::steady_clock::now();
+				}
+				while (now < due)
+					now = std::chrono::steady_clock::now();
+
+				const auto lag = now - due;
+				maxLag = std::max<std::chrono::nanoseconds>(maxLag, lag);
+				if (lag > 1ms)
+					++late;
+			}
+
+			const ur::net::udpsocket* socket = sources.get(record.m_source);
+			if (socket == nullptr)
+			{
+				g_running = false;
+				break;
+			}
+
+			const std::size_t size = std::min<std::size_t>(record.m_size, buffer.size());
+			const std::size_t captured = std::min(size, record.m_payload.size());
+			std::memcpy(buffer.data(), record.m_payload.data(), captured);
+			std::memset(buffer.data() + captured, 0, size - captured);
+
+			if (socket->sendTo(buffer.data(), size, relayAddr) == int32_t(size))
+				++sent;
+			else
+				++sendFailures;
+		}
+	}
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	const double tracePps = traceNs > 0 ? double(records.size()) * 1e9 / double(traceNs) : 0.;
+	LOG(Info, RelayReplay, "Sent {} datagrams from {} sources over {} sockets in {:.3f} s, {:.0f} pps (trace {:.0f} pps), {} send failures",
+		sent, sources.getSources(), sources.getSockets(), seconds, seconds > 0 ? double(sent) / seconds : 0., tracePps, sendFailures);
+	if (cl::speed > 0)
+		LOG(Info, RelayReplay, "Max lag behind trace {:.1f} us, {} datagrams over 1 ms late", double(maxLag.count()) / 1000., late);
+
+	ur_shutdown();
+
+	return 0;
+}
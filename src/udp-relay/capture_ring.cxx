@@ -0,0 +1,383 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include "udp-relay/capture_ring.hxx"
+
+#include "udp-relay/log.hxx"
+#include "udp-relay/net/network_utils.hxx"
+
+#if UR_PLATFORM_LINUX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	constexpr uint32_t pcapMagicNs = 0xA1B23C4D;
+	constexpr uint32_t pcapMagicUs = 0xA1B2C3D4;
+
+	constexpr uint32_t linkTypeEthernet = 1;
+	constexpr uint32_t linkTypeRaw = 101;
+	constexpr uint32_t linkTypeIpv4 = 228;
+	constexpr uint32_t linkTypeIpv6 = 229;
+
+	constexpr uint32_t recordHeaderSize = 16;
+	constexpr uint32_t ipv4HeaderSize = 20;
+	constexpr uint32_t ipv6HeaderSize = 40;
+	constexpr uint32_t udpHeaderSize = 8;
+	constexpr uint8_t protocolUdp = 17;
+
+	struct pcap_file_header
+	{
+		uint32_t m_magic{pcapMagicNs};
+		uint16_t m_versionMajor{2};
+		uint16_t m_versionMinor{4};
+		int32_t m_thisZone{};
+		uint32_t m_sigFigs{};
+		uint32_t m_snapLength{};
+		uint32_t m_linkType{linkTypeRaw};
+	};
+	static_assert(sizeof(pcap_file_header) == ur::capture_ring::fileHeaderSize);
+
+	struct pcap_record_header
+	{
+		uint32_t m_seconds{};
+		uint32_t m_fraction{}; // ns or us, depending on file magic
+		uint32_t m_capturedLength{};
+		uint32_t m_originalLength{};
+	};
+	static_assert(sizeof(pcap_record_header) == recordHeaderSize);
+
+	void putBe16(std::byte* out, uint16_t value) noexcept
+	{
+		out[0] = std::byte(value >> 8);
+		out[1] = std::byte(value);
+	}
+
+	uint16_t getBe16(const std::byte* in) noexcept
+	{
+		return uint16_t((uint16_t(in[0]) << 8) | uint16_t(in[1]));
+	}
+
+	uint16_t ipv4Checksum(const std::byte* header) noexcept
+	{
+		uint32_t sum{};
+		for (uint32_t i = 0; i < ipv4HeaderSize; i += 2)
+			sum += getBe16(header + i);
+		while (sum >> 16)
+			sum = (sum & 0xFFFF) + (sum >> 16);
+		return uint16_t(~sum);
+	}
+} // namespace
+
+ur::capture_ring::~capture_ring() noexcept
+{
+	close();
+}
+
+bool ur::capture_ring::open(const std::string& path, uint64_t size, uint32_t snapLength, uint32_t sampleEvery, uint16_t localPort)
+{
+	close();
+
+#if UR_PLATFORM_LINUX
+	const uint64_t blocks = size > fileHeaderSize ? (size - fileHeaderSize) / blockSize : 0;
+	if (blocks == 0)
+	{
+		LOG(Error, Capture, "Capture size {} is below single block of {} bytes", size, blockSize);
+		return false;
+	}
+
+	const int fd = ::open(path.c_str(), O_CREAT | O_RDWR | O_TRUNC | O_CLOEXEC, 0644);
+	const std::size_t fileSize = fileHeaderSize + blocks * blockSize;
+	if (fd == -1 || ::ftruncate(fd, static_cast<off_t>(fileSize)) != 0)
+	{
+		LOG(Error, Capture, "Failed to create capture file {}. Error code: {}", path, errno);
+		if (fd != -1)
+			::close(fd);
+		return false;
+	}
+
+	void* memory = ::mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (memory == MAP_FAILED)
+	{
+		LOG(Error, Capture, "Failed to map capture file {}. Error code: {}", path, errno);
+		return false;
+	}
+
+	m_data = static_cast<std::byte*>(memory);
+	m_size = fileSize;
+	m_snapLength = std::min<uint32_t>(snapLength, blockSize - recordHeaderSize * 2 - ipv6HeaderSize - udpHeaderSize);
+	m_sampleEvery = std::max<uint32_t>(sampleEvery, 1);
+	m_sampleCounter = 0;
+	m_localPort = localPort;
+	m_captured = 0;
+
+	pcap_file_header header{};
+	header.m_snapLength = ipv6HeaderSize + udpHeaderSize + m_snapLength;
+	std::memcpy(m_data, &header, sizeof(header));
+
+	// first call wraps to the first block
+	m_offset = m_size;
+	m_blockEnd = m_size;
+	nextBlock();
+
+	LOG(Info, Capture, "Capturing 1 of {} datagrams, {} bytes of each, to {} ({} blocks)", m_sampleEvery, m_snapLength, path, blocks);
+	return true;
+#else
+	(void)path;
+	(void)size;
+	(void)snapLength;
+	(void)sampleEvery;
+	(void)localPort;
+	LOG(Error, Capture, "Capture supported only on linux");
+	return false;
+#endif
+}
+
+void ur::capture_ring::close() noexcept
+{
+	if (m_data == nullptr)
+		return;
+
+#if UR_PLATFORM_LINUX
+	::munmap(m_data, m_size);
+#endif
+	m_data = nullptr;
+	m_size = 0;
+}
+
+void ur::capture_ring::write(std::span<const net::datagram> datagrams) noexcept
+{
+	// realtime clock like kernel timestamps, read once per batch and only if some datagram lacks timestamp
+	int64_t batchTime{};
+
+	for (const net::datagram& dgram : datagrams)
+	{
+		if (dgram.m_bytes < 0) [[unlikely]]
+			continue;
+
+		const uint32_t segmentSize = dgram.m_segmentSize ? dgram.m_segmentSize : uint32_t(dgram.m_bytes);
+		for (uint32_t offset = 0; offset < uint32_t(dgram.m_bytes) || offset == 0; offset += std::max<uint32_t>(segmentSize, 1))
+		{
+			if (++m_sampleCounter < m_sampleEvery)
+				continue;
+			m_sampleCounter = 0;
+
+			int64_t timestamp = dgram.m_rxTimestamp;
+			if (timestamp == 0)
+			{
+				if (batchTime == 0)
+					batchTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+				timestamp = batchTime;
+			}
+
+			const uint32_t bytes = std::min(segmentSize, uint32_t(dgram.m_bytes) - offset);
+			writeRecord(dgram.m_addr, static_cast<const std::byte*>(dgram.m_buffer) + offset, bytes, timestamp);
+		}
+	}
+}
+
+void ur::capture_ring::writeRecord(const net::socket_address& from, const std::byte* data, uint32_t bytes, int64_t timestampNs) noexcept
+{
+	const std::byte* const v4 = from.v4Bytes();
+	const bool ipv4 = v4 != nullptr;
+	const uint32_t ipHeaderSize = ipv4 ? ipv4HeaderSize : ipv6HeaderSize;
+	const uint32_t captured = std::min(bytes, m_snapLength);
+	const uint32_t recordSize = recordHeaderSize + ipHeaderSize + udpHeaderSize + captured;
+
+	// record either fills block exactly or leaves room for filler
+	const std::size_t remaining = m_blockEnd - m_offset;
+	if (recordSize != remaining && recordSize + recordHeaderSize > remaining)
+		nextBlock();
+
+	std::byte* out = m_data + m_offset;
+
+	pcap_record_header record{};
+	record.m_seconds = static_cast<uint32_t>(timestampNs / 1000000000);
+	record.m_fraction = static_cast<uint32_t>(timestampNs % 1000000000);
+	record.m_capturedLength = recordSize - recordHeaderSize;
+	record.m_originalLength = ipHeaderSize + udpHeaderSize + bytes;
+	std::memcpy(out, &record, sizeof(record));
+	out += sizeof(record);
+
+	const uint32_t udpLength = udpHeaderSize + bytes;
+	std::memset(out, 0, ipHeaderSize);
+	if (ipv4)
+	{
+		out[0] = std::byte{0x45};
+		putBe16(out + 2, uint16_t(std::min<uint32_t>(ipv4HeaderSize + udpLength, UINT16_MAX)));
+		out[6] = std::byte{0x40}; // don't fragment
+		out[8] = std::byte{64};
+		out[9] = std::byte{protocolUdp};
+		std::memcpy(out + 12, v4, 4);
+		putBe16(out + 10, ipv4Checksum(out));
+	}
+	else
+	{
+		out[0] = std::byte{0x60};
+		putBe16(out + 4, uint16_t(std::min<uint32_t>(udpLength, UINT16_MAX)));
+		out[6] = std::byte{protocolUdp};
+		out[7] = std::byte{64};
+		std::memcpy(out + 8, from.getRawIp().data(), 16);
+	}
+	out += ipHeaderSize;
+
+	// destination is relay's wildcard address, only port is known
+	putBe16(out, from.getPort());
+	putBe16(out + 2, m_localPort);
+	putBe16(out + 4, uint16_t(std::min<uint32_t>(udpLength, UINT16_MAX)));
+	putBe16(out + 6, 0);
+	out += udpHeaderSize;
+
+	std::memcpy(out, data, captured);
+
+	m_offset += recordSize;
+	++m_captured;
+}
+
+void ur::capture_ring::nextBlock() noexcept
+{
+	if (const std::size_t remaining = m_blockEnd - m_offset; remaining >= recordHeaderSize)
+	{
+		// zero timestamp tells readers it's filler, payload of zeros
+		pcap_record_header filler{};
+		filler.m_capturedLength = static_cast<uint32_t>(remaining - recordHeaderSize);
+		filler.m_originalLength = filler.m_capturedLength;
+		std::memcpy(m_data + m_offset, &filler, sizeof(filler));
+		std::memset(m_data + m_offset + recordHeaderSize, 0, remaining - recordHeaderSize);
+	}
+
+	m_offset = m_blockEnd < m_size ? m_blockEnd : fileHeaderSize;
+	m_blockEnd = m_offset + blockSize;
+
+	// zeroed tail marks where readers stop in block being written
+	std::memset(m_data + m_offset, 0, blockSize);
+}
+
+bool ur::read_capture(const std::string& path, std::vector<capture_record>& records)
+{
+	FILE* file = std::fopen(path.c_str(), "rb");
+	if (file == nullptr)
+		return false;
+
+	std::vector<std::byte> data{};
+	std::byte chunk[64 * 1024];
+	for (std::size_t read; (read = std::fread(chunk, 1, sizeof(chunk), file)) > 0;)
+		data.insert(data.end(), chunk, chunk + read);
+	std::fclose(file);
+
+	pcap_file_header header{};
+	if (data.size() < sizeof(header))
+		return false;
+	std::memcpy(&header, data.data(), sizeof(header));
+
+	const bool swapped = header.m_magic == std::byteswap(pcapMagicNs) || header.m_magic == std::byteswap(pcapMagicUs);
+	const auto host32 = [swapped](uint32_t value)
+	{
+		return swapped ? std::byteswap(value) : value;
+	};
+
+	const uint32_t magic = host32(header.m_magic);
+	if (magic != pcapMagicNs && magic != pcapMagicUs)
+		return false;
+
+	const int64_t fractionNs = magic == pcapMagicNs ? 1 : 1000;
+	const uint32_t linkType = host32(header.m_linkType);
+	if (linkType != linkTypeRaw && linkType != linkTypeIpv4 && linkType != linkTypeIpv6 && linkType != linkTypeEthernet)
+		return false;
+
+	const std::size_t firstRecords = records.size();
+	std::size_t offset = sizeof(header);
+	while (offset + recordHeaderSize <= data.size())
+	{
+		pcap_record_header record{};
+		std::memcpy(&record, data.data() + offset, sizeof(record));
+		record.m_seconds = host32(record.m_seconds);
+		record.m_fraction = host32(record.m_fraction);
+		record.m_capturedLength = host32(record.m_capturedLength);
+		record.m_originalLength = host32(record.m_originalLength);
+
+		// zeroed tail of capture_ring block being written, next record starts with next block
+		if (record.m_seconds == 0 && record.m_fraction == 0 && record.m_capturedLength == 0)
+		{
+			offset = capture_ring::fileHeaderSize + ((offset - capture_ring::fileHeaderSize) / capture_ring::blockSize + 1) * capture_ring::blockSize;
+			continue;
+		}
+
+		const std::byte* packet = data.data() + offset + recordHeaderSize;
+		offset += recordHeaderSize + record.m_capturedLength;
+		if (offset > data.size())
+			break;
+
+		// filler
+		if (record.m_seconds == 0 && record.m_fraction == 0)
+			continue;
+
+		uint32_t length = record.m_capturedLength;
+		if (linkType == linkTypeEthernet)
+		{
+			if (length < 14 || (getBe16(packet + 12) != 0x0800 && getBe16(packet + 12) != 0x86DD))
+				continue;
+			packet += 14;
+			length -= 14;
+		}
+
+		if (length == 0)
+			continue;
+
+		capture_record result{};
+		uint32_t ipHeaderLength{};
+		const uint8_t version = uint8_t(packet[0]) >> 4;
+		if (version == 4 && length >= ipv4HeaderSize)
+		{
+			ipHeaderLength = (uint32_t(packet[0]) & 0x0F) * 4;
+			if (uint8_t(packet[9]) != protocolUdp)
+				continue;
+
+			uint32_t ip{};
+			std::memcpy(&ip, packet + 12, sizeof(ip));
+			result.m_source = net::socket_address::make_ipv4(ip, 0);
+		}
+		else if (version == 6 && length >= ipv6HeaderSize)
+		{
+			ipHeaderLength = ipv6HeaderSize;
+			if (uint8_t(packet[6]) != protocolUdp)
+				continue;
+
+			std::array<std::byte, 16> ip{};
+			std::memcpy(ip.data(), packet + 8, ip.size());
+			result.m_source = net::socket_address::make_ipv6(ip, 0);
+		}
+		else
+		{
+			continue;
+		}
+
+		if (length < ipHeaderLength + udpHeaderSize)
+			continue;
+
+		const std::byte* udp = packet + ipHeaderLength;
+		result.m_source.setPort(getBe16(udp));
+		result.m_destPort = getBe16(udp + 2);
+		result.m_size = std::max<uint32_t>(getBe16(udp + 4), udpHeaderSize) - udpHeaderSize;
+		result.m_timestampNs = int64_t(record.m_seconds) * 1000000000 + int64_t(record.m_fraction) * fractionNs;
+
+		const uint32_t captured = std::min(length - ipHeaderLength - udpHeaderSize, result.m_size);
+		result.m_payload.assign(udp + udpHeaderSize, udp + udpHeaderSize + captured);
+		records.push_back(std::move(result));
+	}
+
+	// ring holds blocks in write order only within a lap
+	std::stable_sort(records.begin() + firstRecords, records.end(), [](const capture_record& left, const capture_record& right)
+		{ return left.m_timestampNs < right.m_timestampNs; });
+	return true;
+}
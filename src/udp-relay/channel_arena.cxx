@@ -0,0 +1,182 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include "udp-relay/channel_arena.hxx"
+
+#include "udp-relay/log.hxx"
+
+#if UR_PLATFORM_LINUX
+#include <sys/mman.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <new>
+
+namespace
+{
+	constexpr uint32_t defaultSlabShift = 12; // 4096 channels, 256KB
+	constexpr uint32_t hugePageSlabShift = 15; // 32768 channels, single 2MB huge page
+	constexpr size_t hugePageSize = size_t(1) << 21;
+
+	// zeroed page-aligned memory. hugePages is updated with whether memory is backed by huge pages
+	void* allocatePages(size_t size, bool& hugePages) noexcept
+	{
+#if UR_PLATFORM_LINUX
+		if (hugePages)
+		{
+			// reserved huge pages first, transparent ones otherwise
+			void* memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+			if (memory != MAP_FAILED)
+				return memory;
+
+			memory = ::mmap(nullptr, size + hugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (memory == MAP_FAILED) [[unlikely]]
+				return nullptr;
+
+			// trim mapping to 2MB boundary, so whole range can be folded into huge page
+			auto* const begin = static_cast<std::byte*>(memory);
+			auto* const aligned = reinterpret_cast<std::byte*>((reinterpret_cast<uintptr_t>(begin) + hugePageSize - 1) & ~(hugePageSize - 1));
+			if (aligned != begin)
+				::munmap(begin, aligned - begin);
+			if (const size_t tail = hugePageSize - (aligned - begin))
+				::munmap(aligned + size, tail);
+
+			hugePages = ::madvise(aligned, size, MADV_HUGEPAGE) == 0;
+			return aligned;
+		}
+
+		void* memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		return memory != MAP_FAILED ? memory : nullptr;
+#else
+		hugePages = false;
+		void* memory = ::operator new(size, std::align_val_t{64}, std::nothrow);
+		if (memory)
+			std::memset(memory, 0, size);
+		return memory;
+#endif
+	}
+
+	void freePages(void* memory, size_t size) noexcept
+	{
+#if UR_PLATFORM_LINUX
+		::munmap(memory, size);
+#else
+		(void)size;
+		::operator delete(memory, std::align_val_t{64});
+#endif
+	}
+} // namespace
+
+ur::channel_arena::~channel_arena() noexcept
+{
+	clear();
+}
+
+void ur::channel_arena::setHugePages(bool useHugePages) noexcept
+{
+	if (!m_slabs.empty())
+		return;
+
+	m_useHugePages = useHugePages && UR_PLATFORM_LINUX;
+	m_slabShift = m_useHugePages ? hugePageSlabShift : defaultSlabShift;
+}
+
+std::optional<ur::channel_handle> ur::channel_arena::allocate() noexcept
+{
+	if (m_freeHead == UINT32_MAX && !addSlab()) [[unlikely]]
+		return std::nullopt;
+
+	const uint32_t index = m_freeHead;
+	channel& ch = at(index);
+	m_freeHead = ch.m_lastUpdated;
+
+	const uint32_t generation = ch.m_generation + 1;
+	ch = channel{};
+	ch.m_generation = generation;
+	infoAt(index) = channel_info{};
+
+	++m_size;
+	return channel_handle{index, generation};
+}
+
+void ur::channel_arena::release(channel_handle handle) noexcept
+{
+	channel& ch = at(handle.m_index);
+	if (ch.m_generation != handle.m_generation) [[unlikely]]
+		return;
+
+	++ch.m_generation;
+	ch.m_lastUpdated = m_freeHead;
+	m_freeHead = handle.m_index;
+	--m_size;
+}
+
+void ur::channel_arena::foldCounters(uint32_t index) noexcept
+{
+	channel& ch = at(index);
+	channel_stats& stats = infoAt(index).m_stats;
+
+	stats.m_packetsReceived += ch.m_packetsReceived;
+	stats.m_bytesReceived += ch.m_bytesReceived;
+	stats.m_packetsSent += ch.m_packetsSent;
+	stats.m_bytesSent += ch.m_bytesSent;
+
+	ch.m_packetsReceived = 0;
+	ch.m_bytesReceived = 0;
+	ch.m_packetsSent = 0;
+	ch.m_bytesSent = 0;
+}
+
+size_t ur::channel_arena::reservedBytes() const noexcept
+{
+	const size_t slabChannels = size_t(1) << m_slabShift;
+	return m_slabs.size() * slabChannels * (sizeof(channel) + sizeof(channel_info));
+}
+
+void ur::channel_arena::clear() noexcept
+{
+	const size_t slabChannels = size_t(1) << m_slabShift;
+	for (const slab& s : m_slabs)
+	{
+		freePages(s.m_channels, slabChannels * sizeof(channel));
+		freePages(s.m_infos, slabChannels * sizeof(channel_info));
+	}
+	m_slabs.clear();
+	m_freeHead = UINT32_MAX;
+	m_size = 0;
+}
+
+bool ur::channel_arena::addSlab() noexcept
+{
+	const uint32_t slabChannels = 1U << m_slabShift;
+	if (m_slabs.size() >= (UINT32_MAX >> m_slabShift)) [[unlikely]]
+		return false;
+
+	bool hugePages = m_useHugePages;
+	void* const channels = allocatePages(slabChannels * sizeof(channel), hugePages);
+	bool infoHugePages = false;
+	void* const infos = channels ? allocatePages(slabChannels * sizeof(channel_info), infoHugePages) : nullptr;
+	if (infos == nullptr) [[unlikely]]
+	{
+		if (channels)
+			freePages(channels, slabChannels * sizeof(channel));
+		LOG(Error, ChannelArena, "Failed to allocate slab of {} channels. Error code: {}", slabChannels, errno);
+		return false;
+	}
+
+	slab& s = m_slabs.emplace_back(static_cast<channel*>(channels), static_cast<channel_info*>(infos));
+	std::uninitialized_value_construct_n(s.m_channels, slabChannels);
+	std::uninitialized_value_construct_n(s.m_infos, slabChannels);
+
+	// chain new slots in index order, in front of (empty) free list
+	const uint32_t firstIndex = static_cast<uint32_t>(m_slabs.size() - 1) << m_slabShift;
+	for (uint32_t i = 0; i < slabChannels; ++i)
+		s.m_channels[i].m_lastUpdated = i + 1 < slabChannels ? firstIndex + i + 1 : m_freeHead;
+	m_freeHead = firstIndex;
+
+	if (m_useHugePages && !hugePages && m_slabs.size() == 1)
+		LOG(Warning, ChannelArena, "Huge pages not available, channels use regular pages");
+
+	return true;
+}
@@ -0,0 +1,44 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include "udp-relay/channel_group.hxx"
+
+#include <algorithm>
+
+bool ur::channel_group::contains(const net::socket_address& addr) const noexcept
+{
+	return std::ranges::find(members(), addr) != members().end();
+}
+
+uint32_t ur::group_pool::allocate()
+{
+	uint32_t index = m_freeHead;
+	if (index != none)
+	{
+		m_freeHead = m_groups[index].m_nextFree;
+	}
+	else
+	{
+		index = static_cast<uint32_t>(m_groups.size());
+		m_groups.emplace_back();
+	}
+
+	m_groups[index].m_count = 0;
+	++m_size;
+	return index;
+}
+
+void ur::group_pool::release(uint32_t index) noexcept
+{
+	m_groups[index].m_count = 0;
+	m_groups[index].m_nextFree = m_freeHead;
+	m_freeHead = index;
+	--m_size;
+}
+
+void ur::group_pool::clear() noexcept
+{
+	m_groups.clear();
+	m_groups.shrink_to_fit();
+	m_freeHead = none;
+	m_size = 0;
+}
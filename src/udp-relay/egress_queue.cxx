@@ -0,0 +1,157 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include "udp-relay/egress_queue.hxx"
+
+#include <algorithm>
+#include <cstring>
+
+void ur::egress_queue::init(uint32_t capacity, uint32_t channelLimit, egress_drop_policy policy)
+{
+	m_chunks.clear();
+	m_channels.clear();
+	m_active.clear();
+	m_freeHead = none;
+	m_allocated = 0;
+	m_size = 0;
+	m_cursor = 0;
+
+	m_capacity = capacity;
+	m_channelLimit = std::clamp<uint32_t>(channelLimit, 1, std::max<uint32_t>(capacity, 1));
+	m_policy = policy;
+}
+
+ur::egress_push ur::egress_queue::push(uint32_t channel, const net::socket_address& to, const void* data, uint32_t bytes, int64_t rxTimestamp)
+{
+	if (m_capacity == 0 || bytes > maxDatagramSize) [[unlikely]]
+		return egress_push::Dropped;
+
+	if (channel >= m_channels.size())
+		m_channels.resize(channel + 1);
+
+	egress_push result = egress_push::Queued;
+	if (m_channels[channel].m_count >= m_channelLimit || m_size >= m_capacity)
+	{
+		// channel that has nothing queued doesn't take room of others
+		if (m_policy == egress_drop_policy::Tail || m_channels[channel].m_count == 0)
+			return egress_push::Dropped;
+
+		popHead(channel);
+		result = egress_push::QueuedDroppedOldest;
+	}
+
+	const uint32_t index = allocate();
+	if (index == none) [[unlikely]]
+		return egress_push::Dropped;
+
+	entry& e = at(index);
+	e.m_addr = to;
+	e.m_rxTimestamp = rxTimestamp;
+	e.m_next = none;
+	e.m_bytes = bytes;
+	std::memcpy(e.m_data.data(), data, bytes);
+
+	channel_queue& queue = m_channels[channel];
+	if (queue.m_count == 0)
+	{
+		queue.m_head = index;
+		queue.m_activeIndex = static_cast<uint32_t>(m_active.size());
+		m_active.push_back(channel);
+	}
+	else
+	{
+		at(queue.m_tail).m_next = index;
+	}
+	queue.m_tail = index;
+	++queue.m_count;
+	++m_size;
+
+	return result;
+}
+
+std::size_t ur::egress_queue::peek(std::span<net::datagram> datagrams, std::span<uint32_t> channels) noexcept
+{
+	const std::size_t limit = std::min(datagrams.size(), channels.size());
+	if (m_active.empty() || limit == 0)
+		return 0;
+
+	const std::size_t share = std::max<std::size_t>(limit / m_active.size(), 1);
+	m_cursor = m_cursor < m_active.size() ? m_cursor : 0;
+
+	std::size_t count = 0;
+	for (std::size_t i = 0; i < m_active.size() && count < limit; ++i)
+	{
+		const uint32_t channel = m_active[(m_cursor + i) % m_active.size()];
+		uint32_t index = m_channels[channel].m_head;
+		for (std::size_t taken = 0; taken < share && index != none && count < limit; ++taken, ++count)
+		{
+			entry& e = at(index);
+			datagrams[count].m_buffer = e.m_data.data();
+			datagrams[count].m_bufferSize = e.m_bytes;
+			datagrams[count].m_addr = e.m_addr;
+			datagrams[count].m_segmentSize = 0;
+			datagrams[count].m_rxTimestamp = e.m_rxTimestamp;
+			channels[count] = channel;
+			index = e.m_next;
+		}
+	}
+
+	++m_cursor;
+	return count;
+}
+
+void ur::egress_queue::consume(std::span<const uint32_t> channels) noexcept
+{
+	// datagrams of each channel were peeked oldest first, so each one is at head of its queue by now
+	for (const uint32_t channel : channels)
+		popHead(channel);
+}
+
+uint32_t ur::egress_queue::purge(uint32_t channel) noexcept
+{
+	if (channel >= m_channels.size())
+		return 0;
+
+	const uint32_t dropped = m_channels[channel].m_count;
+	while (m_channels[channel].m_count)
+		popHead(channel);
+	return dropped;
+}
+
+uint32_t ur::egress_queue::allocate()
+{
+	if (m_freeHead != none)
+	{
+		const uint32_t index = m_freeHead;
+		m_freeHead = at(index).m_next;
+		return index;
+	}
+
+	if (m_allocated >= m_capacity)
+		return none;
+
+	if (m_allocated % chunkSize == 0)
+		m_chunks.push_back(std::make_unique_for_overwrite<entry[]>(chunkSize));
+	return m_allocated++;
+}
+
+void ur::egress_queue::popHead(uint32_t channel) noexcept
+{
+	channel_queue& queue = m_channels[channel];
+	const uint32_t index = queue.m_head;
+
+	entry& e = at(index);
+	queue.m_head = e.m_next;
+	e.m_next = m_freeHead;
+	m_freeHead = index;
+	--m_size;
+
+	if (--queue.m_count != 0)
+		return;
+
+	// swap channel out of active list
+	queue.m_tail = none;
+	const uint32_t moved = m_active.back();
+	m_active[queue.m_activeIndex] = moved;
+	m_channels[moved].m_activeIndex = queue.m_activeIndex;
+	m_active.pop_back();
+}
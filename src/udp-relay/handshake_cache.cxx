@@ -0,0 +1,49 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include "udp-relay/handshake_cache.hxx"
+
+#include "udp-relay/hash.hxx"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+void ur::handshake_cache::init(size_t entries)
+{
+	m_sets.clear();
+	if (entries == 0)
+		return;
+
+	const size_t setCount = std::bit_ceil((entries + ways - 1) / ways);
+	m_sets = std::vector<set>(setCount);
+}
+
+bool ur::handshake_cache::contains(const net::socket_address& addr, const hmac_sha256& mac, const void* packet, size_t size) const noexcept
+{
+	if (!canCache(size))
+		return false;
+
+	const set& s = m_sets[setIndex(addr, mac)];
+	return std::any_of(s.cbegin(), s.cend(), [&](const entry& e)
+		{ return e.m_size == size && e.m_addr == addr && std::memcmp(e.m_packet.data(), packet, size) == 0; });
+}
+
+void ur::handshake_cache::insert(const net::socket_address& addr, const hmac_sha256& mac, const void* packet, size_t size) noexcept
+{
+	if (!canCache(size))
+		return;
+
+	entry e{};
+	e.m_addr = addr;
+	e.m_size = static_cast<uint16_t>(size);
+	std::memcpy(e.m_packet.data(), packet, size);
+	m_sets[setIndex(addr, mac)].assign(e);
+}
+
+size_t ur::handshake_cache::setIndex(const net::socket_address& addr, const hmac_sha256& mac) const noexcept
+{
+	// mac is already uniform, any 8 bytes of it mix well with address
+	uint64_t macWord{};
+	std::memcpy(&macWord, mac.data(), sizeof(macWord));
+	return hash_mix(addr.hash(), macWord) & (m_sets.size() - 1);
+}
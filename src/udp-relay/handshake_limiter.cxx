@@ -0,0 +1,114 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include "udp-relay/handshake_limiter.hxx"
+
+#include "udp-relay/hash.hxx"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	constexpr std::array<uint64_t, ur::handshake_limiter::depth> rowConstants{
+		0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL, 0x165667B19E3779F9ULL, 0x27D4EB2F165667C5ULL};
+
+	constexpr uint64_t prefixTag = 0x5F0A6C3D91B2E847ULL; // keeps prefix keys apart from address ones
+} // namespace
+
+void ur::handshake_limiter::init(uint32_t addressRate, uint32_t prefixRate, uint32_t nowMs)
+{
+	// single handshake takes 1/rate of second from bucket
+	m_addressCost = addressRate ? std::max<uint32_t>(unitsPerSecond / addressRate, 1) : 0;
+	m_prefixCost = prefixRate ? std::max<uint32_t>(unitsPerSecond / prefixRate, 1) : 0;
+	m_lastLeakMs = nowMs;
+
+	// sources are spoofable, cells of victim must not be known in advance
+	m_seed = hash_seed();
+	for (uint32_t row = 0; row < depth; ++row)
+		m_rowSeeds[row] = hash_mix(m_seed, rowConstants[row]);
+
+	if (isEnabled())
+		m_sketch.assign(size_t(depth) * width, 0);
+	else
+		m_sketch.clear();
+}
+
+bool ur::handshake_limiter::admit(const net::socket_address& addr, uint32_t nowMs) noexcept
+{
+	if (!isEnabled())
+		return true;
+
+	leak(nowMs);
+
+	cells addressCells{};
+	cells prefixCells{};
+	const uint32_t addressDebt = m_addressCost ? locate(hash_mix(addr.hash(), m_seed), addressCells) : 0;
+	const uint32_t prefixDebt = m_prefixCost ? locate(prefixKey(addr), prefixCells) : 0;
+
+	if (addressDebt + m_addressCost > capacity || prefixDebt + m_prefixCost > capacity)
+		return false;
+
+	// conservative update: raise only cells below new estimate, keeps overestimation of colliding sources low
+	if (m_addressCost)
+	{
+		for (uint32_t* cell : addressCells)
+			*cell = std::max(*cell, addressDebt + m_addressCost);
+	}
+	if (m_prefixCost)
+	{
+		for (uint32_t* cell : prefixCells)
+			*cell = std::max(*cell, prefixDebt + m_prefixCost);
+	}
+	return true;
+}
+
+uint32_t ur::handshake_limiter::locate(uint64_t key, cells& outCells) noexcept
+{
+	uint32_t smallest = UINT32_MAX;
+	for (uint32_t row = 0; row < depth; ++row)
+	{
+		uint32_t& cell = m_sketch[size_t(row) * width + (hash_mix(key, m_rowSeeds[row]) & (width - 1))];
+		outCells[row] = &cell;
+		smallest = std::min(smallest, cell);
+	}
+	return smallest;
+}
+
+void ur::handshake_limiter::leak(uint32_t nowMs) noexcept
+{
+	const uint32_t elapsedMs = nowMs - m_lastLeakMs;
+	if (elapsedMs < leakIntervalMs)
+		return;
+
+	m_lastLeakMs = nowMs;
+
+	// every bucket is empty after full burst window
+	const uint64_t paid = uint64_t(elapsedMs) * unitsPerSecond / 1000;
+	if (paid >= capacity)
+	{
+		std::fill(m_sketch.begin(), m_sketch.end(), 0);
+		return;
+	}
+
+	const uint32_t amount = static_cast<uint32_t>(paid);
+	for (uint32_t& cell : m_sketch)
+		cell = cell > amount ? cell - amount : 0;
+}
+
+uint64_t ur::handshake_limiter::prefixKey(const net::socket_address& addr) const noexcept
+{
+	// /24 of ipv4 and v4-mapped addresses, /64 of ipv6 ones
+	uint64_t prefix{};
+	uint64_t tag = prefixTag;
+	if (const std::byte* v4 = addr.v4Bytes())
+	{
+		std::memcpy(&prefix, v4, 3);
+	}
+	else
+	{
+		std::memcpy(&prefix, addr.getRawIp().data(), sizeof(prefix));
+		tag += 1;
+	}
+
+	return hash_mix(tag ^ m_seed, prefix);
+}
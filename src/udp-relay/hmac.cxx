@@ -0,0 +1,100 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include "udp-relay/hmac.hxx"
+
+#include "udp-relay/log.hxx"
+
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/params.h>
+
+#include <utility>
+
+namespace
+{
+	constexpr std::array<unsigned char, sizeof(ur::hmac_sha256)> zeroMac{};
+} // namespace
+
+ur::hmac_verifier::hmac_verifier(hmac_verifier&& other) noexcept
+	: m_ctx{std::exchange(other.m_ctx, nullptr)}
+{
+}
+
+ur::hmac_verifier& ur::hmac_verifier::operator=(hmac_verifier&& other) noexcept
+{
+	if (this != &other)
+	{
+		reset();
+		m_ctx = std::exchange(other.m_ctx, nullptr);
+	}
+	return *this;
+}
+
+ur::hmac_verifier::~hmac_verifier() noexcept
+{
+	reset();
+}
+
+bool ur::hmac_verifier::init(const secret_key& key) noexcept
+{
+	reset();
+	if (key.empty())
+		return true;
+
+	EVP_MAC* mac = EVP_MAC_fetch(nullptr, OSSL_MAC_NAME_HMAC, nullptr);
+	if (mac == nullptr) [[unlikely]]
+	{
+		LOG(Error, Hmac, "Failed to fetch HMAC implementation");
+		return false;
+	}
+
+	m_ctx = EVP_MAC_CTX_new(mac);
+	EVP_MAC_free(mac); // context holds own reference
+
+	char digest[] = "SHA256";
+	const OSSL_PARAM params[] = {
+		OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest, 0),
+		OSSL_PARAM_construct_end()};
+
+	if (m_ctx == nullptr || EVP_MAC_init(m_ctx, reinterpret_cast<const unsigned char*>(key.data()), key.size(), params) != 1) [[unlikely]]
+	{
+		LOG(Error, Hmac, "Failed to initialize HMAC_sha256 key schedule");
+		reset();
+		return false;
+	}
+	return true;
+}
+
+bool ur::hmac_verifier::compute(const void* data, size_t dataSize, size_t macOffset, hmac_sha256& outMac) noexcept
+{
+	if (m_ctx == nullptr || macOffset > dataSize || dataSize - macOffset < sizeof(hmac_sha256)) [[unlikely]]
+		return false;
+
+	const auto* const bytes = static_cast<const unsigned char*>(data);
+	const size_t suffixOffset = macOffset + sizeof(hmac_sha256);
+
+	// null key restarts from digest states prepared by init
+	size_t macLen{};
+	const bool ok = EVP_MAC_init(m_ctx, nullptr, 0, nullptr) == 1 &&
+					EVP_MAC_update(m_ctx, bytes, macOffset) == 1 &&
+					EVP_MAC_update(m_ctx, zeroMac.data(), zeroMac.size()) == 1 &&
+					EVP_MAC_update(m_ctx, bytes + suffixOffset, dataSize - suffixOffset) == 1 &&
+					EVP_MAC_final(m_ctx, reinterpret_cast<unsigned char*>(outMac.data()), &macLen, outMac.size()) == 1;
+
+	return ok && macLen == sizeof(hmac_sha256);
+}
+
+bool ur::hmac_verifier::verify(const void* data, size_t dataSize, size_t macOffset, const hmac_sha256& expected) noexcept
+{
+	hmac_sha256 mac;
+	if (!compute(data, dataSize, macOffset, mac)) [[unlikely]]
+		return false;
+	return CRYPTO_memcmp(mac.data(), expected.data(), mac.size()) == 0;
+}
+
+void ur::hmac_verifier::reset() noexcept
+{
+	EVP_MAC_CTX_free(m_ctx);
+	m_ctx = nullptr;
+}
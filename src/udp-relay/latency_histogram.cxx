@@ -0,0 +1,62 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include "udp-relay/latency_histogram.hxx"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+void ur::latency_histogram::merge(const latency_histogram& other) noexcept
+{
+	for (std::size_t i = 0; i < bucketCount; ++i)
+		m_counts[i] += other.m_counts[i];
+	m_count += other.m_count;
+	m_max = std::max(m_max, other.m_max);
+}
+
+void ur::latency_histogram::reset() noexcept
+{
+	m_counts.fill(0);
+	m_count = 0;
+	m_max = 0;
+}
+
+uint64_t ur::latency_histogram::percentile(double percent) const noexcept
+{
+	if (m_count == 0)
+		return 0;
+
+	const double clamped = std::clamp(percent, 0., 100.);
+	const uint64_t rank = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(clamped / 100. * double(m_count))), 1);
+
+	uint64_t seen{};
+	for (std::size_t i = 0; i < bucketCount; ++i)
+	{
+		seen += m_counts[i];
+		if (seen >= rank)
+			return std::min(highestOf(i), m_max);
+	}
+	return m_max;
+}
+
+std::size_t ur::latency_histogram::indexOf(uint64_t value) noexcept
+{
+	if (value < subBuckets)
+		return static_cast<std::size_t>(value);
+
+	// value in [2^exponent, 2^(exponent + 1)), split in subBuckets buckets of 2^(exponent - subBucketBits) width
+	value = std::min(value, maxValue);
+	const uint32_t exponent = static_cast<uint32_t>(std::bit_width(value)) - 1;
+	const uint32_t shift = exponent - subBucketBits;
+	return static_cast<std::size_t>(shift) * subBuckets + static_cast<std::size_t>(value >> shift);
+}
+
+uint64_t ur::latency_histogram::highestOf(std::size_t index) noexcept
+{
+	if (index < 2 * subBuckets)
+		return index;
+
+	const uint32_t shift = static_cast<uint32_t>(index / subBuckets) - 1;
+	const uint64_t lowest = uint64_t(index % subBuckets + subBuckets) << shift;
+	return lowest + (uint64_t(1) << shift) - 1;
+}
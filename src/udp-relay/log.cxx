@@ -0,0 +1,258 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include "udp-relay/log.hxx"
+
+#include "udp-relay/spsc_ring.hxx"
+
+#include <condition_variable>
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+std::atomic<ur::log_level> ur::runtime_log_verbosity{ur::log_level::Info};
+
+namespace
+{
+	constexpr std::size_t queueCapacity = 4096; // records per logging thread, 1MB
+	constexpr auto writeInterval = 10ms;		 // how often logging thread wakes up on its own
+
+	// queue of single thread that logs
+	struct log_producer
+	{
+		ur::spsc_ring<ur::log_record, queueCapacity> m_queue{};
+		std::atomic<uint64_t> m_dropped{};
+		std::atomic_bool m_retired{}; // owning thread exited, queue is released once drained
+	};
+
+	class log_backend final
+	{
+	public:
+		~log_backend()
+		{
+			stop();
+		}
+
+		log_producer* registerProducer()
+		{
+			auto producer = std::make_unique<log_producer>();
+			log_producer* const result = producer.get();
+
+			std::lock_guard lock(m_mutex);
+			m_producers.push_back(std::move(producer));
+			startLocked();
+			return result;
+		}
+
+		// true while logging thread is running
+		bool isRunning() const noexcept { return m_running.load(std::memory_order_relaxed); }
+
+		void start()
+		{
+			std::lock_guard lock(m_mutex);
+			startLocked();
+		}
+
+		void requestFlush() noexcept
+		{
+			m_flushRequested.store(true, std::memory_order_relaxed);
+			m_wakeup.notify_one();
+		}
+
+		void stop()
+		{
+			std::lock_guard stopLock(m_stopMutex);
+			{
+				std::lock_guard lock(m_mutex);
+				m_stopRequested = true;
+			}
+			m_wakeup.notify_one();
+			if (m_thread.joinable())
+				m_thread.join();
+			m_running.store(false, std::memory_order_relaxed);
+		}
+
+		uint64_t dropped() const noexcept { return m_dropped.load(std::memory_order_relaxed); }
+
+	private:
+		void startLocked()
+		{
+			if (m_running.load(std::memory_order_relaxed))
+				return;
+
+			if (m_thread.joinable()) // stopped, but not joined yet
+				return;
+
+			m_stopRequested = false;
+			m_running.store(true, std::memory_order_relaxed);
+			m_thread = std::thread(&log_backend::run, this);
+		}
+
+		void run()
+		{
+			std::string output{};
+			std::vector<log_producer*> producers{};
+			uint64_t reportedDropped{};
+
+			for (bool stopping = false; !stopping;)
+			{
+				{
+					std::unique_lock lock(m_mutex);
+					m_wakeup.wait_for(lock, writeInterval, [this]
+						{ return m_stopRequested || m_flushRequested.load(std::memory_order_relaxed); });
+					stopping = m_stopRequested;
+
+					// queues of exited threads are released once nothing is left in them
+					std::erase_if(m_producers, [this](const std::unique_ptr<log_producer>& producer)
+						{
+							if (!producer->m_retired.load(std::memory_order_acquire) || !producer->m_queue.empty())
+								return false;
+							m_droppedRetired += producer->m_dropped.load(std::memory_order_relaxed);
+							return true;
+						});
+
+					producers.clear();
+					for (const auto& producer : m_producers)
+						producers.push_back(producer.get());
+				}
+
+				uint64_t dropped = m_droppedRetired;
+				for (log_producer* producer : producers)
+				{
+					drain(*producer, output);
+					dropped += producer->m_dropped.load(std::memory_order_relaxed);
+				}
+
+				if (dropped > reportedDropped)
+				{
+					const auto now = std::chrono::system_clock::now();
+					appendPrefix(output, now, "Log", ur::log_level::Warning);
+					output += std::format("{} records dropped, logging can't keep up", dropped - reportedDropped);
+					output += '\n';
+					reportedDropped = dropped;
+				}
+				m_dropped.store(dropped, std::memory_order_relaxed);
+
+				if (!output.empty())
+				{
+					std::fwrite(output.data(), 1, output.size(), stdout);
+					output.clear();
+				}
+
+				if (m_flushRequested.exchange(false, std::memory_order_relaxed) || stopping)
+					std::fflush(stdout);
+			}
+		}
+
+		static void drain(log_producer& producer, std::string& output)
+		{
+			std::size_t count = 0;
+			while (const ur::log_record* record = producer.m_queue.peek(count))
+			{
+				appendPrefix(output, record->m_time, record->m_category, record->m_level);
+				try
+				{
+					record->m_format(*record, output);
+				}
+				catch (const std::exception& e)
+				{
+					output += std::format("<{}: \"{}\">", e.what(), record->m_formatString);
+				}
+				output += '\n';
+
+				// release slots in chunks, so producer doesn't wait for whole queue
+				if (++count == queueCapacity / 4)
+				{
+					producer.m_queue.pop(count);
+					count = 0;
+				}
+			}
+			producer.m_queue.pop(count);
+		}
+
+		static void appendPrefix(std::string& output, std::chrono::system_clock::time_point time, std::string_view category, ur::log_level level)
+		{
+			const auto utcTime = std::chrono::utc_clock::from_sys(time);
+			const std::string_view levelStr = ur::log_level_to_string(level);
+			output += std::vformat("[{0:%F}T{0:%T}] {1}: {2}: ", std::make_format_args(utcTime, category, levelStr));
+		}
+
+		std::mutex m_mutex{}; // guards m_producers, m_thread start & m_stopRequested
+
+		std::mutex m_stopMutex{}; // serializes stop() calls
+
+		std::condition_variable m_wakeup{};
+
+		std::vector<std::unique_ptr<log_producer>> m_producers{};
+
+		std::thread m_thread{};
+
+		bool m_stopRequested{};
+
+		std::atomic_bool m_flushRequested{};
+
+		std::atomic_bool m_running{};
+
+		std::atomic<uint64_t> m_dropped{};
+
+		uint64_t m_droppedRetired{}; // dropped by queues already released
+	};
+
+	log_backend& backend()
+	{
+		static log_backend instance{};
+		return instance;
+	}
+
+	// calling thread's queue, registered with first record it logs
+	struct log_producer_ref
+	{
+		~log_producer_ref()
+		{
+			if (m_producer)
+				m_producer->m_retired.store(true, std::memory_order_release);
+		}
+
+		log_producer* m_producer{};
+	};
+
+	thread_local log_producer_ref t_producer{};
+} // namespace
+
+ur::log_record* ur::log_acquire() noexcept
+{
+	log_producer*& producer = t_producer.m_producer;
+	if (producer == nullptr) [[unlikely]]
+		producer = backend().registerProducer();
+	else if (!backend().isRunning()) [[unlikely]]
+		backend().start();
+
+	log_record* const record = producer->m_queue.producerSlot();
+	if (record == nullptr) [[unlikely]]
+		producer->m_dropped.fetch_add(1, std::memory_order_relaxed);
+	return record;
+}
+
+void ur::log_commit() noexcept
+{
+	t_producer.m_producer->m_queue.push();
+}
+
+void ur::log_flush() noexcept
+{
+	backend().requestFlush();
+}
+
+void ur::log_shutdown() noexcept
+{
+	backend().stop();
+}
+
+uint64_t ur::log_dropped() noexcept
+{
+	return backend().dropped();
+}
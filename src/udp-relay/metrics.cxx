@@ -0,0 +1,236 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include "udp-relay/metrics.hxx"
+
+#include "udp-relay/log.hxx"
+
+#if UR_PLATFORM_LINUX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <memory>
+#include <new>
+
+namespace
+{
+	struct metric_desc
+	{
+		std::string_view m_name;
+		std::string_view m_type;
+		std::string_view m_help;
+		std::atomic<uint64_t> ur::worker_metrics::* m_value;
+	};
+
+	// clang-format off
+	constexpr metric_desc metricList[]
+	{
+		{"udp_relay_packets_received_total", "counter", "Datagrams received, GRO segments counted separately", &ur::worker_metrics::m_packetsIn},
+		{"udp_relay_bytes_received_total", "counter", "Bytes received", &ur::worker_metrics::m_bytesIn},
+		{"udp_relay_recv_dropped_total", "counter", "Datagrams dropped by kernel as receive buffer was full", &ur::worker_metrics::m_recvDropped},
+		{"udp_relay_packets_sent_total", "counter", "Datagrams sent, GSO segments counted separately", &ur::worker_metrics::m_packetsOut},
+		{"udp_relay_bytes_sent_total", "counter", "Bytes sent", &ur::worker_metrics::m_bytesOut},
+		{"udp_relay_send_failures_total", "counter", "Datagrams failed to send", &ur::worker_metrics::m_sendFailures},
+		{"udp_relay_send_eagain_total", "counter", "Send calls stopped by full socket buffer", &ur::worker_metrics::m_sendEagain},
+		{"udp_relay_egress_queued_total", "counter", "Datagrams queued as socket send buffer was full", &ur::worker_metrics::m_egressQueued},
+		{"udp_relay_egress_dropped_total", "counter", "Datagrams egress queue had no room for", &ur::worker_metrics::m_egressDropped},
+		{"udp_relay_egress_depth", "gauge", "Datagrams waiting in egress queue", &ur::worker_metrics::m_egressDepth},
+		{"udp_relay_handshakes_valid_total", "counter", "Handshakes accepted", &ur::worker_metrics::m_handshakesValid},
+		{"udp_relay_handshakes_invalid_total", "counter", "Handshakes failed HMAC validation", &ur::worker_metrics::m_handshakesInvalid},
+		{"udp_relay_handshakes_shed_total", "counter", "Handshakes dropped by rate limit", &ur::worker_metrics::m_handshakesShed},
+		{"udp_relay_channels_pending", "gauge", "Channels waiting for second peer", &ur::worker_metrics::m_channelsPending},
+		{"udp_relay_channels_established", "gauge", "Channels with both peers", &ur::worker_metrics::m_channelsEstablished},
+		{"udp_relay_channels_expired_total", "counter", "Channels closed after inactivity", &ur::worker_metrics::m_channelsExpired},
+		{"udp_relay_relay_ports", "gauge", "Dedicated relay ports allocated to channels", &ur::worker_metrics::m_relayPorts},
+		{"udp_relay_relay_ports_exhausted_total", "counter", "Dedicated relay port requests refused as none was left", &ur::worker_metrics::m_relayPortsExhausted},
+		{"udp_relay_loop_iterations_total", "counter", "Iterations of worker loop", &ur::worker_metrics::m_loopIterations},
+		{"udp_relay_loop_work_nanoseconds_total", "counter", "Loop time spent receiving & forwarding, busy latency modes only", &ur::worker_metrics::m_loopWorkNs},
+		{"udp_relay_loop_spin_nanoseconds_total", "counter", "Loop time spent spinning without traffic, busy latency modes only", &ur::worker_metrics::m_loopSpinNs},
+		{"udp_relay_loop_sleep_nanoseconds_total", "counter", "Loop time spent blocked waiting for traffic, busy latency modes only", &ur::worker_metrics::m_loopSleepNs},
+		{"udp_relay_send_batches_total", "counter", "Send calls", &ur::worker_metrics::m_sendBatches},
+	};
+	// clang-format on
+
+	// header takes first cache line, so every worker block starts on own one
+	constexpr std::size_t headerSize = sizeof(ur::worker_metrics);
+	static_assert(sizeof(ur::metrics_header) <= headerSize);
+
+	std::size_t segmentSize(uint32_t workers) noexcept
+	{
+		return headerSize + size_t(workers) * sizeof(ur::worker_metrics);
+	}
+} // namespace
+
+ur::metrics_segment::~metrics_segment() noexcept
+{
+	reset();
+}
+
+bool ur::metrics_segment::create(uint16_t port, uint32_t workers, bool shared)
+{
+	reset();
+
+	const std::size_t size = segmentSize(workers);
+	void* memory = nullptr;
+
+#if UR_PLATFORM_LINUX
+	if (shared)
+	{
+		const std::string name = nameOf(port);
+		const int fd = ::shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+		if (fd == -1 || ::ftruncate(fd, 0) != 0 || ::ftruncate(fd, static_cast<off_t>(size)) != 0)
+		{
+			LOG(Error, Metrics, "Failed to create shared memory {}. Error code: {}", name, errno);
+			if (fd != -1)
+				::close(fd);
+			return false;
+		}
+
+		memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (memory == MAP_FAILED)
+		{
+			LOG(Error, Metrics, "Failed to map shared memory {}. Error code: {}", name, errno);
+			::shm_unlink(name.c_str());
+			return false;
+		}
+		m_sharedName = name;
+		m_mapped = true;
+	}
+#else
+	if (shared)
+		LOG(Warning, Metrics, "Shared memory metrics supported only on linux");
+#endif
+
+	if (memory == nullptr)
+	{
+		memory = ::operator new(size, std::align_val_t{alignof(worker_metrics)}, std::nothrow);
+		if (memory == nullptr)
+			return false;
+		std::memset(memory, 0, size);
+	}
+
+	m_size = size;
+	m_workers = reinterpret_cast<worker_metrics*>(static_cast<std::byte*>(memory) + headerSize);
+	for (uint32_t i = 0; i < workers; ++i)
+		new (m_workers + i) worker_metrics{};
+	m_header = new (memory) metrics_header{};
+	m_header->m_workerSize = sizeof(worker_metrics);
+	m_header->m_workers = workers;
+	m_header->m_port = port;
+	m_header->m_startTime = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	m_header->m_version = metrics_header::version;
+	std::atomic_ref(m_header->m_magic).store(metrics_header::magic, std::memory_order_release);
+	return true;
+}
+
+bool ur::metrics_segment::open(uint16_t port)
+{
+	reset();
+
+#if UR_PLATFORM_LINUX
+	const std::string name = nameOf(port);
+	const int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+	if (fd == -1)
+		return false;
+
+	struct stat st{};
+	void* memory = MAP_FAILED;
+	if (::fstat(fd, &st) == 0 && size_t(st.st_size) >= segmentSize(0))
+		memory = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (memory == MAP_FAILED)
+		return false;
+
+	m_header = static_cast<metrics_header*>(memory);
+	m_workers = reinterpret_cast<worker_metrics*>(static_cast<std::byte*>(memory) + headerSize);
+	m_size = st.st_size;
+	m_mapped = true;
+
+	const bool compatible = std::atomic_ref(m_header->m_magic).load(std::memory_order_acquire) == metrics_header::magic &&
+							m_header->m_version == metrics_header::version &&
+							m_header->m_workerSize == sizeof(worker_metrics) &&
+							segmentSize(m_header->m_workers) <= m_size;
+	if (!compatible)
+	{
+		reset();
+		return false;
+	}
+	return true;
+#else
+	(void)port;
+	return false;
+#endif
+}
+
+std::string ur::metrics_segment::nameOf(uint16_t port)
+{
+	return std::format("/udp-relay-{}", port);
+}
+
+void ur::metrics_segment::reset() noexcept
+{
+	if (m_header == nullptr)
+		return;
+
+#if UR_PLATFORM_LINUX
+	if (m_mapped)
+	{
+		::munmap(m_header, m_size);
+		if (!m_sharedName.empty())
+			::shm_unlink(m_sharedName.c_str());
+	}
+	else
+#endif
+	{
+		::operator delete(m_header, std::align_val_t{alignof(worker_metrics)});
+	}
+
+	m_header = nullptr;
+	m_workers = nullptr;
+	m_size = 0;
+	m_sharedName.clear();
+	m_mapped = false;
+}
+
+void ur::metrics_to_prometheus(const metrics_segment& segment, std::string& out)
+{
+	const metrics_header& header = segment.header();
+	const auto load = [](const std::atomic<uint64_t>& metric)
+	{
+		return metric.load(std::memory_order_relaxed);
+	};
+
+	for (const metric_desc& desc : metricList)
+	{
+		out += std::format("# HELP {} {}\n# TYPE {} {}\n", desc.m_name, desc.m_help, desc.m_name, desc.m_type);
+		for (uint32_t i = 0; i < header.m_workers; ++i)
+			out += std::format("{}{{port=\"{}\",worker=\"{}\"}} {}\n", desc.m_name, header.m_port, i, load(segment.worker(i).*desc.m_value));
+	}
+
+	constexpr std::string_view batchName = "udp_relay_recv_batch_size";
+	out += std::format("# HELP {} Datagrams returned by single receive call\n# TYPE {} histogram\n", batchName, batchName);
+	for (uint32_t i = 0; i < header.m_workers; ++i)
+	{
+		const worker_metrics& metrics = segment.worker(i);
+
+		uint64_t cumulative{};
+		for (size_t bucket = 0; bucket < worker_metrics::batchBuckets; ++bucket)
+		{
+			cumulative += load(metrics.m_recvBatchSizes[bucket]);
+			out += std::format("{}_bucket{{port=\"{}\",worker=\"{}\",le=\"{}\"}} {}\n", batchName, header.m_port, i, 1U << bucket, cumulative);
+		}
+		out += std::format("{}_bucket{{port=\"{}\",worker=\"{}\",le=\"+Inf\"}} {}\n", batchName, header.m_port, i, cumulative);
+		out += std::format("{}_sum{{port=\"{}\",worker=\"{}\"}} {}\n", batchName, header.m_port, i, load(metrics.m_recvBatchDatagrams));
+		out += std::format("{}_count{{port=\"{}\",worker=\"{}\"}} {}\n", batchName, header.m_port, i, cumulative);
+	}
+
+	out += std::format("# HELP udp_relay_start_time_seconds Relay start time since unix epoch\n# TYPE udp_relay_start_time_seconds gauge\n");
+	out += std::format("udp_relay_start_time_seconds{{port=\"{}\"}} {}\n", header.m_port, header.m_startTime);
+}
@@ -0,0 +1,266 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include "udp-relay/net/event_loop.hxx"
+
+#include "udp-relay/log.hxx"
+
+#if UR_PLATFORM_WINDOWS
+#include <WinSock2.h>
+#elif UR_PLATFORM_LINUX
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+
+using namespace std::chrono_literals;
+
+ur::net::event_loop::event_loop() noexcept = default;
+
+ur::net::event_loop::~event_loop() noexcept
+{
+#if UR_PLATFORM_LINUX
+	if (m_epoll != -1)
+		::close(m_epoll);
+	if (m_wakeupFd != -1)
+		::close(m_wakeupFd);
+#endif
+}
+
+bool ur::net::event_loop::init() noexcept
+{
+#if UR_PLATFORM_LINUX
+	if (m_epoll != -1)
+		::close(m_epoll);
+	if (m_wakeupFd != -1)
+		::close(m_wakeupFd);
+	m_wakeupFd = -1;
+
+	m_epoll = ::epoll_create1(EPOLL_CLOEXEC);
+	if (m_epoll == -1) [[unlikely]]
+	{
+		LOG(Error, EventLoop, "Failed to create epoll. Error code: {0}", errno);
+		return false;
+	}
+#else
+	m_registrations.clear();
+	m_initialized = true;
+#endif
+	m_timers.clear();
+	return true;
+}
+
+bool ur::net::event_loop::isValid() const noexcept
+{
+#if UR_PLATFORM_LINUX
+	return m_epoll != -1;
+#else
+	return m_initialized;
+#endif
+}
+
+bool ur::net::event_loop::add(const udpsocket& socket, void* userData) noexcept
+{
+#if UR_PLATFORM_LINUX
+	epoll_event ev{};
+	ev.events = EPOLLIN | EPOLLET;
+	ev.data.ptr = userData;
+	return ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, socket.getNativeSocket(), &ev) == 0;
+#else
+	if (m_registrations.size() >= FD_SETSIZE)
+		return false;
+	m_registrations.push_back(registration{socket.getNativeSocket(), userData, false});
+	return true;
+#endif
+}
+
+bool ur::net::event_loop::remove(const udpsocket& socket) noexcept
+{
+#if UR_PLATFORM_LINUX
+	return ::epoll_ctl(m_epoll, EPOLL_CTL_DEL, socket.getNativeSocket(), nullptr) == 0;
+#else
+	return std::erase_if(m_registrations, [native = socket.getNativeSocket()](const registration& reg)
+			   { return reg.m_socket == native; }) != 0;
+#endif
+}
+
+bool ur::net::event_loop::setWantWrite(const udpsocket& socket, void* userData, bool wantWrite) noexcept
+{
+#if UR_PLATFORM_LINUX
+	epoll_event ev{};
+	ev.events = EPOLLIN | EPOLLET | (wantWrite ? uint32_t(EPOLLOUT) : 0U);
+	ev.data.ptr = userData;
+	return ::epoll_ctl(m_epoll, EPOLL_CTL_MOD, socket.getNativeSocket(), &ev) == 0;
+#else
+	for (auto& reg : m_registrations)
+	{
+		if (reg.m_socket == socket.getNativeSocket())
+		{
+			reg.m_userData = userData;
+			reg.m_wantWrite = wantWrite;
+			return true;
+		}
+	}
+	return false;
+#endif
+}
+
+bool ur::net::event_loop::enableWakeup() noexcept
+{
+#if UR_PLATFORM_LINUX
+	if (m_wakeupFd != -1)
+		return true;
+
+	m_wakeupFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (m_wakeupFd == -1) [[unlikely]]
+		return false;
+
+	epoll_event ev{};
+	ev.events = EPOLLIN | EPOLLET;
+	ev.data.ptr = &m_wakeupFd;
+	return ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeupFd, &ev) == 0;
+#else
+	return false;
+#endif
+}
+
+void ur::net::event_loop::wakeup() noexcept
+{
+#if UR_PLATFORM_LINUX
+	if (m_wakeupFd != -1)
+	{
+		const uint64_t value = 1;
+		[[maybe_unused]] const auto res = ::write(m_wakeupFd, &value, sizeof(value));
+	}
+#endif
+}
+
+uint64_t ur::net::event_loop::addTimer(std::chrono::steady_clock::time_point deadline, void* userData)
+{
+	const uint64_t id = m_nextTimerId++;
+	m_timers.push_back(timer{deadline, id, userData});
+	return id;
+}
+
+void ur::net::event_loop::cancelTimer(uint64_t id) noexcept
+{
+	std::erase_if(m_timers, [id](const timer& t)
+		{ return t.m_id == id; });
+}
+
+int32_t ur::net::event_loop::collectTimers(std::span<event> events, std::chrono::steady_clock::time_point now) noexcept
+{
+	int32_t count = 0;
+	for (auto it = m_timers.begin(); it != m_timers.end() && size_t(count) < events.size();)
+	{
+		if (it->m_deadline <= now)
+		{
+			events[count++] = event{it->m_userData, event_flags::Timer};
+			it = m_timers.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+	return count;
+}
+
+int32_t ur::net::event_loop::wait(std::span<event> events, std::chrono::microseconds timeout) noexcept
+{
+	if (events.empty()) [[unlikely]]
+		return 0;
+
+	const auto now = std::chrono::steady_clock::now();
+	int32_t count = collectTimers(events, now);
+
+	// don't sleep past nearest timer, neither when timers already fired
+	if (count)
+	{
+		timeout = 0us;
+	}
+	else if (!m_timers.empty())
+	{
+		const auto nearest = std::min_element(m_timers.begin(), m_timers.end(), [](const timer& a, const timer& b)
+			{ return a.m_deadline < b.m_deadline; });
+		timeout = std::min(timeout, std::chrono::ceil<std::chrono::microseconds>(nearest->m_deadline - now));
+	}
+
+	const auto socketEvents = events.subspan(count);
+	if (socketEvents.empty())
+		return count;
+
+#if UR_PLATFORM_LINUX
+	std::array<epoll_event, 64> nativeEvents;
+	const int maxEvents = static_cast<int>(std::min(socketEvents.size(), nativeEvents.size()));
+	const int timeoutMs = static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(timeout).count());
+
+	const int res = ::epoll_wait(m_epoll, nativeEvents.data(), maxEvents, timeoutMs);
+	if (res < 0 && errno != EINTR) [[unlikely]]
+		return -1;
+
+	for (int i = 0; i < res; ++i)
+	{
+		if (nativeEvents[i].data.ptr == &m_wakeupFd)
+		{
+			uint64_t value{};
+			[[maybe_unused]] const auto readRes = ::read(m_wakeupFd, &value, sizeof(value));
+			socketEvents[i] = event{nullptr, event_flags::Wakeup};
+			continue;
+		}
+
+		uint32_t flags{};
+		if (nativeEvents[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+			flags |= event_flags::Readable;
+		if (nativeEvents[i].events & EPOLLOUT)
+			flags |= event_flags::Writable;
+		socketEvents[i] = event{nativeEvents[i].data.ptr, flags};
+	}
+	count += std::max(res, 0);
+#else
+	fd_set readSet;
+	fd_set writeSet;
+	FD_ZERO(&readSet);
+	FD_ZERO(&writeSet);
+
+	udpsocket::socket_t maxSocket{};
+	for (const auto& reg : m_registrations)
+	{
+		FD_SET(reg.m_socket, &readSet);
+		if (reg.m_wantWrite)
+			FD_SET(reg.m_socket, &writeSet);
+		maxSocket = std::max(maxSocket, reg.m_socket);
+	}
+
+	timeval time;
+	time.tv_sec = static_cast<long>(timeout.count() / 1000000);
+	time.tv_usec = static_cast<long>(timeout.count() % 1000000);
+
+	const auto selectRes = ::select(static_cast<int>(maxSocket + 1), &readSet, &writeSet, NULL, &time);
+	if (selectRes < 0) [[unlikely]]
+		return -1;
+
+	for (const auto& reg : m_registrations)
+	{
+		if (size_t(count) == events.size())
+			break;
+
+		uint32_t flags{};
+		if (FD_ISSET(reg.m_socket, &readSet))
+			flags |= event_flags::Readable;
+		if (FD_ISSET(reg.m_socket, &writeSet))
+			flags |= event_flags::Writable;
+		if (flags)
+			events[count++] = event{reg.m_userData, flags};
+	}
+#endif
+
+	// timers that became due while waiting
+	if (size_t(count) < events.size())
+		count += collectTimers(events.subspan(count), std::chrono::steady_clock::now());
+
+	return count;
+}
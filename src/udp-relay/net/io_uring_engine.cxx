@@ -0,0 +1,501 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include "udp-relay/net/io_uring_engine.hxx"
+
+#include "udp-relay/log.hxx"
+
+#if UR_HAS_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#if UR_HAS_IO_URING
+
+namespace
+{
+	enum : uint64_t
+	{
+		OpRecv = 1,
+		OpSend = 2,
+	};
+
+	constexpr uint64_t makeUserData(uint64_t op, uint32_t bufferId) { return (op << 32) | bufferId; }
+	constexpr uint64_t userDataOp(uint64_t userData) { return userData >> 32; }
+	constexpr uint32_t userDataBuffer(uint64_t userData) { return static_cast<uint32_t>(userData); }
+
+	constexpr uint16_t bufferGroupId = 0;
+
+	int io_uring_setup(uint32_t entries, io_uring_params* params) { return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params)); }
+
+	int io_uring_enter(int fd, uint32_t toSubmit, uint32_t minComplete, uint32_t flags, const void* arg, size_t argSize)
+	{
+		return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argSize));
+	}
+
+	int io_uring_register(int fd, uint32_t opcode, const void* arg, uint32_t nrArgs) { return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs)); }
+
+	template <typename T>
+	T* offsetPtr(void* base, uint32_t offset) { return reinterpret_cast<T*>(static_cast<std::byte*>(base) + offset); }
+} // namespace
+
+struct ur::net::io_uring_engine::state
+{
+	~state()
+	{
+		if (m_buffers)
+			::munmap(m_buffers, m_buffersSize);
+		if (m_bufRing)
+			::munmap(m_bufRing, m_bufRingSize);
+		if (m_sqes)
+			::munmap(m_sqes, m_sqesSize);
+		if (m_cqRing && m_cqRing != m_sqRing)
+			::munmap(m_cqRing, m_cqRingSize);
+		if (m_sqRing)
+			::munmap(m_sqRing, m_sqRingSize);
+		if (m_ringFd >= 0)
+			::close(m_ringFd);
+	}
+
+	// next free submission entry, flushing queue to kernel when full
+	io_uring_sqe* getSqe()
+	{
+		const uint32_t head = std::atomic_ref(*m_sqHead).load(std::memory_order_acquire);
+		if (m_sqTail - head >= m_sqEntries && !submit())
+			return nullptr;
+
+		io_uring_sqe* sqe = &m_sqes[m_sqTail & m_sqMask];
+		std::memset(sqe, 0, sizeof(io_uring_sqe));
+		++m_sqTail;
+		++m_sqPending;
+		return sqe;
+	}
+
+	// flush queued submissions without waiting
+	bool submit()
+	{
+		std::atomic_ref(*m_sqTailShared).store(m_sqTail, std::memory_order_release);
+		const int res = io_uring_enter(m_ringFd, m_sqPending, 0, IORING_ENTER_GETEVENTS, nullptr, 0);
+		if (res < 0)
+			return false;
+		m_sqPending -= res;
+		return true;
+	}
+
+	void armRecv()
+	{
+		io_uring_sqe* sqe = getSqe();
+		if (sqe == nullptr) [[unlikely]]
+			return;
+
+		sqe->opcode = IORING_OP_RECVMSG;
+		sqe->fd = 0; // index in registered files
+		sqe->flags = IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT;
+		sqe->ioprio = IORING_RECV_MULTISHOT;
+		sqe->addr = reinterpret_cast<uint64_t>(&m_recvMsg);
+		sqe->len = 1;
+		sqe->buf_group = bufferGroupId;
+		sqe->user_data = makeUserData(OpRecv, 0);
+		m_recvArmed = true;
+	}
+
+	std::byte* bufferAt(uint32_t bufferId) const { return m_buffers + size_t(bufferId) * m_bufferStride; }
+
+	uint32_t bufferIdOf(const void* ptr) const { return static_cast<uint32_t>((static_cast<const std::byte*>(ptr) - m_buffers) / m_bufferStride); }
+
+	// hand buffer back to kernel, visible after publishBuffers()
+	void recycleBuffer(uint32_t bufferId)
+	{
+		// ring entries are addressed manually: flexible array member in uapi header is offset when compiled as C++
+		io_uring_buf& buf = reinterpret_cast<io_uring_buf*>(m_bufRing)[m_bufTail & m_bufMask];
+		buf.addr = reinterpret_cast<uint64_t>(bufferAt(bufferId));
+		buf.len = m_bufferStride;
+		buf.bid = static_cast<uint16_t>(bufferId);
+		++m_bufTail;
+	}
+
+	void publishBuffers()
+	{
+		std::atomic_ref(m_bufRing->tail).store(m_bufTail, std::memory_order_release);
+	}
+
+	int m_ringFd{-1};
+	bool m_started{}; // enabled by thread running the engine
+
+	void* m_sqRing{};
+	size_t m_sqRingSize{};
+	void* m_cqRing{};
+	size_t m_cqRingSize{};
+	io_uring_sqe* m_sqes{};
+	size_t m_sqesSize{};
+
+	uint32_t* m_sqHead{};
+	uint32_t* m_sqTailShared{};
+	uint32_t m_sqMask{};
+	uint32_t m_sqEntries{};
+	uint32_t m_sqTail{};
+	uint32_t m_sqPending{};
+
+	uint32_t* m_cqHead{};
+	uint32_t* m_cqTail{};
+	uint32_t m_cqMask{};
+	io_uring_cqe* m_cqes{};
+
+	io_uring_buf_ring* m_bufRing{};
+	size_t m_bufRingSize{};
+	uint16_t m_bufMask{};
+	uint16_t m_bufTail{};
+
+	std::byte* m_buffers{};
+	size_t m_buffersSize{};
+	uint32_t m_bufferStride{}; // recvmsg header, sender address and payload
+	uint32_t m_payloadOffset{};
+	uint32_t m_payloadSize{};
+
+	msghdr m_recvMsg{};
+	bool m_recvArmed{};
+
+	// per-buffer send state, must stay alive until send completion
+	std::vector<msghdr> m_sendMsgs{};
+	std::vector<iovec> m_sendIovs{};
+	std::vector<sockaddr_storage> m_sendAddrs{};
+
+	uint64_t m_sendFailures{};
+};
+
+#else
+
+struct ur::net::io_uring_engine::state
+{
+};
+
+#endif
+
+ur::net::io_uring_engine::io_uring_engine() noexcept = default;
+
+ur::net::io_uring_engine::~io_uring_engine() noexcept = default;
+
+bool ur::net::io_uring_engine::isCompiledIn() noexcept
+{
+	return UR_HAS_IO_URING;
+}
+
+bool ur::net::io_uring_engine::init(const udpsocket& socket, uint32_t bufferCount, uint32_t bufferSize) noexcept
+{
+#if UR_HAS_IO_URING
+	shutdown();
+
+	if (!socket.isValid() || !std::has_single_bit(bufferCount) || bufferCount > 32768)
+	{
+		LOG(Error, IoUring, "Invalid init arguments. Buffer count must be power of 2 and not exceed 32768");
+		return false;
+	}
+
+	auto newState = std::make_unique<state>();
+	state& s = *newState;
+
+	const uint32_t sqEntries = 256;
+
+	// ring starts disabled, single issuer becomes the thread that enables it in start(), not the one running init()
+	io_uring_params params{};
+	params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_R_DISABLED | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN;
+	params.cq_entries = std::max(sqEntries * 4, bufferCount * 2);
+	s.m_ringFd = io_uring_setup(sqEntries, &params);
+	if (s.m_ringFd < 0 && errno == EINVAL)
+	{
+		// older kernels don't know about single issuer and cooperative task running
+		params = io_uring_params{};
+		params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_R_DISABLED;
+		params.cq_entries = std::max(sqEntries * 4, bufferCount * 2);
+		s.m_ringFd = io_uring_setup(sqEntries, &params);
+	}
+
+	if (s.m_ringFd < 0)
+	{
+		LOG(Error, IoUring, "io_uring_setup failed. Error code: {}", errno);
+		return false;
+	}
+
+	if (!(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_SINGLE_MMAP))
+	{
+		LOG(Error, IoUring, "Kernel io_uring lacks required features");
+		return false;
+	}
+
+	s.m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+	s.m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	s.m_sqRingSize = s.m_cqRingSize = std::max(s.m_sqRingSize, s.m_cqRingSize);
+	s.m_sqRing = ::mmap(nullptr, s.m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, s.m_ringFd, IORING_OFF_SQ_RING);
+	if (s.m_sqRing == MAP_FAILED)
+	{
+		s.m_sqRing = nullptr;
+		LOG(Error, IoUring, "Failed to map rings. Error code: {}", errno);
+		return false;
+	}
+	s.m_cqRing = s.m_sqRing;
+
+	s.m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+	void* sqes = ::mmap(nullptr, s.m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, s.m_ringFd, IORING_OFF_SQES);
+	if (sqes == MAP_FAILED)
+	{
+		LOG(Error, IoUring, "Failed to map submission entries. Error code: {}", errno);
+		return false;
+	}
+	s.m_sqes = static_cast<io_uring_sqe*>(sqes);
+
+	s.m_sqHead = offsetPtr<uint32_t>(s.m_sqRing, params.sq_off.head);
+	s.m_sqTailShared = offsetPtr<uint32_t>(s.m_sqRing, params.sq_off.tail);
+	s.m_sqMask = *offsetPtr<uint32_t>(s.m_sqRing, params.sq_off.ring_mask);
+	s.m_sqEntries = params.sq_entries;
+	s.m_sqTail = *s.m_sqTailShared;
+
+	// identity mapping between submission array and entries
+	uint32_t* sqArray = offsetPtr<uint32_t>(s.m_sqRing, params.sq_off.array);
+	for (uint32_t i = 0; i < params.sq_entries; ++i)
+		sqArray[i] = i;
+
+	s.m_cqHead = offsetPtr<uint32_t>(s.m_cqRing, params.cq_off.head);
+	s.m_cqTail = offsetPtr<uint32_t>(s.m_cqRing, params.cq_off.tail);
+	s.m_cqMask = *offsetPtr<uint32_t>(s.m_cqRing, params.cq_off.ring_mask);
+	s.m_cqes = offsetPtr<io_uring_cqe>(s.m_cqRing, params.cq_off.cqes);
+
+	const int socketFd = socket.getNativeSocket();
+	if (io_uring_register(s.m_ringFd, IORING_REGISTER_FILES, &socketFd, 1) < 0)
+	{
+		LOG(Error, IoUring, "Failed to register socket. Error code: {}", errno);
+		return false;
+	}
+
+	// sender address goes into buffer head, followed by payload
+	s.m_recvMsg.msg_namelen = sizeof(sockaddr_storage);
+	s.m_recvMsg.msg_controllen = 0;
+
+	s.m_payloadOffset = sizeof(io_uring_recvmsg_out) + s.m_recvMsg.msg_namelen + s.m_recvMsg.msg_controllen;
+	s.m_payloadSize = bufferSize;
+	s.m_bufferStride = (s.m_payloadOffset + bufferSize + 63) & ~63U;
+	s.m_buffersSize = size_t(bufferCount) * s.m_bufferStride;
+	void* buffers = ::mmap(nullptr, s.m_buffersSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buffers == MAP_FAILED)
+	{
+		LOG(Error, IoUring, "Failed to allocate {} buffers", bufferCount);
+		return false;
+	}
+	s.m_buffers = static_cast<std::byte*>(buffers);
+
+	s.m_bufRingSize = bufferCount * sizeof(io_uring_buf);
+	void* bufRing = ::mmap(nullptr, s.m_bufRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (bufRing == MAP_FAILED)
+	{
+		LOG(Error, IoUring, "Failed to allocate buffer ring");
+		return false;
+	}
+	s.m_bufRing = static_cast<io_uring_buf_ring*>(bufRing);
+	s.m_bufMask = static_cast<uint16_t>(bufferCount - 1);
+
+	io_uring_buf_reg bufReg{};
+	bufReg.ring_addr = reinterpret_cast<uint64_t>(s.m_bufRing);
+	bufReg.ring_entries = bufferCount;
+	bufReg.bgid = bufferGroupId;
+	if (io_uring_register(s.m_ringFd, IORING_REGISTER_PBUF_RING, &bufReg, 1) < 0)
+	{
+		LOG(Error, IoUring, "Failed to register provided buffer ring. Error code: {}", errno);
+		return false;
+	}
+
+	for (uint32_t i = 0; i < bufferCount; ++i)
+		s.recycleBuffer(i);
+	s.publishBuffers();
+
+	s.m_sendMsgs.resize(bufferCount);
+	s.m_sendIovs.resize(bufferCount);
+	s.m_sendAddrs.resize(bufferCount);
+
+	m_state = std::move(newState);
+	return true;
+#else
+	(void)socket;
+	(void)bufferCount;
+	(void)bufferSize;
+	return false;
+#endif
+}
+
+bool ur::net::io_uring_engine::start() noexcept
+{
+#if UR_HAS_IO_URING
+	if (!m_state)
+		return false;
+
+	state& s = *m_state;
+	if (s.m_started)
+		return true;
+
+	if (io_uring_register(s.m_ringFd, IORING_REGISTER_ENABLE_RINGS, nullptr, 0) < 0)
+	{
+		LOG(Error, IoUring, "Failed to enable ring. Error code: {}", errno);
+		return false;
+	}
+
+	s.armRecv();
+	if (!s.submit())
+	{
+		LOG(Error, IoUring, "Failed to submit multishot receive. Error code: {}", errno);
+		return false;
+	}
+
+	s.m_started = true;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void ur::net::io_uring_engine::shutdown() noexcept
+{
+	m_state.reset();
+}
+
+bool ur::net::io_uring_engine::isValid() const noexcept
+{
+	return m_state != nullptr;
+}
+
+int32_t ur::net::io_uring_engine::recvBatch(std::span<datagram> datagrams, std::chrono::microseconds timeout) noexcept
+{
+#if UR_HAS_IO_URING
+	state& s = *m_state;
+
+	if (!s.m_recvArmed)
+		s.armRecv();
+
+	const bool hasCompletions = *s.m_cqHead != std::atomic_ref(*s.m_cqTail).load(std::memory_order_acquire);
+	if (!hasCompletions || s.m_sqPending)
+	{
+		std::atomic_ref(*s.m_sqTailShared).store(s.m_sqTail, std::memory_order_release);
+
+		__kernel_timespec ts{};
+		ts.tv_sec = timeout.count() / 1000000;
+		ts.tv_nsec = (timeout.count() % 1000000) * 1000;
+
+		io_uring_getevents_arg arg{};
+		arg.ts = reinterpret_cast<uint64_t>(&ts);
+
+		const uint32_t minComplete = hasCompletions ? 0 : 1;
+		const int res = io_uring_enter(s.m_ringFd, s.m_sqPending, minComplete, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+		if (res < 0 && errno != ETIME && errno != EINTR && errno != EBUSY) [[unlikely]]
+			return -1;
+		if (res > 0)
+			s.m_sqPending -= res;
+	}
+
+	int32_t received = 0;
+	uint32_t head = *s.m_cqHead;
+	const uint32_t tail = std::atomic_ref(*s.m_cqTail).load(std::memory_order_acquire);
+	for (; head != tail && size_t(received) < datagrams.size(); ++head)
+	{
+		const io_uring_cqe& cqe = s.m_cqes[head & s.m_cqMask];
+		const uint64_t op = userDataOp(cqe.user_data);
+		if (op == OpRecv)
+		{
+			if (!(cqe.flags & IORING_CQE_F_MORE))
+				s.m_recvArmed = false; // multishot terminated, most likely ran out of buffers. Re-armed on next call
+
+			if (cqe.res < 0 || !(cqe.flags & IORING_CQE_F_BUFFER))
+				continue;
+
+			const uint32_t bufferId = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+			std::byte* buffer = s.bufferAt(bufferId);
+			const auto* out = reinterpret_cast<const io_uring_recvmsg_out*>(buffer);
+
+			datagram& dgram = datagrams[received++];
+			dgram.m_buffer = buffer + s.m_payloadOffset;
+			dgram.m_bufferSize = s.m_payloadSize;
+			dgram.m_bytes = (out->flags & MSG_TRUNC) || out->payloadlen > s.m_payloadSize ? -1 : static_cast<int32_t>(out->payloadlen);
+			dgram.m_addr.copyFromNative(*reinterpret_cast<const sockaddr_storage*>(buffer + sizeof(io_uring_recvmsg_out)));
+		}
+		else if (op == OpSend)
+		{
+			if (cqe.res < 0) [[unlikely]]
+				++s.m_sendFailures;
+			s.recycleBuffer(userDataBuffer(cqe.user_data));
+		}
+	}
+	std::atomic_ref(*s.m_cqHead).store(head, std::memory_order_release);
+
+	s.publishBuffers();
+
+	return received;
+#else
+	(void)datagrams;
+	(void)timeout;
+	return -1;
+#endif
+}
+
+void ur::net::io_uring_engine::send(const datagram& dgram, uint32_t bytes, const socket_address& addr) noexcept
+{
+#if UR_HAS_IO_URING
+	state& s = *m_state;
+
+	const uint32_t bufferId = s.bufferIdOf(dgram.m_buffer);
+
+	io_uring_sqe* sqe = s.getSqe();
+	if (sqe == nullptr) [[unlikely]]
+	{
+		++s.m_sendFailures;
+		s.recycleBuffer(bufferId);
+		s.publishBuffers();
+		return;
+	}
+
+	addr.copyToNative(s.m_sendAddrs[bufferId]);
+	s.m_sendIovs[bufferId] = iovec{dgram.m_buffer, bytes};
+
+	msghdr& msg = s.m_sendMsgs[bufferId];
+	msg = msghdr{};
+	msg.msg_name = &s.m_sendAddrs[bufferId];
+	msg.msg_namelen = sizeof(sockaddr_storage);
+	msg.msg_iov = &s.m_sendIovs[bufferId];
+	msg.msg_iovlen = 1;
+
+	sqe->opcode = IORING_OP_SENDMSG;
+	sqe->fd = 0; // index in registered files
+	sqe->flags = IOSQE_FIXED_FILE;
+	sqe->addr = reinterpret_cast<uint64_t>(&msg);
+	sqe->len = 1;
+	sqe->user_data = makeUserData(OpSend, bufferId);
+#else
+	(void)dgram;
+	(void)bytes;
+	(void)addr;
+#endif
+}
+
+void ur::net::io_uring_engine::release(const datagram& dgram) noexcept
+{
+#if UR_HAS_IO_URING
+	state& s = *m_state;
+	s.recycleBuffer(s.bufferIdOf(dgram.m_buffer));
+	s.publishBuffers();
+#else
+	(void)dgram;
+#endif
+}
+
+uint64_t ur::net::io_uring_engine::getSendFailures() const noexcept
+{
+#if UR_HAS_IO_URING
+	return m_state ? m_state->m_sendFailures : 0;
+#else
+	return 0;
+#endif
+}
@@ -0,0 +1,92 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include "udp-relay/net/memory_transport.hxx"
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+
+ur::net::memory_transport::memory_transport(std::size_t capacity, uint16_t port)
+	: m_inbound(std::bit_ceil(std::max<std::size_t>(capacity, 1)))
+	, m_outbound(m_inbound.size())
+	, m_mask(m_inbound.size() - 1)
+	, m_port(port)
+{
+}
+
+bool ur::net::memory_transport::push(const socket_address& from, const void* data, std::size_t size) noexcept
+{
+	if (size > maxDatagramSize || pendingReceive() == m_inbound.size()) [[unlikely]]
+		return false;
+
+	slot& entry = m_inbound[m_inboundTail & m_mask];
+	entry.m_addr = from;
+	entry.m_bytes = static_cast<uint32_t>(size);
+	std::memcpy(entry.m_data.data(), data, size);
+	++m_inboundTail;
+	return true;
+}
+
+const ur::net::memory_transport::slot* ur::net::memory_transport::front() const noexcept
+{
+	return pendingSent() ? &m_outbound[m_outboundHead & m_mask] : nullptr;
+}
+
+void ur::net::memory_transport::pop() noexcept
+{
+	if (pendingSent())
+		++m_outboundHead;
+}
+
+int32_t ur::net::memory_transport::recvBatch(std::span<datagram> datagrams) noexcept
+{
+	int32_t received{};
+	for (datagram& dgram : datagrams)
+	{
+		if (m_inboundHead == m_inboundTail)
+			break;
+
+		const slot& entry = m_inbound[m_inboundHead & m_mask];
+		const uint32_t bytes = std::min(entry.m_bytes, dgram.m_bufferSize);
+		std::memcpy(dgram.m_buffer, entry.m_data.data(), bytes);
+		dgram.m_bytes = static_cast<int32_t>(bytes);
+		dgram.m_addr = entry.m_addr;
+		dgram.m_segmentSize = 0;
+		dgram.m_rxTimestamp = 0;
+		++m_inboundHead;
+		++received;
+	}
+	return received;
+}
+
+int32_t ur::net::memory_transport::sendBatch(std::span<datagram> datagrams) noexcept
+{
+	int32_t sent{};
+	for (datagram& dgram : datagrams)
+	{
+		// behave as socket with full send buffer
+		if (dgram.m_bufferSize > maxDatagramSize || (!m_discardSent && pendingSent() == m_outbound.size())) [[unlikely]]
+		{
+			dgram.m_bytes = -1;
+			++m_sendDropped;
+			errno = EAGAIN;
+			continue;
+		}
+
+		if (!m_discardSent)
+		{
+			slot& entry = m_outbound[m_outboundTail & m_mask];
+			entry.m_addr = dgram.m_addr;
+			entry.m_bytes = dgram.m_bufferSize;
+			std::memcpy(entry.m_data.data(), dgram.m_buffer, dgram.m_bufferSize);
+			++m_outboundTail;
+		}
+
+		dgram.m_bytes = static_cast<int32_t>(dgram.m_bufferSize);
+		++m_sentDatagrams;
+		m_sentBytes += dgram.m_bufferSize;
+		++sent;
+	}
+	return sent;
+}
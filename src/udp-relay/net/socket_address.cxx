@@ -2,6 +2,7 @@
 
 #include "udp-relay/net/socket_address.hxx"
 
+#include "udp-relay/hash.hxx"
 #include "udp-relay/net/network_utils.hxx"
 
 #if UR_PLATFORM_WINDOWS
@@ -15,6 +16,13 @@
 
 #include <format>
 
+namespace
+{
+	// ::ffff:0:0/96
+	constexpr std::byte v4MappedPrefix[12]{std::byte{0}, std::byte{0}, std::byte{0}, std::byte{0}, std::byte{0}, std::byte{0},
+		std::byte{0}, std::byte{0}, std::byte{0}, std::byte{0}, std::byte{0xFF}, std::byte{0xFF}};
+} // namespace
+
 uint32_t ur::net::anyIpv4()
 {
 	return INADDR_ANY;
@@ -141,6 +149,25 @@ std::string ur::net::socket_address::toString(bool withPort) const
 	return "invaddr";
 }
 
+std::size_t ur::net::socket_address::hash() const noexcept
+{
+	uint32_t ipv4{};
+	if (const std::byte* v4 = v4Bytes())
+	{
+		std::memcpy(&ipv4, v4, sizeof(ipv4));
+	}
+	else
+	{
+		uint64_t high{};
+		uint64_t low{};
+		std::memcpy(&high, m_ip.data(), sizeof(high));
+		std::memcpy(&low, m_ip.data() + sizeof(high), sizeof(low));
+		return static_cast<std::size_t>(ur::hash_mix(high ^ m_port, low));
+	}
+
+	return static_cast<std::size_t>(ur::hash_mix((uint64_t(m_port) << 32) | ipv4, m_family));
+}
+
 bool ur::net::socket_address::operator==(const socket_address& other) const noexcept
 {
 	return std::memcmp(this, &other, sizeof(socket_address)) == 0;
@@ -174,4 +201,16 @@ bool ur::net::socket_address::isIpv4() const noexcept
 bool ur::net::socket_address::isIpv6() const noexcept
 {
 	return m_family == AF_INET6;
+}
+
+bool ur::net::socket_address::isV4Mapped() const noexcept
+{
+	return m_family == AF_INET6 && std::memcmp(m_ip.data(), v4MappedPrefix, sizeof(v4MappedPrefix)) == 0;
+}
+
+const std::byte* ur::net::socket_address::v4Bytes() const noexcept
+{
+	if (m_family == AF_INET)
+		return m_ip.data();
+	return isV4Mapped() ? m_ip.data() + sizeof(v4MappedPrefix) : nullptr;
 }
\ No newline at end of file
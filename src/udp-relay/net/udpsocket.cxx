@@ -13,12 +13,18 @@
 #include <arpa/inet.h>
 #include <fcntl.h>
 #include <netinet/in.h>
+#include <netinet/udp.h>
 #include <poll.h>
 #include <sys/select.h>
 #include <sys/socket.h>
 #include <unistd.h>
 #endif
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <ctime>
+
 #if UR_PLATFORM_WINDOWS
 using socklen_t = int;
 using buffer_t = char;
@@ -26,6 +32,11 @@ const ur::net::udpsocket::socket_t socketInvalid = INVALID_SOCKET;
 #elif UR_PLATFORM_LINUX
 using buffer_t = void;
 const ur::net::udpsocket::socket_t socketInvalid = -1;
+
+// linux 5.11, libc headers might predate it
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL 69
+#endif
 #endif
 
 ur::net::udpsocket::udpsocket() noexcept
@@ -147,6 +158,159 @@ int32_t ur::net::udpsocket::recvFrom(void* buffer, size_t bufferSize, socket_add
 	return res;
 }
 
+int32_t ur::net::udpsocket::recvBatch(std::span<datagram> datagrams) const noexcept
+{
+#if UR_PLATFORM_LINUX
+	// room for UDP_GRO segment size, only present when kernel coalesced datagrams, SO_TIMESTAMPNS receive time and SO_RXQ_OVFL drop counter
+	struct alignas(cmsghdr) control_buffer
+	{
+		std::array<std::byte, CMSG_SPACE(sizeof(int)) + CMSG_SPACE(sizeof(timespec)) + CMSG_SPACE(sizeof(uint32_t))> m_data;
+	};
+
+	std::array<mmsghdr, maxBatchSize> msgs;
+	std::array<iovec, maxBatchSize> iovecs;
+	std::array<sockaddr_storage, maxBatchSize> saddrs;
+	std::array<control_buffer, maxBatchSize> controls;
+
+	const size_t count = std::min(datagrams.size(), maxBatchSize);
+	for (size_t i = 0; i < count; ++i)
+	{
+		iovecs[i] = iovec{datagrams[i].m_buffer, datagrams[i].m_bufferSize};
+
+		msgs[i] = mmsghdr{};
+		msgs[i].msg_hdr.msg_name = &saddrs[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+		msgs[i].msg_hdr.msg_iov = &iovecs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_control = controls[i].m_data.data();
+		msgs[i].msg_hdr.msg_controllen = controls[i].m_data.size();
+	}
+
+	// MSG_WAITFORONE - don't wait for whole batch to be filled in case socket is blocking
+	const int res = ::recvmmsg(m_socket, msgs.data(), count, MSG_TRUNC | MSG_WAITFORONE, nullptr);
+	for (int i = 0; i < res; ++i)
+	{
+		datagrams[i].m_bytes = msgs[i].msg_len;
+		datagrams[i].m_addr.copyFromNative(saddrs[i]);
+		datagrams[i].m_segmentSize = 0;
+		datagrams[i].m_rxTimestamp = 0;
+		datagrams[i].m_rxDropped = 0;
+
+		for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsg))
+		{
+			if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+			{
+				int segmentSize{};
+				std::memcpy(&segmentSize, CMSG_DATA(cmsg), sizeof(segmentSize));
+				if (uint32_t(segmentSize) < msgs[i].msg_len)
+					datagrams[i].m_segmentSize = static_cast<uint16_t>(segmentSize);
+			}
+			else if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS)
+			{
+				timespec time{};
+				std::memcpy(&time, CMSG_DATA(cmsg), sizeof(time));
+				datagrams[i].m_rxTimestamp = int64_t(time.tv_sec) * 1000000000 + time.tv_nsec;
+			}
+			else if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL)
+			{
+				// attached only once socket dropped anything
+				std::memcpy(&datagrams[i].m_rxDropped, CMSG_DATA(cmsg), sizeof(uint32_t));
+			}
+		}
+	}
+	return res;
+#else
+	int32_t received = 0;
+	for (auto& dgram : datagrams)
+	{
+		dgram.m_bytes = recvFrom(dgram.m_buffer, dgram.m_bufferSize, dgram.m_addr);
+		dgram.m_segmentSize = 0;
+		dgram.m_rxTimestamp = 0;
+		dgram.m_rxDropped = 0;
+		if (dgram.m_bytes < 0)
+			break;
+		++received;
+	}
+	return received ? received : -1;
+#endif
+}
+
+int32_t ur::net::udpsocket::sendBatch(std::span<datagram> datagrams) const noexcept
+{
+	int32_t sent = 0;
+#if UR_PLATFORM_LINUX
+	// room for UDP_SEGMENT size of GSO sends
+	struct alignas(cmsghdr) control_buffer
+	{
+		std::array<std::byte, CMSG_SPACE(sizeof(uint16_t))> m_data;
+	};
+
+	std::array<mmsghdr, maxBatchSize> msgs;
+	std::array<iovec, maxBatchSize> iovecs;
+	std::array<sockaddr_storage, maxBatchSize> saddrs;
+	std::array<control_buffer, maxBatchSize> controls;
+
+	size_t offset = 0;
+	while (offset < datagrams.size())
+	{
+		const auto chunk = datagrams.subspan(offset, std::min(datagrams.size() - offset, maxBatchSize));
+		for (size_t i = 0; i < chunk.size(); ++i)
+		{
+			chunk[i].m_addr.copyToNative(saddrs[i]);
+			iovecs[i] = iovec{chunk[i].m_buffer, chunk[i].m_bufferSize};
+
+			msgs[i] = mmsghdr{};
+			msgs[i].msg_hdr.msg_name = &saddrs[i];
+			msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+			msgs[i].msg_hdr.msg_iov = &iovecs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+
+			if (chunk[i].m_segmentSize && chunk[i].m_segmentSize < chunk[i].m_bufferSize)
+			{
+				msgs[i].msg_hdr.msg_control = controls[i].m_data.data();
+				msgs[i].msg_hdr.msg_controllen = controls[i].m_data.size();
+
+				cmsghdr* cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr);
+				cmsg->cmsg_level = SOL_UDP;
+				cmsg->cmsg_type = UDP_SEGMENT;
+				cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+				std::memcpy(CMSG_DATA(cmsg), &chunk[i].m_segmentSize, sizeof(uint16_t));
+			}
+		}
+
+		const int res = ::sendmmsg(m_socket, msgs.data(), chunk.size(), 0);
+		if (res < 0)
+		{
+			const int err = errno;
+			if (err == EAGAIN || err == EWOULDBLOCK)
+				break;
+
+			// datagram at the head of the chunk was rejected, skip it and continue with the rest
+			chunk[0].m_bytes = -1;
+			++offset;
+			continue;
+		}
+
+		for (int i = 0; i < res; ++i)
+			chunk[i].m_bytes = msgs[i].msg_len;
+
+		sent += res;
+		offset += res;
+	}
+
+	for (; offset < datagrams.size(); ++offset)
+		datagrams[offset].m_bytes = -1;
+#else
+	for (auto& dgram : datagrams)
+	{
+		dgram.m_bytes = sendTo(dgram.m_buffer, dgram.m_bufferSize, dgram.m_addr);
+		if (dgram.m_bytes >= 0)
+			++sent;
+	}
+#endif
+	return sent || datagrams.empty() ? sent : -1;
+}
+
 bool ur::net::udpsocket::setOnlyIpv6(bool value) const noexcept
 {
 #if UR_PLATFORM_WINDOWS
@@ -168,6 +332,64 @@ bool ur::net::udpsocket::setReuseAddr(bool bAllowReuse) const noexcept
 	return bOk;
 }
 
+bool ur::net::udpsocket::setReusePort(bool bAllowReuse) const noexcept
+{
+#if UR_PLATFORM_LINUX
+	const int opt = bAllowReuse;
+	return setsockopt(m_socket, SOL_SOCKET, SO_REUSEPORT, (const buffer_t*)&opt, sizeof(opt)) == 0;
+#else
+	return false;
+#endif
+}
+
+bool ur::net::udpsocket::setGro(bool bEnable) const noexcept
+{
+#if UR_PLATFORM_LINUX
+	const int opt = bEnable;
+	return setsockopt(m_socket, SOL_UDP, UDP_GRO, (const buffer_t*)&opt, sizeof(opt)) == 0;
+#else
+	return false;
+#endif
+}
+
+bool ur::net::udpsocket::setRxTimestamps(bool bEnable) const noexcept
+{
+#if UR_PLATFORM_LINUX
+	const int opt = bEnable;
+	return setsockopt(m_socket, SOL_SOCKET, SO_TIMESTAMPNS, (const buffer_t*)&opt, sizeof(opt)) == 0;
+#else
+	return false;
+#endif
+}
+
+bool ur::net::udpsocket::setRxDropCounter(bool bEnable) const noexcept
+{
+#if UR_PLATFORM_LINUX
+	const int opt = bEnable;
+	return setsockopt(m_socket, SOL_SOCKET, SO_RXQ_OVFL, (const buffer_t*)&opt, sizeof(opt)) == 0;
+#else
+	return false;
+#endif
+}
+
+bool ur::net::udpsocket::setBusyPoll(std::chrono::microseconds timeout, bool bPrefer) const noexcept
+{
+#if UR_PLATFORM_LINUX
+	const int usec = static_cast<int>(timeout.count());
+	if (setsockopt(m_socket, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec)) != 0)
+		return false;
+
+	// preference is a hint, kernels before 5.11 don't have it
+	const int prefer = bPrefer;
+	setsockopt(m_socket, SOL_SOCKET, SO_PREFER_BUSY_POLL, &prefer, sizeof(prefer));
+	return true;
+#else
+	(void)timeout;
+	(void)bPrefer;
+	return false;
+#endif
+}
+
 bool ur::net::udpsocket::setNonBlocking(bool bNonBlocking) const noexcept
 {
 #if UR_PLATFORM_WINDOWS
@@ -208,6 +430,15 @@ int32_t ur::net::udpsocket::getRecvBufferSize() const noexcept
 	return size;
 }
 
+bool ur::net::udpsocket::setRecvBufferSizeForce(int32_t size) const noexcept
+{
+#if UR_PLATFORM_LINUX
+	return setsockopt(m_socket, SOL_SOCKET, SO_RCVBUFFORCE, (buffer_t*)&size, sizeof(size)) == 0;
+#else
+	return false;
+#endif
+}
+
 bool ur::net::udpsocket::setRecvTimeout(std::chrono::microseconds timeout) const noexcept
 {
 #if UR_PLATFORM_WINDOWS
@@ -0,0 +1,111 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+// in-kernel forwarding for established ipv4 channels, loaded by ur::net::xdp_fastpath.
+// Datagrams to relay port from known peer are rewritten as if relay socket sent them to opposite peer and bounced back with XDP_TX,
+// once frames from opposite peer showed which mac leads to it.
+// Everything else, including handshakes, goes up the stack to relay socket.
+
+#include "udp-relay/net/xdp_fastpath_abi.hxx"
+
+#include <linux/bpf.h>
+#include <linux/if_ether.h>
+#include <linux/in.h>
+#include <linux/ip.h>
+#include <linux/udp.h>
+
+#include <bpf/bpf_endian.h>
+#include <bpf/bpf_helpers.h>
+
+struct
+{
+	__uint(type, BPF_MAP_TYPE_HASH);
+	__uint(max_entries, UR_XDP_MAX_ROUTES);
+	__type(key, struct ur_xdp_endpoint);
+	__type(value, struct ur_xdp_route);
+} ur_routes SEC(".maps");
+
+struct
+{
+	__uint(type, BPF_MAP_TYPE_ARRAY);
+	__uint(max_entries, 1);
+	__type(key, __u32);
+	__type(value, struct ur_xdp_config);
+} ur_config SEC(".maps");
+
+static __always_inline __u16 ipv4_checksum(const struct iphdr* ip)
+{
+	const __u16* words = (const __u16*)ip;
+	__u32 sum = 0;
+
+#pragma unroll
+	for (int i = 0; i < (int)(sizeof(struct iphdr) / sizeof(__u16)); ++i)
+		sum += words[i];
+
+	sum = (sum & 0xFFFF) + (sum >> 16);
+	sum = (sum & 0xFFFF) + (sum >> 16);
+	return (__u16)~sum;
+}
+
+SEC("xdp")
+int ur_relay_fastpath(struct xdp_md* ctx)
+{
+	void* data = (void*)(long)ctx->data;
+	void* dataEnd = (void*)(long)ctx->data_end;
+
+	struct ethhdr* eth = data;
+	if ((void*)(eth + 1) > dataEnd || eth->h_proto != bpf_htons(ETH_P_IP))
+		return XDP_PASS;
+
+	// no ip options, no fragments
+	struct iphdr* ip = (void*)(eth + 1);
+	if ((void*)(ip + 1) > dataEnd || ip->ihl != 5 || ip->protocol != IPPROTO_UDP || (ip->frag_off & bpf_htons(0x3FFF)))
+		return XDP_PASS;
+
+	struct udphdr* udp = (void*)(ip + 1);
+	if ((void*)(udp + 1) > dataEnd)
+		return XDP_PASS;
+
+	const __u32 configKey = 0;
+	const struct ur_xdp_config* config = bpf_map_lookup_elem(&ur_config, &configKey);
+	if (!config || udp->dest != config->relayPort)
+		return XDP_PASS;
+
+	// handshakes might allocate new channel for the same peer, relay must see them
+	const __be32* magic = (void*)(udp + 1);
+	if ((void*)(magic + 1) <= dataEnd && *magic == config->handshakeMagic)
+		return XDP_PASS;
+
+	struct ur_xdp_endpoint from = {.addr = ip->saddr, .port = udp->source};
+	struct ur_xdp_route* route = bpf_map_lookup_elem(&ur_routes, &from);
+	if (!route)
+		return XDP_PASS;
+
+	// remember next hop of this endpoint, to be used when opposite peer sends to it. Entry is written by counters anyway
+	__builtin_memcpy(route->mac, eth->h_source, ETH_ALEN);
+	route->macKnown = 1;
+
+	// opposite peer hasn't been seen on this interface yet, relay socket knows how to reach it
+	const struct ur_xdp_route* peerRoute = bpf_map_lookup_elem(&ur_routes, &route->peer);
+	if (!peerRoute || !peerRoute->macKnown)
+		return XDP_PASS;
+
+	__sync_fetch_and_add(&route->packets, 1);
+	__sync_fetch_and_add(&route->bytes, bpf_ntohs(udp->len) - sizeof(struct udphdr));
+
+	ip->saddr = ip->daddr;
+	ip->daddr = route->peer.addr;
+	ip->check = 0;
+	ip->check = ipv4_checksum(ip);
+
+	udp->source = config->relayPort;
+	udp->dest = route->peer.port;
+	udp->check = 0; // optional for ipv4
+
+	// frame was addressed to this interface, send it from there to next hop of opposite peer
+	__builtin_memcpy(eth->h_source, eth->h_dest, ETH_ALEN);
+	__builtin_memcpy(eth->h_dest, peerRoute->mac, ETH_ALEN);
+
+	return XDP_TX;
+}
+
+char LICENSE[] SEC("license") = "Dual BSD/GPL";
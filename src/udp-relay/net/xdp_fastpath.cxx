@@ -0,0 +1,198 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include "udp-relay/net/xdp_fastpath.hxx"
+
+#include "udp-relay/log.hxx"
+#include "udp-relay/net/network_utils.hxx"
+
+#if UR_HAS_XDP
+#include "udp-relay/net/xdp_fastpath_abi.hxx"
+
+#include <bpf/bpf.h>
+#include <bpf/libbpf.h>
+#include <linux/if_link.h>
+#include <net/if.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#if UR_HAS_XDP
+
+namespace
+{
+	// ipv4 endpoint of address, false for ipv6 addresses that aren't v4-mapped
+	bool toEndpoint(const ur::net::socket_address& addr, ur_xdp_endpoint& endpoint)
+	{
+		endpoint = ur_xdp_endpoint{};
+		const std::byte* v4 = addr.v4Bytes();
+		if (v4 == nullptr)
+			return false;
+
+		std::memcpy(&endpoint.addr, v4, sizeof(endpoint.addr));
+		endpoint.port = ur::net::hton16(addr.getPort());
+		return true;
+	}
+} // namespace
+
+struct ur::net::xdp_fastpath::state
+{
+	~state()
+	{
+		if (m_attached)
+			bpf_xdp_detach(m_ifindex, XDP_FLAGS_SKB_MODE, nullptr);
+		if (m_object)
+			bpf_object__close(m_object);
+	}
+
+	bpf_object* m_object{};
+	int m_routesFd{-1};
+	int m_ifindex{};
+	bool m_attached{};
+};
+
+#else
+
+struct ur::net::xdp_fastpath::state
+{
+};
+
+#endif
+
+ur::net::xdp_fastpath::xdp_fastpath() noexcept = default;
+
+ur::net::xdp_fastpath::~xdp_fastpath() noexcept = default;
+
+bool ur::net::xdp_fastpath::isCompiledIn() noexcept
+{
+	return UR_HAS_XDP;
+}
+
+bool ur::net::xdp_fastpath::init(std::string_view interfaceName, std::string_view objectPath, uint16_t relayPort, uint32_t handshakeMagicBe) noexcept
+{
+#if UR_HAS_XDP
+	shutdown();
+
+	auto newState = std::make_unique<state>();
+	state& s = *newState;
+
+	s.m_ifindex = static_cast<int>(::if_nametoindex(std::string(interfaceName).c_str()));
+	if (s.m_ifindex == 0)
+	{
+		LOG(Error, Xdp, "Interface \"{}\" not found", interfaceName);
+		return false;
+	}
+
+	s.m_object = bpf_object__open_file(std::string(objectPath).c_str(), nullptr);
+	if (s.m_object == nullptr)
+	{
+		LOG(Error, Xdp, "Failed to open program object \"{}\". Error code: {}", objectPath, errno);
+		return false;
+	}
+
+	if (const int res = bpf_object__load(s.m_object); res != 0)
+	{
+		LOG(Error, Xdp, "Failed to load program object. Error code: {}", -res);
+		return false;
+	}
+
+	const bpf_program* program = bpf_object__find_program_by_name(s.m_object, "ur_relay_fastpath");
+	s.m_routesFd = bpf_object__find_map_fd_by_name(s.m_object, "ur_routes");
+	const int configFd = bpf_object__find_map_fd_by_name(s.m_object, "ur_config");
+	if (program == nullptr || s.m_routesFd < 0 || configFd < 0)
+	{
+		LOG(Error, Xdp, "Program object misses program or maps");
+		return false;
+	}
+
+	const uint32_t configKey = 0;
+	const ur_xdp_config config{handshakeMagicBe, hton16(relayPort), 0};
+	if (bpf_map_update_elem(configFd, &configKey, &config, BPF_ANY) != 0)
+	{
+		LOG(Error, Xdp, "Failed to write config map. Error code: {}", errno);
+		return false;
+	}
+
+	// generic mode works with any driver, including veth and loopback
+	if (const int res = bpf_xdp_attach(s.m_ifindex, bpf_program__fd(program), XDP_FLAGS_SKB_MODE, nullptr); res != 0)
+	{
+		LOG(Error, Xdp, "Failed to attach program to \"{}\". Error code: {}", interfaceName, -res);
+		return false;
+	}
+	s.m_attached = true;
+
+	LOG(Info, Xdp, "Fast path attached to \"{}\"", interfaceName);
+
+	m_state = std::move(newState);
+	return true;
+#else
+	(void)interfaceName;
+	(void)objectPath;
+	(void)relayPort;
+	(void)handshakeMagicBe;
+	LOG(Error, Xdp, "Build doesn't support xdp fast path");
+	return false;
+#endif
+}
+
+void ur::net::xdp_fastpath::shutdown() noexcept
+{
+	m_state.reset();
+}
+
+bool ur::net::xdp_fastpath::isValid() const noexcept
+{
+	return m_state != nullptr;
+}
+
+bool ur::net::xdp_fastpath::addRoute(const socket_address& from, const socket_address& to) noexcept
+{
+#if UR_HAS_XDP
+	ur_xdp_endpoint key{};
+	ur_xdp_route route{};
+	if (!m_state || !toEndpoint(from, key) || !toEndpoint(to, route.peer))
+		return false;
+
+	if (bpf_map_update_elem(m_state->m_routesFd, &key, &route, BPF_ANY) != 0)
+	{
+		LOG(Warning, Xdp, "Failed to add route {} -> {}. Error code: {}", from, to, errno);
+		return false;
+	}
+	return true;
+#else
+	(void)from;
+	(void)to;
+	return false;
+#endif
+}
+
+void ur::net::xdp_fastpath::removeRoute(const socket_address& from) noexcept
+{
+#if UR_HAS_XDP
+	ur_xdp_endpoint key{};
+	if (m_state && toEndpoint(from, key))
+		bpf_map_delete_elem(m_state->m_routesFd, &key);
+#else
+	(void)from;
+#endif
+}
+
+bool ur::net::xdp_fastpath::readCounters(const socket_address& from, uint64_t& packets, uint64_t& bytes) const noexcept
+{
+#if UR_HAS_XDP
+	ur_xdp_endpoint key{};
+	ur_xdp_route route{};
+	if (!m_state || !toEndpoint(from, key) || bpf_map_lookup_elem(m_state->m_routesFd, &key, &route) != 0)
+		return false;
+
+	packets = route.packets;
+	bytes = route.bytes;
+	return true;
+#else
+	(void)from;
+	(void)packets;
+	(void)bytes;
+	return false;
+#endif
+}
@@ -0,0 +1,89 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include "udp-relay/port_allocator.hxx"
+
+#include "udp-relay/log.hxx"
+#include "udp-relay/net/socket_address.hxx"
+
+#include <algorithm>
+
+void ur::port_allocator::init(uint16_t first, uint16_t last, uint32_t stride, uint32_t offset, bool ipv6)
+{
+	m_slots.clear();
+	m_free.clear();
+	m_freeHead = 0;
+	m_freeCount = 0;
+	m_allocated = 0;
+
+	m_stride = std::max<uint32_t>(stride, 1);
+	m_first = uint32_t(first) + offset;
+	m_ipv6 = ipv6;
+
+	if (first == 0 || m_first > last)
+		return;
+
+	const uint32_t count = (last - m_first) / m_stride + 1;
+	m_slots.resize(count);
+	m_free.resize(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		m_slots[i].m_port = static_cast<uint16_t>(m_first + i * m_stride);
+		pushFree(i);
+	}
+}
+
+ur::allocated_port* ur::port_allocator::allocate(channel_handle channel)
+{
+	const uint32_t attempts = std::min(m_freeCount, maxBindAttempts);
+	for (uint32_t attempt = 0; attempt < attempts; ++attempt)
+	{
+		const uint32_t index = m_free[m_freeHead];
+		m_freeHead = (m_freeHead + 1) % m_free.size();
+		--m_freeCount;
+
+		allocated_port& slot = m_slots[index];
+		const auto bindAddr = m_ipv6 ? net::socket_address::make_ipv6(net::anyIpv6(), slot.m_port) : net::socket_address::make_ipv4(net::anyIpv4(), slot.m_port);
+
+		net::udpsocket socket = net::udpsocket::make(m_ipv6);
+		if (!socket.isValid() || (m_ipv6 && !socket.setOnlyIpv6(false)) || !socket.bind(bindAddr) || !socket.setNonBlocking(true))
+		{
+			// port might be taken by other process for now, give it another try once its turn comes again
+			LOG(Verbose, PortAllocator, "Failed to bind relay port {}. Error code: {}", slot.m_port, net::udpsocket::getLastErrno());
+			pushFree(index);
+			continue;
+		}
+
+		slot.m_socket = std::move(socket);
+		slot.m_channel = channel;
+		slot.m_readable = false;
+		++m_allocated;
+		return &slot;
+	}
+	return nullptr;
+}
+
+void ur::port_allocator::release(allocated_port& slot) noexcept
+{
+	slot.m_socket.close();
+	slot.m_channel = channel_handle{};
+	slot.m_readable = false;
+	--m_allocated;
+	pushFree(static_cast<uint32_t>(&slot - m_slots.data()));
+}
+
+ur::allocated_port* ur::port_allocator::find(uint16_t port) noexcept
+{
+	if (port < m_first || (port - m_first) % m_stride != 0)
+		return nullptr;
+
+	const uint32_t index = (port - m_first) / m_stride;
+	if (index >= m_slots.size() || !m_slots[index].m_socket.isValid())
+		return nullptr;
+	return &m_slots[index];
+}
+
+void ur::port_allocator::pushFree(uint32_t index) noexcept
+{
+	m_free[(m_freeHead + m_freeCount) % m_free.size()] = index;
+	++m_freeCount;
+}
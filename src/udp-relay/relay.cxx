@@ -7,13 +7,16 @@
 #include "udp-relay/net/udpsocket.hxx"
 #include "udp-relay/version.hxx"
 
+#include <algorithm>
+#include <cstring>
+#include <new>
 #include <openssl/bio.h>
 #include <openssl/evp.h>
 #include <openssl/hmac.h>
+#include <span>
 
 using namespace std::chrono_literals;
 
-std::atomic<ur::log_level> ur::runtime_log_verbosity{ur::log_level::Info};
 std::atomic<bool> ur_is_initialized{false};
 
 #if UR_PLATFORM_WINDOWS
@@ -45,6 +48,7 @@ void ur_shutdown()
 #if UR_PLATFORM_WINDOWS
 	WSACleanup();
 #endif
+	ur::log_shutdown();
 	ur_is_initialized = false;
 }
 
@@ -64,6 +68,139 @@ bool ur::relay::init(relay_params params, secret_key key)
 
 	LOG(Verbose, Relay, "Begin initialization");
 
+	if (!key.size())
+		LOG(Warning, Relay, "Secret key not provided or empty. Message authentication will be disabled.");
+
+	hmac_verifier hmac{};
+	if (!hmac.init(key))
+	{
+		LOG(Error, Relay, "Failed to prepare message authentication");
+		return false;
+	}
+
+	m_ioUring.shutdown();
+	m_xdp.shutdown();
+	if (m_customTransport)
+	{
+		if (params.m_ioUring || params.m_gro || params.m_residency || !params.m_xdpInterface.empty())
+			LOG(Warning, Relay, "io_uring, UDP GRO, residency and xdp fast path need own socket, disabled over custom transport");
+
+		params.m_ioUring = false;
+		params.m_gro = false;
+		params.m_residency = false;
+		params.m_xdpInterface.clear();
+		params.m_socketRecvBufferMax = 0;
+
+		m_socket = net::udpsocket();
+		m_transport = m_customTransport;
+
+		LOG(Info, Relay, "Relay initialized over custom transport, port {}. Version: {}.{}.{}",
+			m_transport->getPort(), ur::getVersionMajor(), ur::getVersionMinor(), ur::getVersionPatch());
+	}
+	else if (!initSocket(params))
+	{
+		return false;
+	}
+
+	m_params = std::move(params);
+	m_hmac = std::move(hmac);
+
+	// io_uring sends every received buffer exactly once, it can't fan out
+	m_params.m_maxGroupSize = std::clamp<uint32_t>(m_params.m_maxGroupSize, 2, channel_group::maxSize);
+	if (m_params.m_maxGroupSize > 2 && m_ioUring.isValid())
+	{
+		LOG(Warning, Relay, "Group channels not supported by io_uring engine, channels stay pairs");
+		m_params.m_maxGroupSize = 2;
+	}
+
+	m_capture.close();
+	if (!m_params.m_capturePath.empty())
+	{
+		const std::string capturePath = m_shards.size() > 1 ? std::format("{}.{}", m_params.m_capturePath, m_shardIndex) : m_params.m_capturePath;
+		if (!m_capture.open(capturePath, uint64_t(m_params.m_captureSizeMb) << 20, m_params.m_captureSnapLength, m_params.m_captureSample, m_transport->getPort()))
+			LOG(Warning, Relay, "Capture disabled");
+	}
+
+	m_socketReadable = true;
+	m_socketSendBlocked = false;
+
+	// dedicated ports are watched by event loop of own socket, shards split range between themselves
+	m_readablePorts.clear();
+	m_relayPorts.init(0, 0, 1, 0, false);
+	if (m_params.m_relayPortFirst)
+	{
+		if (!m_eventLoop.isValid() || m_transport != &m_socketTransport || m_ioUring.isValid())
+		{
+			LOG(Warning, Relay, "Dedicated relay ports need own socket without io_uring, disabled");
+		}
+		else
+		{
+			m_relayPorts.init(m_params.m_relayPortFirst, m_params.m_relayPortLast, std::max<uint32_t>(uint32_t(m_shards.size()), 1), m_shardIndex, m_params.ipv6);
+			LOG(Info, Relay, "Shard {} hands out {} dedicated relay ports from {}-{}", m_shardIndex, m_relayPorts.capacity(), m_params.m_relayPortFirst, m_params.m_relayPortLast);
+		}
+	}
+
+	m_channelArena.clear();
+	m_channelArena.setHugePages(m_params.m_hugePages);
+	m_groups.clear();
+	m_channels.clear();
+	m_addressChannels.clear();
+	m_channels.reserve(256);
+	m_addressChannels.reserve(512);
+
+	const size_t batchSize = std::clamp<size_t>(m_params.m_batchSize, 1, net::udpsocket::maxBatchSize);
+	const size_t recvBufferSize = m_params.m_gro ? sizeof(gro_buffer) : sizeof(recv_buffer);
+	// extra tail allows reading whole recv_buffer from any segment of last GRO run
+	m_recvStorage.assign(batchSize * recvBufferSize + sizeof(recv_buffer), std::byte{});
+	// copies of datagram fanned out to group fit single send call
+	const size_t sendBatchSize = std::clamp<size_t>(m_params.m_maxGroupSize - 1, batchSize, net::udpsocket::maxBatchSize);
+	m_recvBatch.resize(batchSize);
+	m_sendBatch.resize(sendBatchSize);
+	m_sendChannels.resize(sendBatchSize);
+	m_sendCount = 0;
+	// io_uring sends complete asynchronously from receive buffers, nothing is left to queue
+	m_egress.init(m_ioUring.isValid() ? 0 : m_params.m_egressQueueSize, m_params.m_egressChannelLimit,
+		m_params.m_egressDropOldest ? egress_drop_policy::Oldest : egress_drop_policy::Tail);
+	for (size_t i = 0; i < batchSize; ++i)
+	{
+		m_recvBatch[i].m_buffer = m_recvStorage.data() + i * recvBufferSize;
+		m_recvBatch[i].m_bufferSize = recvBufferSize;
+	}
+	m_handshakeCache.init(m_params.m_handshakeCacheSize);
+	m_stats = relay_stats();
+	m_loopWorkReported = 0;
+	m_loopSpinReported = 0;
+	m_loopSleepReported = 0;
+	m_packetRate = 0.;
+	m_rateWindowDatagrams = 0;
+	m_idleSpins = 0;
+	m_residency.reset();
+	m_kernelDropped = 0;
+	m_recvDroppedTuned = 0;
+	m_startTime = m_clock->now();
+	updateTickTime();
+	m_rateWindowStart = m_lastTickTime;
+	m_lastTraffic = m_lastTickTime - std::chrono::microseconds(m_params.m_spinBudgetUs);
+	m_handshakeLimiter.init(m_params.m_handshakeRate, m_params.m_handshakePrefixRate, m_lastTickMs);
+	m_expiryWheel.reset(m_expiryTick);
+	m_routeExpiryWheel.reset(m_expiryTick);
+	m_expiryPending = false;
+	m_params.m_expiryBudget = std::max<uint32_t>(m_params.m_expiryBudget, 1);
+
+	m_remoteRoutes.clear();
+	m_shardsToWake.assign(m_shards.size(), 0);
+
+	LOG(Verbose, Relay, "Batch size: {}", batchSize);
+	if (m_params.m_maxGroupSize > 2)
+		LOG(Info, Relay, "Group channels of up to {} peers", m_params.m_maxGroupSize);
+	if (m_params.m_latencyMode != latency_mode::Wait)
+		LOG(Info, Relay, "Latency mode: {}, spin budget {} us", latency_mode_to_string(m_params.m_latencyMode), m_params.m_spinBudgetUs);
+
+	return true;
+}
+
+bool ur::relay::initSocket(relay_params& params)
+{
 	auto newSocket = ur::net::udpsocket::make(params.ipv6);
 	if (!newSocket.isValid())
 	{
@@ -77,6 +214,12 @@ bool ur::relay::init(relay_params params, secret_key key)
 		return false;
 	}
 
+	if (m_shards.size() > 1 && !newSocket.setReusePort(true))
+	{
+		LOG(Error, Relay, "Failed set socket port reuse for shard {}", m_shardIndex);
+		return false;
+	}
+
 	const auto bindAddr = params.ipv6 ? net::socket_address::make_ipv6(ur::net::anyIpv6(), params.m_primaryPort) : net::socket_address::make_ipv4(net::anyIpv4(), params.m_primaryPort);
 	if (!newSocket.bind(bindAddr))
 	{
@@ -104,206 +247,1572 @@ bool ur::relay::init(relay_params params, secret_key key)
 		LOG(Info, Relay, "Socket requested recv buffer size {}", params.m_socketRecvBufferSize);
 	}
 
-	if (!key.size())
-		LOG(Warning, Relay, "Secret key not provided or empty. Message authentication will be disabled.");
+	if (params.m_ioUring)
+	{
+		if (m_ioUring.init(newSocket, 4096, sizeof(recv_buffer)))
+		{
+			LOG(Info, Relay, "Using io_uring engine");
+		}
+		else
+		{
+			LOG(Warning, Relay, "io_uring engine not available. Fallback to socket calls");
+		}
+	}
+
+	if (!params.m_xdpInterface.empty())
+	{
+		if (m_shards.size() > 1)
+		{
+			LOG(Warning, Relay, "xdp fast path not supported with multiple workers");
+		}
+		else if (!m_xdp.init(params.m_xdpInterface, params.m_xdpObject, newSocket.getPort(), handshake_magic_number_be))
+		{
+			LOG(Warning, Relay, "xdp fast path not available. Channels are forwarded by relay only");
+		}
+	}
+
+	if (params.m_gro)
+	{
+		if (m_ioUring.isValid())
+		{
+			LOG(Warning, Relay, "UDP GRO not supported by io_uring engine");
+			params.m_gro = false;
+		}
+		else if (!newSocket.setGro(true))
+		{
+			LOG(Warning, Relay, "Failed to enable UDP GRO");
+			params.m_gro = false;
+		}
+		else
+		{
+			LOG(Info, Relay, "UDP GRO enabled");
+		}
+	}
+
+	if (params.m_latencyMode != latency_mode::Wait && params.m_busyPollUs)
+	{
+		if (!newSocket.setBusyPoll(std::chrono::microseconds(params.m_busyPollUs), true))
+		{
+			LOG(Warning, Relay, "Failed to enable busy polling, might need CAP_NET_ADMIN to go above net.core.busy_read. Spinning on receives only");
+		}
+		else
+		{
+			LOG(Info, Relay, "Socket busy polls device queue for {} us", params.m_busyPollUs);
+		}
+	}
+
+	// kernel reports drops only once they happen, so counter costs nothing while relay keeps up
+	if (!m_ioUring.isValid() && !newSocket.setRxDropCounter(true))
+		LOG(Warning, Relay, "Failed to enable receive drop counter");
+
+	if (params.m_residency)
+	{
+		if (m_ioUring.isValid())
+		{
+			LOG(Warning, Relay, "Receive timestamps not supported by io_uring engine");
+			params.m_residency = false;
+		}
+		else if (!newSocket.setRxTimestamps(true))
+		{
+			LOG(Warning, Relay, "Failed to enable receive timestamps");
+			params.m_residency = false;
+		}
+	}
 
 	LOG(Info, Relay, "Relay initialized {:A}:{}. SndBuf={}, RcvBuf={}. Version: {}.{}.{}",
 		bindAddr, newSocket.getPort(), newSocket.getSendBufferSize(), newSocket.getRecvBufferSize(),
 		ur::getVersionMajor(), ur::getVersionMinor(), ur::getVersionPatch());
 
-	m_params = std::move(params);
-	m_secretKey = std::move(key);
 	m_socket = std::move(newSocket);
+	m_socketTransport = net::socket_transport(&m_socket);
+	m_transport = &m_socketTransport;
 
-	m_channels.reserve(256);
-	m_addressChannels.reserve(512);
+	if (!m_ioUring.isValid() && (!m_eventLoop.init() || !m_eventLoop.add(m_socket, &m_socket)))
+	{
+		LOG(Error, Relay, "Failed to initialize event loop");
+		return false;
+	}
+	if (m_eventLoop.isValid())
+		m_eventLoop.enableWakeup();
 
 	return true;
 }
 
+std::optional<ur::latency_mode> ur::latency_mode_from_string(std::string_view name) noexcept
+{
+	for (const latency_mode mode : {latency_mode::Wait, latency_mode::Busy, latency_mode::Adaptive})
+	{
+		if (latency_mode_to_string(mode) == name)
+			return mode;
+	}
+	return std::nullopt;
+}
+
+std::string_view ur::latency_mode_to_string(latency_mode mode) noexcept
+{
+	switch (mode)
+	{
+	case latency_mode::Busy:
+		return "busy";
+	case latency_mode::Adaptive:
+		return "adaptive";
+	default:
+		return "wait";
+	}
+}
+
 void ur::relay::run()
 {
-	if (!ur_is_init() || !m_socket.isValid())
+	if (!ur_is_init() || m_transport == nullptr)
 	{
 		LOG(Error, Relay, "Cannot run while not initialized");
 		return;
 	}
 
+	// ring only takes submissions from thread that enabled it, which is one running the shard
+	if (m_ioUring.isValid() && !m_ioUring.start())
+	{
+		LOG(Error, Relay, "Failed to start io_uring engine");
+		return;
+	}
+
 	m_running = true;
 
 	while (m_running)
-	{
-		m_socket.waitForWrite(1000us);
-		m_socket.waitForRead(15000us);
+		runOnce(true);
+
+	LOG(Info, Relay, "Stop");
+	LOG(Info, Relay, "Exited run loop");
+}
+
+void ur::relay::poll()
+{
+	if (m_transport == nullptr || (m_ioUring.isValid() && !m_ioUring.start()))
+		return;
+
+	runOnce(false);
+}
+
+void ur::relay::runOnce(bool bWait)
+{
+	metric_add(m_metrics->m_loopIterations);
+
+	const bool bMeasureLoop = m_params.m_latencyMode != latency_mode::Wait;
+	const auto loopStart = bMeasureLoop ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+	const uint64_t processedBefore = processedDatagrams();
 
-		m_lastTickTime = std::chrono::steady_clock::now();
+	updatePacketRate();
+	const bool bSpin = bWait && shouldSpin();
+	bool bBlocked = false;
+
+	if (m_ioUring.isValid())
+	{
+		// io_uring wait can't be interrupted by other shards, poll their handoffs more often
+		const auto timeout = m_expiryPending || bSpin ? 0us : m_shards.size() > 1 ? 1000us : 15000us;
+		bBlocked = timeout != 0us;
+		processIncomingIoUring(timeout);
+	}
+	else if (!m_eventLoop.isValid())
+	{
+		// custom transport has no readiness notifications, just try it
+		m_socketReadable = true;
+		updateTickTime();
+		if (!m_egress.empty())
+			drainEgress();
 		processIncoming();
+	}
+	else
+	{
+		// spinning tries to receive regardless of readiness
+		if (bSpin)
+			m_socketReadable = true;
+
+		// edge-triggered loop won't report data left from previous iteration, keep draining without sleeping
+		auto timeout = !bWait || m_socketReadable || !m_readablePorts.empty() || m_expiryPending || (!m_egress.empty() && !m_socketSendBlocked) ? 0us : 100000us;
+		if (m_shards.size() > 1 && timeout != 0us)
+		{
+			// pairs with fence in wakeShards(), either this shard sees handoff or other shard sees it sleeping
+			m_sleeping.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (hasPendingHandoffs())
+				timeout = 0us;
+		}
+		bBlocked = timeout != 0us;
+
+		// while spinning event loop is polled only now and then, for writability & timers
+		std::array<net::event, 64> events;
+		int32_t eventCount = 0;
+		if (!bSpin || ++m_idleSpins >= spinEventInterval)
+		{
+			m_idleSpins = 0;
+			eventCount = m_eventLoop.wait(events, timeout);
+		}
+		m_sleeping.store(false, std::memory_order_relaxed);
+		for (int32_t i = 0; i < eventCount; ++i)
+		{
+			if (events[i].m_flags & net::event_flags::Readable)
+			{
+				// any other socket is dedicated port, its slot tells the channel
+				if (events[i].m_userData == &m_socket)
+				{
+					m_socketReadable = true;
+				}
+				else if (auto* port = static_cast<allocated_port*>(events[i].m_userData); !port->m_readable)
+				{
+					port->m_readable = true;
+					m_readablePorts.push_back(port);
+				}
+			}
+
+			if (events[i].m_flags & net::event_flags::Writable)
+			{
+				m_socketSendBlocked = false;
+				m_eventLoop.setWantWrite(m_socket, &m_socket, false);
+			}
+		}
+
+		updateTickTime();
+		if (!m_egress.empty() && !m_socketSendBlocked)
+			drainEgress();
 
-		conditionalCleanup();
+		if (m_socketReadable)
+			processIncoming();
 
-		if (m_gracefulStopRequested && m_channels.size() == 0)
-			stop();
+		if (!m_readablePorts.empty())
+			processRelayPorts();
 	}
 
-	LOG(Info, Relay, "Exited run loop");
+	// with own clock tick time is taken right after waiting
+	const auto waited = m_clock == &m_steadyClock ? m_lastTickTime : loopStart;
+
+	if (m_shards.size() > 1)
+		processHandoffs();
+
+	expireInactive();
+
+	conditionalCleanup();
+
+	if (bMeasureLoop)
+		recordLoopTime(loopStart, waited, bBlocked, processedBefore);
+
+	m_channelCount.store(m_channels.size(), std::memory_order_relaxed);
+
+	// stop requests only raise flags, as they come from signal handler
+	if (m_gracefulStopRequested && !m_gracefulStopLogged)
+	{
+		LOG(Info, Relay, "Graceful stop requested");
+		m_gracefulStopLogged = true;
+	}
+
+	// shard keeps running while any other shard has channels, as it might receive packets for them
+	if (m_gracefulStopRequested && m_channels.size() == 0 && std::ranges::all_of(m_shards, [](const relay* shard)
+																	 { return shard->m_channelCount.load(std::memory_order_relaxed) == 0; }))
+		stop();
 }
 
 void ur::relay::stop()
 {
-	LOG(Info, Relay, "Stop");
 	m_running = false;
+	m_eventLoop.wakeup();
 }
 
 void ur::relay::stopGracefully()
 {
-	LOG(Info, Relay, "Graceful stop requested");
 	m_gracefulStopRequested = true;
+	m_eventLoop.wakeup();
 }
 
-void ur::relay::processIncoming()
+uint16_t ur::relay::getPort() const
+{
+	return m_transport ? m_transport->getPort() : 0;
+}
+
+void ur::relay::setMetrics(worker_metrics* metrics) noexcept
+{
+	m_metrics = metrics ? metrics : &m_localMetrics;
+}
+
+void ur::relay::setShard(uint32_t shardIndex, std::span<relay* const> shards, std::span<handoff_link* const> outgoing, std::span<handoff_link* const> incoming)
 {
-	net::socket_address m_recvAddr{};
-	recv_buffer m_recvBuffer{};
+	m_shardIndex = shardIndex;
+	m_shards.assign(shards.begin(), shards.end());
+	m_outgoing.assign(outgoing.begin(), outgoing.end());
+	m_incoming.assign(incoming.begin(), incoming.end());
+}
 
-	const int32_t maxRecvCycles = 32;
-	for (int32_t currentCycle = 0; currentCycle < maxRecvCycles; ++currentCycle)
+void ur::relay::processIncoming()
+{
+	const int32_t maxRecvBatches = 4;
+	for (int32_t currentBatch = 0; currentBatch < maxRecvBatches; ++currentBatch)
 	{
-		const int32_t bytesRead = m_socket.recvFrom(m_recvBuffer.data(), m_recvBuffer.size(), m_recvAddr);
-		if (bytesRead < 0)
+		const int32_t received = m_transport->recvBatch(m_recvBatch);
+		if (received == 0)
+		{
+			m_socketReadable = false;
+			return;
+		}
+		else if (received < 0)
 		{
 			const auto err = net::udpsocket::getLastErrno();
 			if (err == EAGAIN || err == EWOULDBLOCK)
+			{
+				m_socketReadable = false;
 				return;
+			}
 			else
 				continue;
 		}
 
-		if (size_t(bytesRead) > m_recvBuffer.size()) [[unlikely]]
-			continue;
-
-		// always check for handshake to allow creating new channels from same socket without waiting prev. session to close
-		const auto [isValidHeader, header] = relay_helpers::tryDeserializeHeader(m_secretKey, m_recvBuffer, bytesRead);
-		if (isValidHeader && !m_gracefulStopRequested)
-		{
-			auto [it, inserted] = m_channels.try_emplace(header.m_guid, header.m_guid, m_recvAddr, m_lastTickTime);
-			if (inserted)
-			{
-				LOG(Info, Relay, "Channel allocated: \"{}\". Peer: {}", it->second.m_guid, it->second.m_peerA);
-			}
-			else if (it->second.m_peerA != m_recvAddr && it->second.m_peerB.isNull())
-			{
-				it->second.m_peerB = m_recvAddr;
-				it->second.m_lastUpdated = m_lastTickTime;
-
-				m_addressChannels[it->second.m_peerA] = it->second.m_guid;
-				m_addressChannels[it->second.m_peerB] = it->second.m_guid;
+		m_stats.m_recvBatches++;
+		m_stats.m_recvDatagrams += received;
 
-				LOG(Info, Relay, "Channel established: \"{}\". PeerA: {}, PeerB: {}", it->second.m_guid, it->second.m_peerA, it->second.m_peerB);
-			}
-		}
+		if (m_capture.isOpen()) [[unlikely]]
+			m_capture.write(std::span<const net::datagram>(m_recvBatch.data(), received));
 
-		const auto findAddressChannel = m_addressChannels.find(m_recvAddr);
-		if (findAddressChannel != m_addressChannels.end())
+		uint64_t packetsIn{};
+		uint64_t bytesIn{};
+		for (int32_t i = 0; i < received; ++i)
 		{
-			const auto& findChannel = m_channels.find(findAddressChannel->second);
-			if (findChannel == m_channels.end()) [[unlikely]]
+			const auto& dgram = m_recvBatch[i];
+			if (dgram.m_bytes < 0 || dgram.m_bytes > int32_t(dgram.m_bufferSize)) [[unlikely]]
 				continue;
 
-			auto& currentChannel = findChannel->second;
+			packetsIn += dgram.m_segmentSize ? (dgram.m_bytes + dgram.m_segmentSize - 1) / dgram.m_segmentSize : 1;
+			bytesIn += dgram.m_bytes;
 
-			currentChannel.m_lastUpdated = m_lastTickTime;
+			if (dgram.m_segmentSize)
+				processCoalesced(dgram);
+			else if (dgram.m_bytes <= int32_t(sizeof(recv_buffer))) [[likely]]
+				processReceived(dgram);
+		}
+		recordReceived(received, packetsIn, bytesIn);
 
-			currentChannel.m_stats.m_packetsReceived++;
-			currentChannel.m_stats.m_bytesReceived += bytesRead;
+		// counter is cumulative, newest datagram carries the latest one
+		if (const uint32_t kernelDropped = m_recvBatch[received - 1].m_rxDropped; kernelDropped != m_kernelDropped) [[unlikely]]
+		{
+			m_stats.m_recvDropped += kernelDropped - m_kernelDropped;
+			m_kernelDropped = kernelDropped;
+			m_metrics->m_recvDropped.store(m_stats.m_recvDropped, std::memory_order_relaxed);
+		}
 
-			const auto& sendAddr = currentChannel.m_peerA != m_recvAddr ? currentChannel.m_peerA : currentChannel.m_peerB;
+		flushSendBatch();
 
-			// relay packet immediately or drop
-			const auto bytesSend = m_socket.sendTo(m_recvBuffer.data(), bytesRead, sendAddr);
-			if (bytesSend < 0) [[unlikely]]
-				return;
+		if (m_shards.size() > 1)
+			wakeShards();
 
-			currentChannel.m_stats.m_packetsSent++;
-			currentChannel.m_stats.m_bytesSent += bytesSend;
+		// socket drained, no reason to try again
+		if (size_t(received) < m_recvBatch.size())
+		{
+			m_socketReadable = false;
+			return;
 		}
 	}
 }
 
-void ur::relay::conditionalCleanup()
+void ur::relay::processIncomingIoUring(std::chrono::microseconds timeout)
 {
-	if (m_lastTickTime < m_nextCleanupTime)
+	// submits sends queued by previous call and waits for datagrams in the same syscall
+	const int32_t received = m_ioUring.recvBatch(m_recvBatch, timeout);
+
+	updateTickTime();
+
+	if (received <= 0)
 		return;
 
-	{ // close inactive channels
-		const auto eraseChannelLam = [&](const auto& pair) -> bool
+	m_stats.m_recvBatches++;
+	m_stats.m_recvDatagrams += received;
+
+	if (m_capture.isOpen()) [[unlikely]]
+		m_capture.write(std::span<const net::datagram>(m_recvBatch.data(), received));
+
+	uint64_t bytesIn{};
+	uint64_t packetsOut{};
+	uint64_t bytesOut{};
+	for (int32_t i = 0; i < received; ++i)
+	{
+		const auto& dgram = m_recvBatch[i];
+		if (dgram.m_bytes < 0 || dgram.m_bytes > int32_t(dgram.m_bufferSize)) [[unlikely]]
 		{
-			const auto timeSinceInactive = m_lastTickTime - pair.second.m_lastUpdated;
-			if (timeSinceInactive > m_params.m_cleanupInactiveChannelAfterTime)
-			{
-				const auto& stats = pair.second.m_stats;
-				LOG(Info, Relay, "Channel closed: \"{0}\". Received: {1} packets ({2} bytes); Dropped: {3} ({4});",
-					pair.second.m_guid, stats.m_packetsReceived, stats.m_bytesReceived, stats.m_packetsReceived - stats.m_packetsSent, stats.m_bytesReceived - stats.m_bytesSent);
-				return true;
-			}
-			return false;
-		};
-		std::erase_if(m_channels, eraseChannelLam);
-	}
+			m_ioUring.release(dgram);
+			continue;
+		}
+		bytesIn += dgram.m_bytes;
+
+		const auto [isValidHeader, header] = readHeader(dgram);
+		const handshake_header* verifiedHeader = isValidHeader ? &header : nullptr;
+
+		std::optional<uint32_t> channelIndex{};
+		if (m_shards.size() <= 1 || !tryHandoff(dgram, verifiedHeader))
+			channelIndex = processDatagram(dgram, verifiedHeader);
 
-	{ // erase address mappings that used erased channels
-		const auto eraseAddressChannelLam = [&](const auto& pair) -> bool
+		if (!channelIndex)
 		{
-			return m_channels.find(pair.second) == m_channels.end();
-		};
-		std::erase_if(m_addressChannels, eraseAddressChannelLam);
+			m_ioUring.release(dgram);
+			continue;
+		}
+
+		// relay packet from the very same buffer it was received in. Send result is known only after completion, count it as sent
+		channel& currentChannel = m_channelArena.at(*channelIndex);
+		const auto& sendAddr = currentChannel.m_peerA != dgram.m_addr ? currentChannel.m_peerA : currentChannel.m_peerB;
+		m_ioUring.send(dgram, dgram.m_bytes, sendAddr);
+
+		currentChannel.m_packetsSent++;
+		currentChannel.m_bytesSent += dgram.m_bytes;
+		packetsOut++;
+		bytesOut += dgram.m_bytes;
 	}
+	recordReceived(received, received, bytesIn);
 
-	m_nextCleanupTime = m_lastTickTime + m_params.m_cleanupTime;
+	// like flushSendBatch(), count only datagrams actually queued for sending
+	if (packetsOut)
+	{
+		m_stats.m_sendBatches++;
+		m_stats.m_sendDatagrams += packetsOut;
+		metric_add(m_metrics->m_sendBatches);
+	}
+	m_stats.m_sendDropped = m_ioUring.getSendFailures();
 
-	ur::log_flush();
+	metric_add(m_metrics->m_packetsOut, packetsOut);
+	metric_add(m_metrics->m_bytesOut, bytesOut);
+	m_metrics->m_sendFailures.store(m_stats.m_sendDropped, std::memory_order_relaxed);
+
+	if (m_shards.size() > 1)
+		wakeShards();
 }
 
-std::pair<bool, ur::handshake_header> ur::relay_helpers::tryDeserializeHeader(const secret_key& key, const recv_buffer& recvBuffer, size_t recvBytes)
+void ur::relay::processReceived(const net::datagram& dgram)
 {
-	// not a handshake packet
-	if (recvBytes < sizeof(handshake_header))
-		return std::pair<bool, handshake_header>();
-	else if (std::memcmp(recvBuffer.data(), &handshake_magic_number_be, sizeof(handshake_header::m_magicNumber)) != 0)
-		return std::pair<bool, handshake_header>();
+	const auto [isValidHeader, header] = readHeader(dgram);
+	const handshake_header* verifiedHeader = isValidHeader ? &header : nullptr;
 
-	handshake_header recvHeader{};
-	std::memcpy(&recvHeader, recvBuffer.data(), sizeof(recvHeader));
+	if (m_shards.size() > 1 && tryHandoff(dgram, verifiedHeader))
+		return;
 
-	recvHeader.m_length = ur::net::ntoh(recvHeader.m_length);
-	recvHeader.m_flags = ur::net::ntoh(recvHeader.m_flags);
-	recvHeader.m_guid = ur::net::ntoh(recvHeader.m_guid);
+	// relay packet within the batch or drop
+	if (const auto channelIndex = processDatagram(dgram, verifiedHeader))
+		queueSend(dgram, *channelIndex);
+}
 
-	if (const uint16_t len = recvHeader.m_length + sizeof(handshake_header); len != recvBytes)
+void ur::relay::processCoalesced(const net::datagram& dgram)
+{
+	const int32_t segmentSize = dgram.m_segmentSize;
+	if (segmentSize > int32_t(sizeof(recv_buffer))) [[unlikely]]
+		return;
+
+	auto* const data = static_cast<std::byte*>(dgram.m_buffer);
+
+	// handshakes and runs for channels owned by other shards are handled datagram by datagram
+	bool bSplit = m_shards.size() > 1 && m_remoteRoutes.contains(dgram.m_addr);
+	for (int32_t offset = 0; !bSplit && offset < dgram.m_bytes; offset += segmentSize)
 	{
-		LOG(Debug, RelayHelpers, "Packet length invalid. Expected: {}, received: {}", len, recvBytes);
+		bSplit = dgram.m_bytes - offset >= int32_t(sizeof(handshake_header)) &&
+				 std::memcmp(data + offset, &handshake_magic_number_be, sizeof(handshake_header::m_magicNumber)) == 0;
 	}
 
-	constexpr guid zeroGuid{};
-	if (recvHeader.m_guid == zeroGuid)
+	if (bSplit)
 	{
-		LOG(Debug, RelayHelpers, "Packet guid must not be zero'd");
+		for (int32_t offset = 0; offset < dgram.m_bytes; offset += segmentSize)
+		{
+			const int32_t bytes = std::min(segmentSize, dgram.m_bytes - offset);
+			processReceived(net::datagram{data + offset, uint32_t(bytes), bytes, dgram.m_addr, 0, dgram.m_rxTimestamp});
+		}
+		return;
+	}
+
+	if (const auto channelIndex = processDatagram(dgram, nullptr))
+		queueSend(dgram, *channelIndex);
+}
+
+std::pair<bool, ur::handshake_header> ur::relay::readHeader(const net::datagram& dgram)
+{
+	const auto& recvBuffer = *static_cast<const recv_buffer*>(dgram.m_buffer);
+	auto result = relay_helpers::tryParseHeader(recvBuffer, dgram.m_bytes);
+	if (!result.first)
+		return result;
+
+	const handshake_header& header = result.second;
+	const bool cacheable = m_hmac.hasKey() && m_handshakeCache.canCache(dgram.m_bytes);
+	if (cacheable)
+	{
+		if (m_handshakeCache.contains(dgram.m_addr, header.m_mac, recvBuffer.data(), dgram.m_bytes))
+		{
+			m_stats.m_handshakeCacheHits++;
+			metric_add(m_metrics->m_handshakesValid);
+			return result;
+		}
+		m_stats.m_handshakeCacheMisses++;
+	}
+
+	// shed abusive sources before they cost HMAC or channel allocation
+	if (!m_handshakeLimiter.admit(dgram.m_addr, m_lastTickMs))
+	{
+		m_stats.m_handshakesShed++;
+		metric_add(m_metrics->m_handshakesShed);
 		return std::pair<bool, handshake_header>();
 	}
 
-	if (key.size()) // ignore HMAC validation if key not provided
+	if (m_hmac.hasKey() && !relay_helpers::verifyMac(m_hmac, recvBuffer, dgram.m_bytes, header))
 	{
-		recv_buffer recvBufferZeroMac = recvBuffer;
-		std::memset(recvBufferZeroMac.data() + offsetof(handshake_header, m_mac), 0, sizeof(handshake_header::m_mac));
+		metric_add(m_metrics->m_handshakesInvalid);
+		return std::pair<bool, handshake_header>();
+	}
+
+	if (cacheable)
+		m_handshakeCache.insert(dgram.m_addr, header.m_mac, recvBuffer.data(), dgram.m_bytes);
+	metric_add(m_metrics->m_handshakesValid);
+	return result;
+}
 
-		const auto mac = makeHMAC(key, recvBufferZeroMac.data(), recvBytes);
-		if (std::memcmp(&mac, &recvHeader.m_mac, sizeof(mac)) != 0)
+std::optional<uint32_t> ur::relay::processDatagram(const net::datagram& dgram, const handshake_header* verifiedHeader)
+{
+	// always check for handshake to allow creating new channels from same socket without waiting prev. session to close
+	if (verifiedHeader && !m_gracefulStopRequested)
+	{
+		const handshake_header& header = *verifiedHeader;
+		auto [it, inserted] = m_channels.try_emplace(header.m_guid);
+		if (inserted)
 		{
-			LOG(Debug, RelayHelpers, "Packet HMAC_sha256 invalid");
-			return std::pair<bool, handshake_header>();
+			if (const auto handle = allocateChannel(header.m_guid, dgram.m_addr))
+			{
+				it->second = *handle;
+				LOG(Info, Relay, "Channel allocated: \"{}\". Peer: {}", header.m_guid, dgram.m_addr);
+			}
+			else
+			{
+				m_channels.erase(it);
+			}
 		}
-	}
+		else if (channel* ch = m_channelArena.resolve(it->second); ch && ch->m_peerA != dgram.m_addr && ch->m_peerB.isNull())
+		{
+			ch->m_peerB = dgram.m_addr;
+			ch->m_lastUpdated = m_lastTickMs;
 
-	return std::pair<bool, handshake_header>{true, recvHeader};
+			m_addressChannels[ch->m_peerA] = it->second;
+			m_addressChannels[ch->m_peerB] = it->second;
+
+			metric_sub(m_metrics->m_channelsPending);
+			metric_add(m_metrics->m_channelsEstablished);
+
+			LOG(Info, Relay, "Channel established: \"{}\". PeerA: {}, PeerB: {}", header.m_guid, ch->m_peerA, ch->m_peerB);
+
+			if (m_xdp.isValid())
+			{
+				m_xdp.addRoute(ch->m_peerA, ch->m_peerB);
+				m_xdp.addRoute(ch->m_peerB, ch->m_peerA);
+			}
+		}
+		else if (ch && m_params.m_maxGroupSize > 2 && !ch->m_peerB.isNull()) [[unlikely]]
+		{
+			joinGroup(it->second, *ch, dgram.m_addr);
+		}
+
+		// answered on every handshake asking for it, as peers keep sending them until they hear back
+		if ((header.m_flags & handshake_flag_relay_port) && m_relayPorts.isEnabled()) [[unlikely]]
+		{
+			if (const auto findChannel = m_channels.find(header.m_guid); findChannel != m_channels.end())
+				replyRelayPort(findChannel->second, dgram.m_addr);
+		}
+	}
+
+	const auto findAddressChannel = m_addressChannels.find(dgram.m_addr);
+	if (findAddressChannel == m_addressChannels.end())
+		return std::nullopt;
+
+	const channel_handle handle = findAddressChannel->second;
+	channel* const resolved = m_channelArena.resolve(handle);
+	if (resolved == nullptr) [[unlikely]]
+	{
+		// channel closed while address still pointed at it
+		m_xdp.removeRoute(findAddressChannel->first);
+		m_addressChannels.erase(findAddressChannel);
+		return std::nullopt;
+	}
+
+	// forwarding touches only channel's own cache line
+	touchChannel(*resolved, handle.m_index, dgram);
+
+	return handle.m_index;
+}
+
+void ur::relay::touchChannel(channel& ch, uint32_t channelIndex, const net::datagram& dgram)
+{
+	ch.m_lastUpdated = m_lastTickMs;
+
+	const uint32_t packets = dgram.m_segmentSize ? (dgram.m_bytes + dgram.m_segmentSize - 1) / dgram.m_segmentSize : 1;
+	ch.m_packetsReceived += packets;
+	ch.m_bytesReceived += dgram.m_bytes;
+	if (packets > 1)
+		m_channelArena.infoAt(channelIndex).m_stats.m_packetsCoalesced += packets;
+
+	// keep narrow counters far from overflow on channels with heavy traffic
+	if (ch.m_bytesReceived >= channel::foldThreshold || ch.m_bytesSent >= channel::foldThreshold) [[unlikely]]
+		m_channelArena.foldCounters(channelIndex);
+}
+
+void ur::relay::joinGroup(channel_handle handle, channel& ch, const net::socket_address& peer)
+{
+	if (isMember(ch, handle.m_index, peer))
+		return;
+
+	channel_info& info = m_channelArena.infoAt(handle.m_index);
+	if (info.m_group == group_pool::none)
+	{
+		info.m_group = m_groups.allocate();
+
+		// kernel fast path forwards pairs only, group traffic goes through relay from now on
+		if (m_xdp.isValid())
+		{
+			m_xdp.removeRoute(ch.m_peerA);
+			m_xdp.removeRoute(ch.m_peerB);
+		}
+	}
+
+	channel_group& group = m_groups.at(info.m_group);
+	if (group.m_count + 2 >= m_params.m_maxGroupSize)
+	{
+		LOG(Verbose, Relay, "Group \"{}\" is full, {} not joined", info.m_guid, peer);
+		return;
+	}
+
+	group.m_members[group.m_count++] = peer;
+	ch.m_lastUpdated = m_lastTickMs;
+	m_addressChannels[peer] = handle;
+
+	LOG(Info, Relay, "Peer joined group: \"{}\". Peer: {}, members: {}", info.m_guid, peer, group.m_count + 2);
+}
+
+std::span<const ur::net::socket_address> ur::relay::groupMembers(uint32_t channelIndex) noexcept
+{
+	const uint32_t group = m_channelArena.infoAt(channelIndex).m_group;
+	return group != group_pool::none ? m_groups.at(group).members() : std::span<const net::socket_address>();
+}
+
+bool ur::relay::isMember(const channel& ch, uint32_t channelIndex, const net::socket_address& peer) noexcept
+{
+	if (ch.m_peerA == peer || ch.m_peerB == peer)
+		return true;
+
+	const uint32_t group = m_channelArena.infoAt(channelIndex).m_group;
+	return group != group_pool::none && m_groups.at(group).contains(peer);
+}
+
+void ur::relay::replyRelayPort(channel_handle handle, const net::socket_address& peer)
+{
+	// port is of no use until other peer is known
+	const channel* const ch = m_channelArena.resolve(handle);
+	if (ch == nullptr || ch->m_peerB.isNull() || !isMember(*ch, handle.m_index, peer))
+		return;
+
+	channel_info& info = m_channelArena.infoAt(handle.m_index);
+	if (info.m_relayPort == 0)
+	{
+		allocated_port* port = m_relayPorts.allocate(handle);
+		if (port && !m_eventLoop.add(port->m_socket, port)) [[unlikely]]
+		{
+			m_relayPorts.release(*port);
+			port = nullptr;
+		}
+
+		if (port == nullptr)
+		{
+			m_stats.m_relayPortsExhausted++;
+			metric_add(m_metrics->m_relayPortsExhausted);
+			LOG(Warning, Relay, "No relay port left for channel \"{}\", {} of {} in use", info.m_guid, m_relayPorts.size(), m_relayPorts.capacity());
+			return;
+		}
+
+		info.m_relayPort = port->m_port;
+		m_stats.m_relayPortsAllocated++;
+		metric_add(m_metrics->m_relayPorts);
+		LOG(Info, Relay, "Relay port {} allocated for channel \"{}\"", port->m_port, info.m_guid);
+	}
+
+	handshake_header header{};
+	header.m_length = net::hton16(sizeof(handshake_relay_port));
+	header.m_flags = net::hton16(handshake_flag_relay_port);
+	header.m_guid = net::hton(info.m_guid);
+
+	handshake_relay_port extension{};
+	extension.m_header.m_length = net::hton16(sizeof(handshake_relay_port));
+	extension.m_header.m_type = net::hton16(static_cast<uint16_t>(handshake_extension_type::RelayPort));
+	extension.m_port = net::hton16(info.m_relayPort);
+
+	std::array<std::byte, sizeof(handshake_header) + sizeof(handshake_relay_port)> packet;
+	std::memcpy(packet.data(), &header, sizeof(header));
+	std::memcpy(packet.data() + sizeof(header), &extension, sizeof(extension));
+
+	// signed with the same key as handshakes, so peers can tell answer wasn't spoofed
+	if (m_hmac.hasKey())
+	{
+		hmac_sha256 mac{};
+		if (!m_hmac.compute(packet.data(), packet.size(), offsetof(handshake_header, m_mac), mac)) [[unlikely]]
+			return;
+		std::memcpy(packet.data() + offsetof(handshake_header, m_mac), mac.data(), mac.size());
+	}
+
+	m_socket.sendTo(packet.data(), packet.size(), peer);
+}
+
+void ur::relay::processRelayPorts()
+{
+	// single batch per port and iteration, so busy ports don't starve others. Drained ports leave the list
+	for (size_t i = 0; i < m_readablePorts.size();)
+	{
+		allocated_port& port = *m_readablePorts[i];
+		const int32_t received = port.m_socket.recvBatch(m_recvBatch);
+		if (received > 0)
+			forwardRelayPort(port, received);
+
+		const auto err = received < 0 ? net::udpsocket::getLastErrno() : 0;
+		const bool bDrained = received >= 0 ? size_t(received) < m_recvBatch.size() : err == EAGAIN || err == EWOULDBLOCK;
+		if (bDrained)
+		{
+			port.m_readable = false;
+			m_readablePorts[i] = m_readablePorts.back();
+			m_readablePorts.pop_back();
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+void ur::relay::forwardRelayPort(allocated_port& port, int32_t received)
+{
+	m_stats.m_recvBatches++;
+	m_stats.m_recvDatagrams += received;
+
+	channel* const ch = m_channelArena.resolve(port.m_channel);
+	const uint32_t channelIndex = port.m_channel.m_index;
+	const auto members = ch ? groupMembers(channelIndex) : std::span<const net::socket_address>();
+
+	uint64_t bytesIn{};
+	size_t count = 0;
+	const auto queue = [&](const net::datagram& dgram, const net::socket_address& dest)
+	{
+		if (count == m_sendBatch.size()) [[unlikely]]
+		{
+			sendRelayPort(port, count);
+			count = 0;
+		}
+
+		auto& sendDgram = m_sendBatch[count];
+		sendDgram.m_buffer = dgram.m_buffer;
+		sendDgram.m_bufferSize = dgram.m_bytes;
+		sendDgram.m_addr = dest;
+		sendDgram.m_segmentSize = 0;
+		sendDgram.m_rxTimestamp = dgram.m_rxTimestamp;
+		m_sendChannels[count] = channelIndex;
+		++count;
+	};
+
+	for (int32_t i = 0; i < received; ++i)
+	{
+		const net::datagram& dgram = m_recvBatch[i];
+		if (dgram.m_bytes < 0 || dgram.m_bytes > int32_t(sizeof(recv_buffer))) [[unlikely]]
+			continue;
+		bytesIn += dgram.m_bytes;
+
+		// socket already tells the channel, only direction is left to find
+		if (ch == nullptr || !isMember(*ch, channelIndex, dgram.m_addr)) [[unlikely]]
+		{
+			m_stats.m_relayPortStrays++;
+			continue;
+		}
+
+		touchChannel(*ch, channelIndex, dgram);
+
+		if (members.empty()) [[likely]]
+		{
+			queue(dgram, dgram.m_addr == ch->m_peerA ? ch->m_peerB : ch->m_peerA);
+			continue;
+		}
+
+		if (count + members.size() + 1 > m_sendBatch.size())
+		{
+			sendRelayPort(port, count);
+			count = 0;
+		}
+
+		for (const net::socket_address* peer : {&ch->m_peerA, &ch->m_peerB})
+		{
+			if (*peer != dgram.m_addr)
+				queue(dgram, *peer);
+		}
+		for (const net::socket_address& member : members)
+		{
+			if (member != dgram.m_addr)
+				queue(dgram, member);
+		}
+
+		// sender is one of members, everyone else got a copy
+		const uint32_t extra = static_cast<uint32_t>(members.size());
+		m_channelArena.infoAt(channelIndex).m_stats.m_fanoutCopies += extra;
+		m_stats.m_fanoutCopies += extra;
+	}
+	recordReceived(received, received, bytesIn);
+
+	sendRelayPort(port, count);
+}
+
+void ur::relay::sendRelayPort(allocated_port& port, size_t count)
+{
+	if (count == 0)
+		return;
+
+	const auto sendSpan = std::span(m_sendBatch.data(), count);
+	const int32_t sent = port.m_socket.sendBatch(sendSpan);
+
+	m_stats.m_sendBatches++;
+	m_stats.m_sendDatagrams += count;
+	metric_add(m_metrics->m_sendBatches);
+	if (sent < int32_t(count)) [[unlikely]]
+	{
+		// dedicated ports don't queue, whatever their socket had no room for is dropped
+		m_stats.m_sendPartial++;
+
+		uint64_t failed{};
+		for (const net::datagram& dgram : sendSpan)
+			failed += dgram.m_bytes < 0;
+		m_stats.m_sendDropped += failed;
+		metric_add(m_metrics->m_sendFailures, failed);
+	}
+
+	recordSent(sendSpan, m_sendChannels.data());
+}
+
+bool ur::relay::tryHandoff(const net::datagram& dgram, const handshake_header* verifiedHeader)
+{
+	uint32_t owner{};
+	if (verifiedHeader)
+	{
+		owner = shardOf(verifiedHeader->m_guid);
+		if (owner == m_shardIndex)
+		{
+			m_remoteRoutes.erase(dgram.m_addr);
+			return false;
+		}
+
+		// kernel keeps delivering packets from this address to this shard, remember where to route them
+		if (m_remoteRoutes.insert_or_assign(dgram.m_addr, remote_route{owner, m_lastTickTime}).second)
+			m_routeExpiryWheel.schedule(m_expiryTick + m_params.m_cleanupInactiveChannelAfterTime.count() / expiryTickMs + 1, dgram.m_addr);
+	}
+	else
+	{
+		if (m_remoteRoutes.empty())
+			return false;
+
+		const auto findRoute = m_remoteRoutes.find(dgram.m_addr);
+		if (findRoute == m_remoteRoutes.end())
+			return false;
+
+		findRoute->second.m_lastUpdated = m_lastTickTime;
+		owner = findRoute->second.m_shard;
+	}
+
+	handoff_ring* ring = m_outgoing[owner]->m_ring.load(std::memory_order_relaxed);
+	if (ring == nullptr) [[unlikely]]
+	{
+		// published before first push, release pairs with acquire of receiving shard
+		ring = new (std::nothrow) handoff_ring{};
+		if (ring == nullptr)
+		{
+			m_stats.m_handoffDropped++;
+			return true;
+		}
+		m_outgoing[owner]->m_ring.store(ring, std::memory_order_release);
+	}
+
+	handoff_datagram* slot = ring->producerSlot();
+	if (slot == nullptr) [[unlikely]]
+	{
+		m_stats.m_handoffDropped++;
+		return true;
+	}
+
+	slot->m_addr = dgram.m_addr;
+	slot->m_bytes = dgram.m_bytes;
+	slot->m_rxTimestamp = dgram.m_rxTimestamp;
+	slot->m_isHandshake = verifiedHeader != nullptr;
+	if (verifiedHeader)
+		slot->m_header = *verifiedHeader;
+	std::memcpy(slot->m_buffer.data(), dgram.m_buffer, dgram.m_bytes);
+	ring->push();
+
+	m_shardsToWake[owner] = 1;
+	m_stats.m_handoffSent++;
+	return true;
+}
+
+void ur::relay::processHandoffs()
+{
+	for (handoff_link* link : m_incoming)
+	{
+		handoff_ring* ring = link ? link->m_ring.load(std::memory_order_acquire) : nullptr;
+		if (ring == nullptr)
+			continue;
+
+		// datagrams are forwarded straight from ring memory, release them only after send
+		size_t count = 0;
+		for (; count < m_sendBatch.size(); ++count)
+		{
+			handoff_datagram* entry = ring->peek(count);
+			if (entry == nullptr)
+				break;
+
+			const net::datagram dgram{entry->m_buffer.data(), uint32_t(entry->m_buffer.size()), entry->m_bytes, entry->m_addr, 0, entry->m_rxTimestamp};
+			if (const auto channelIndex = processDatagram(dgram, entry->m_isHandshake ? &entry->m_header : nullptr))
+				queueSend(dgram, *channelIndex);
+		}
+
+		if (count == 0)
+			continue;
+
+		flushSendBatch();
+		ring->pop(count);
+
+		m_stats.m_handoffReceived += count;
+	}
+}
+
+void ur::relay::wakeShards()
+{
+	// pairs with fence in run(), either other shard sees handoff or this shard sees it sleeping
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	for (size_t i = 0; i < m_shardsToWake.size(); ++i)
+	{
+		if (m_shardsToWake[i] == 0)
+			continue;
+
+		m_shardsToWake[i] = 0;
+		if (m_shards[i]->m_sleeping.load(std::memory_order_relaxed))
+			m_shards[i]->m_eventLoop.wakeup();
+	}
+}
+
+bool ur::relay::hasPendingHandoffs() const
+{
+	return std::ranges::any_of(m_incoming, [](const handoff_link* link)
+		{
+			const handoff_ring* ring = link ? link->m_ring.load(std::memory_order_acquire) : nullptr;
+			return ring && !ring->empty();
+		});
+}
+
+uint32_t ur::relay::shardOf(const guid& g) const
+{
+	// shard's flat_map indexes by low bits of hash, take shard from high ones so both stay evenly spread
+	return static_cast<uint32_t>((uint64_t(std::hash<guid>{}(g)) >> 32) % m_shards.size());
+}
+
+void ur::relay::recordReceived(int32_t batchSize, uint64_t packets, uint64_t bytes) noexcept
+{
+	m_lastTraffic = m_lastTickTime;
+	m_rateWindowDatagrams += packets;
+
+	metric_add(m_metrics->m_recvBatches);
+	metric_add(m_metrics->m_recvBatchSizes[metric_batch_bucket(batchSize)]);
+	metric_add(m_metrics->m_recvBatchDatagrams, batchSize);
+	metric_add(m_metrics->m_packetsIn, packets);
+	metric_add(m_metrics->m_bytesIn, bytes);
+}
+
+void ur::relay::queueSend(const net::datagram& dgram, uint32_t channelIndex)
+{
+	const channel& ch = m_channelArena.at(channelIndex);
+
+	// pairs never look past channel's own cache line
+	const auto members = m_params.m_maxGroupSize > 2 ? groupMembers(channelIndex) : std::span<const net::socket_address>();
+	if (members.empty()) [[likely]]
+	{
+		queueSendTo(dgram, channelIndex, ch.m_peerA != dgram.m_addr ? ch.m_peerA : ch.m_peerB);
+		return;
+	}
+
+	// every member but sender gets a copy, all going out with the same send call
+	if (m_sendCount + members.size() + 1 > m_sendBatch.size())
+		flushSendBatch();
+
+	uint32_t copies = 0;
+	for (const net::socket_address* peer : {&ch.m_peerA, &ch.m_peerB})
+	{
+		if (*peer != dgram.m_addr)
+		{
+			queueSendTo(dgram, channelIndex, *peer);
+			++copies;
+		}
+	}
+	for (const net::socket_address& member : members)
+	{
+		if (member != dgram.m_addr)
+		{
+			queueSendTo(dgram, channelIndex, member);
+			++copies;
+		}
+	}
+
+	const uint32_t packets = dgram.m_segmentSize ? (dgram.m_bytes + dgram.m_segmentSize - 1) / dgram.m_segmentSize : 1;
+	const uint32_t extra = copies > 1 ? (copies - 1) * packets : 0;
+	m_channelArena.infoAt(channelIndex).m_stats.m_fanoutCopies += extra;
+	m_stats.m_fanoutCopies += extra;
+}
+
+void ur::relay::queueSendTo(const net::datagram& dgram, uint32_t channelIndex, const net::socket_address& dest)
+{
+	// socket is still full, keep order behind datagrams already waiting for it
+	if (!m_egress.empty()) [[unlikely]]
+	{
+		net::datagram queued = dgram;
+		queued.m_bufferSize = dgram.m_bytes;
+		queued.m_addr = dest;
+		queueEgress(channelIndex, queued);
+		return;
+	}
+
+	// GRO run might hold more segments than single GSO send accepts
+	const int32_t maxSendBytes = dgram.m_segmentSize ? int32_t(dgram.m_segmentSize * net::udpsocket::maxSendSegments) : dgram.m_bytes;
+	for (int32_t offset = 0; offset < dgram.m_bytes; offset += maxSendBytes)
+	{
+		if (m_sendCount == m_sendBatch.size()) [[unlikely]]
+			flushSendBatch();
+
+		auto& sendDgram = m_sendBatch[m_sendCount];
+		sendDgram.m_buffer = static_cast<std::byte*>(dgram.m_buffer) + offset;
+		sendDgram.m_bufferSize = std::min(maxSendBytes, dgram.m_bytes - offset);
+		sendDgram.m_addr = dest;
+		sendDgram.m_segmentSize = dgram.m_segmentSize;
+		sendDgram.m_rxTimestamp = dgram.m_rxTimestamp;
+		m_sendChannels[m_sendCount] = channelIndex;
+		++m_sendCount;
+	}
+}
+
+void ur::relay::flushSendBatch()
+{
+	if (m_sendCount == 0)
+		return;
+
+	const auto sendSpan = std::span(m_sendBatch.data(), m_sendCount);
+	const int32_t sent = m_transport->sendBatch(sendSpan);
+
+	m_stats.m_sendBatches++;
+	m_stats.m_sendDatagrams += m_sendCount;
+	metric_add(m_metrics->m_sendBatches);
+	if (sent < int32_t(m_sendCount)) [[unlikely]]
+	{
+		m_stats.m_sendPartial++;
+
+		// send buffer is full, get notified once it drains and keep what didn't fit until then
+		const auto err = net::udpsocket::getLastErrno();
+		const bool bBlocked = err == EAGAIN || err == EWOULDBLOCK;
+		if (bBlocked)
+		{
+			metric_add(m_metrics->m_sendEagain);
+			waitWritable();
+		}
+
+		uint64_t failed{};
+		for (size_t i = 0; i < m_sendCount; ++i)
+		{
+			if (sendSpan[i].m_bytes >= 0)
+				continue;
+
+			if (bBlocked && m_egress.isEnabled())
+				queueEgress(m_sendChannels[i], sendSpan[i]);
+			else
+				++failed;
+		}
+		m_stats.m_sendDropped += failed;
+		metric_add(m_metrics->m_sendFailures, failed);
+	}
+
+	recordSent(sendSpan, m_sendChannels.data());
+
+	m_sendCount = 0;
+}
+
+void ur::relay::queueEgress(uint32_t channelIndex, const net::datagram& dgram)
+{
+	channel_stats& stats = m_channelArena.infoAt(channelIndex).m_stats;
+	const uint32_t segmentSize = dgram.m_segmentSize ? dgram.m_segmentSize : dgram.m_bufferSize;
+	for (uint32_t offset = 0; offset < dgram.m_bufferSize; offset += segmentSize)
+	{
+		const uint32_t bytes = std::min(segmentSize, dgram.m_bufferSize - offset);
+		const egress_push result = m_egress.push(channelIndex, dgram.m_addr, static_cast<const std::byte*>(dgram.m_buffer) + offset, bytes, dgram.m_rxTimestamp);
+		if (result != egress_push::Dropped)
+		{
+			stats.m_packetsQueued++;
+			m_stats.m_egressQueued++;
+			metric_add(m_metrics->m_egressQueued);
+		}
+		if (result != egress_push::Queued)
+		{
+			stats.m_packetsQueueDropped++;
+			m_stats.m_egressDropped++;
+			metric_add(m_metrics->m_egressDropped);
+		}
+	}
+	m_metrics->m_egressDepth.store(m_egress.size(), std::memory_order_relaxed);
+}
+
+void ur::relay::drainEgress()
+{
+	while (!m_egress.empty())
+	{
+		const size_t count = m_egress.peek(m_sendBatch, m_sendChannels);
+		const auto sendSpan = std::span(m_sendBatch.data(), count);
+		const int32_t sent = m_transport->sendBatch(sendSpan);
+
+		m_stats.m_sendBatches++;
+		m_stats.m_sendDatagrams += count;
+		metric_add(m_metrics->m_sendBatches);
+
+		// datagrams past the last one sent stay queued while socket is full, rest failed for good
+		size_t done = count;
+		if (sent < int32_t(count)) [[unlikely]]
+		{
+			m_stats.m_sendPartial++;
+
+			const auto err = net::udpsocket::getLastErrno();
+			if (err == EAGAIN || err == EWOULDBLOCK)
+			{
+				metric_add(m_metrics->m_sendEagain);
+				waitWritable();
+				while (done > 0 && sendSpan[done - 1].m_bytes < 0)
+					--done;
+			}
+
+			uint64_t failed{};
+			for (size_t i = 0; i < done; ++i)
+				failed += sendSpan[i].m_bytes < 0;
+			m_stats.m_sendDropped += failed;
+			metric_add(m_metrics->m_sendFailures, failed);
+		}
+
+		recordSent(sendSpan.first(done), m_sendChannels.data());
+		m_egress.consume(std::span<const uint32_t>(m_sendChannels.data(), done));
+
+		if (done < count)
+			break;
+	}
+	m_metrics->m_egressDepth.store(m_egress.size(), std::memory_order_relaxed);
+}
+
+void ur::relay::recordSent(std::span<const net::datagram> sent, const uint32_t* channels)
+{
+	uint64_t packetsOut{};
+	uint64_t bytesOut{};
+
+	for (size_t i = 0; i < sent.size(); ++i)
+	{
+		if (sent[i].m_bytes < 0) [[unlikely]]
+			continue;
+
+		channel& ch = m_channelArena.at(channels[i]);
+		const uint32_t packets = sent[i].m_segmentSize && sent[i].m_bufferSize > sent[i].m_segmentSize
+									 ? (sent[i].m_bufferSize + sent[i].m_segmentSize - 1) / sent[i].m_segmentSize
+									 : 1;
+		if (packets > 1)
+			m_channelArena.infoAt(channels[i]).m_stats.m_coalescedSends++;
+		ch.m_packetsSent += packets;
+		ch.m_bytesSent += sent[i].m_bytes;
+		packetsOut += packets;
+		bytesOut += sent[i].m_bytes;
+	}
+	metric_add(m_metrics->m_packetsOut, packetsOut);
+	metric_add(m_metrics->m_bytesOut, bytesOut);
+
+	if (m_params.m_residency)
+		recordResidency(sent);
+}
+
+void ur::relay::waitWritable()
+{
+	if (!m_socketSendBlocked && m_eventLoop.isValid())
+		m_socketSendBlocked = m_eventLoop.setWantWrite(m_socket, &m_socket, true);
+}
+
+void ur::relay::tuneRecvBuffer()
+{
+	if (m_stats.m_recvDropped == m_recvDroppedTuned)
+		return;
+
+	const uint64_t dropped = m_stats.m_recvDropped - m_recvDroppedTuned;
+	m_recvDroppedTuned = m_stats.m_recvDropped;
+
+	// linux reports doubled size, half of it is left for bookkeeping overhead
+	const int32_t current = m_socket.getRecvBufferSize() / (UR_PLATFORM_LINUX ? 2 : 1);
+	const uint32_t ceiling = m_params.m_socketRecvBufferMax;
+	if (ceiling == 0 || uint32_t(current) >= ceiling)
+	{
+		LOG(Warning, Relay, "Kernel dropped {} datagrams, receive buffer full. RcvBuf={}", dropped, current);
+		return;
+	}
+
+	// force lifts net.core.rmem_max limit when permitted, regular option is capped by it
+	const int32_t requested = static_cast<int32_t>(std::min<uint64_t>(uint64_t(current) * 2, ceiling));
+	const bool forced = m_socket.setRecvBufferSizeForce(requested);
+	if (!forced && !m_socket.setRecvBufferSize(requested))
+	{
+		LOG(Warning, Relay, "Kernel dropped {} datagrams, failed to grow receive buffer to {}", dropped, requested);
+		return;
+	}
+
+	const int32_t applied = m_socket.getRecvBufferSize() / (UR_PLATFORM_LINUX ? 2 : 1);
+	LOG(Info, Relay, "Kernel dropped {} datagrams, receive buffer grown {} -> {} (requested {}{})", dropped, current, applied, requested, forced ? ", forced" : "");
+
+	// capped by system limit, further attempts won't change anything
+	if (applied <= current)
+		m_params.m_socketRecvBufferMax = uint32_t(applied);
+}
+
+void ur::relay::recordResidency(std::span<const net::datagram> sent)
+{
+	// single clock read per batch, realtime clock as kernel stamps datagrams with it
+	const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	for (const net::datagram& dgram : sent)
+	{
+		if (dgram.m_bytes >= 0 && dgram.m_rxTimestamp)
+			m_residency.record(static_cast<uint64_t>(std::max<int64_t>(now - dgram.m_rxTimestamp, 0)));
+	}
+}
+
+std::optional<ur::channel_handle> ur::relay::allocateChannel(const guid& channelGuid, const net::socket_address& peerA)
+{
+	const auto handle = m_channelArena.allocate();
+	if (!handle) [[unlikely]]
+		return std::nullopt;
+
+	channel& ch = *m_channelArena.resolve(*handle);
+	ch.m_peerA = peerA;
+	ch.m_lastUpdated = m_lastTickMs;
+	m_channelArena.infoAt(handle->m_index).m_guid = channelGuid;
+
+	// traffic doesn't move channel on the wheel, it's re-armed from m_lastUpdated once due
+	m_expiryWheel.schedule(expiryTickOf(ch), *handle);
+	metric_add(m_metrics->m_channelsPending);
+	return handle;
+}
+
+void ur::relay::closeChannel(channel_handle handle)
+{
+	const channel& ch = m_channelArena.at(handle.m_index);
+
+	m_channels.erase(m_channelArena.infoAt(handle.m_index).m_guid);
+
+	// peers might have moved to newer channel already, keep their mappings then
+	const auto eraseMapping = [&](const net::socket_address& peer)
+	{
+		const auto findAddressChannel = m_addressChannels.find(peer);
+		if (findAddressChannel != m_addressChannels.end() && findAddressChannel->second == handle)
+		{
+			m_xdp.removeRoute(peer);
+			m_addressChannels.erase(findAddressChannel);
+		}
+	};
+	eraseMapping(ch.m_peerA);
+	eraseMapping(ch.m_peerB);
+
+	if (uint32_t& group = m_channelArena.infoAt(handle.m_index).m_group; group != group_pool::none) [[unlikely]]
+	{
+		for (const net::socket_address& member : m_groups.at(group).members())
+			eraseMapping(member);
+		m_groups.release(group);
+		group = group_pool::none;
+	}
+
+	metric_sub(ch.m_peerB.isNull() ? m_metrics->m_channelsPending : m_metrics->m_channelsEstablished);
+
+	// late datagrams to dedicated port are refused by kernel once its socket is closed
+	if (allocated_port* port = m_relayPorts.find(m_channelArena.infoAt(handle.m_index).m_relayPort))
+	{
+		if (port->m_readable)
+			std::erase(m_readablePorts, port);
+		m_eventLoop.remove(port->m_socket);
+		m_relayPorts.release(*port);
+		metric_sub(m_metrics->m_relayPorts);
+	}
+
+	if (const uint32_t purged = m_egress.purge(handle.m_index)) [[unlikely]]
+	{
+		m_stats.m_egressDropped += purged;
+		metric_add(m_metrics->m_egressDropped, purged);
+		m_metrics->m_egressDepth.store(m_egress.size(), std::memory_order_relaxed);
+	}
+
+	m_channelArena.release(handle);
+}
+
+void ur::relay::syncKernelStats(uint32_t channelIndex)
+{
+	channel& ch = m_channelArena.at(channelIndex);
+	channel_stats& stats = m_channelArena.infoAt(channelIndex).m_stats;
+
+	uint64_t packets{};
+	uint64_t bytes{};
+	for (const net::socket_address* peer : {&ch.m_peerA, &ch.m_peerB})
+	{
+		uint64_t peerPackets{};
+		uint64_t peerBytes{};
+		if (m_xdp.readCounters(*peer, peerPackets, peerBytes))
+		{
+			packets += peerPackets;
+			bytes += peerBytes;
+		}
+	}
+
+	// datagrams forwarded in kernel never reach relay socket, counters are the only sign of activity
+	if (static_cast<uint32_t>(packets) != stats.m_packetsInKernel)
+	{
+		ch.m_lastUpdated = m_lastTickMs;
+		stats.m_packetsInKernel = static_cast<uint32_t>(packets);
+		stats.m_bytesInKernel = bytes;
+	}
+}
+
+void ur::relay::conditionalCleanup()
+{
+	if (m_lastTickTime < m_nextCleanupTime)
+		return;
+
+	m_nextCleanupTime = m_lastTickTime + m_params.m_cleanupTime;
+	if (m_eventLoop.isValid())
+		m_eventLoop.addTimer(m_nextCleanupTime, nullptr);
+
+	if (m_stats.m_recvBatches)
+	{
+		const double fillRatio = double(m_stats.m_recvDatagrams) / double(m_stats.m_recvBatches * m_recvBatch.size());
+		LOG(Verbose, Relay, "Batch stats. Recv: {} batches, {:.1f}% fill, {} dropped by kernel; Send: {} batches, {} partial, {} dropped; Egress: {} queued, {} dropped, {} waiting; Groups: {}, {} fan-out copies",
+			m_stats.m_recvBatches, fillRatio * 100., m_stats.m_recvDropped, m_stats.m_sendBatches, m_stats.m_sendPartial, m_stats.m_sendDropped,
+			m_stats.m_egressQueued, m_stats.m_egressDropped, m_egress.size(), m_groups.size(), m_stats.m_fanoutCopies);
+		if (m_shards.size() > 1)
+			LOG(Verbose, Relay, "Shard {} handoff stats. Sent: {}; Received: {}; Dropped: {}; Routes: {}",
+				m_shardIndex, m_stats.m_handoffSent, m_stats.m_handoffReceived, m_stats.m_handoffDropped, m_remoteRoutes.size());
+	}
+
+	if (m_handshakeCache.isEnabled() && (m_stats.m_handshakeCacheHits || m_stats.m_handshakeCacheMisses))
+		LOG(Verbose, Relay, "Handshake cache stats. Hits: {}; Misses: {}; Capacity: {}",
+			m_stats.m_handshakeCacheHits, m_stats.m_handshakeCacheMisses, m_handshakeCache.capacity());
+
+	if (m_stats.m_handshakesShed)
+		LOG(Verbose, Relay, "Handshakes shed by rate limit: {}", m_stats.m_handshakesShed);
+
+	if (m_relayPorts.isEnabled())
+		LOG(Verbose, Relay, "Shard {} relay ports. In use: {} of {}; Allocated: {}; Exhausted: {}; Strays: {}",
+			m_shardIndex, m_relayPorts.size(), m_relayPorts.capacity(), m_stats.m_relayPortsAllocated, m_stats.m_relayPortsExhausted, m_stats.m_relayPortStrays);
+
+	tuneRecvBuffer();
+
+	if (m_params.m_latencyMode != latency_mode::Wait)
+	{
+		const uint64_t workNs = m_stats.m_loopWorkNs - m_loopWorkReported;
+		const uint64_t spinNs = m_stats.m_loopSpinNs - m_loopSpinReported;
+		const uint64_t sleepNs = m_stats.m_loopSleepNs - m_loopSleepReported;
+		const double totalNs = double(workNs + spinNs + sleepNs);
+		if (totalNs > 0)
+			LOG(Info, Relay, "Shard {} loop time. Working: {:.1f}%; Spinning: {:.1f}%; Sleeping: {:.1f}%; Packet rate: {:.0f}/s",
+				m_shardIndex, workNs * 100. / totalNs, spinNs * 100. / totalNs, sleepNs * 100. / totalNs, m_packetRate);
+		m_loopWorkReported = m_stats.m_loopWorkNs;
+		m_loopSpinReported = m_stats.m_loopSpinNs;
+		m_loopSleepReported = m_stats.m_loopSleepNs;
+	}
+
+	// residency is reported for each interval, so it reflects recent load
+	if (m_residency.count())
+	{
+		LOG(Info, Relay, "Shard {} residency over {} datagrams. p50: {:.1f}us; p99: {:.1f}us; p99.9: {:.1f}us; max: {:.1f}us",
+			m_shardIndex, m_residency.count(), m_residency.percentile(50.) / 1000., m_residency.percentile(99.) / 1000.,
+			m_residency.percentile(99.9) / 1000., m_residency.max() / 1000.);
+		m_residency.reset();
+	}
+
+	ur::log_flush();
+}
+
+void ur::relay::expireInactive()
+{
+	uint32_t budget = m_params.m_expiryBudget;
+
+	net::socket_address routeAddr{};
+	while (m_routeExpiryWheel.popExpired(m_expiryTick, routeAddr, budget))
+	{
+		const auto findRoute = m_remoteRoutes.find(routeAddr);
+		if (findRoute == m_remoteRoutes.end())
+			continue;
+
+		const auto expiresAt = findRoute->second.m_lastUpdated + m_params.m_cleanupInactiveChannelAfterTime;
+		if (expiresAt > m_lastTickTime)
+			m_routeExpiryWheel.schedule(std::chrono::duration_cast<std::chrono::milliseconds>(expiresAt - m_startTime).count() / expiryTickMs + 1, routeAddr);
+		else
+			m_remoteRoutes.erase(findRoute);
+	}
+
+	channel_handle handle{};
+	while (m_expiryWheel.popExpired(m_expiryTick, handle, budget))
+	{
+		channel* const ch = m_channelArena.resolve(handle);
+		if (ch == nullptr) [[unlikely]]
+			continue;
+
+		if (m_xdp.isValid() && !ch->m_peerB.isNull())
+			syncKernelStats(handle.m_index);
+
+		if (const uint64_t deadline = expiryTickOf(*ch); deadline > m_expiryTick)
+		{
+			m_expiryWheel.schedule(deadline, handle);
+			continue;
+		}
+
+		m_channelArena.foldCounters(handle.m_index);
+		const channel_info& info = m_channelArena.infoAt(handle.m_index);
+		const auto& stats = info.m_stats;
+		// group copies are sent on top of received datagrams, byte drops are only known for pairs
+		const uint32_t members = info.m_group != group_pool::none ? m_groups.at(info.m_group).m_count + 2 : 2;
+		LOG(Info, Relay, "Channel closed: \"{0}\". Received: {1} packets ({2} bytes); Dropped: {3} ({4}); Coalesced: {5} packets, {6} sends; In kernel: {7} packets ({8} bytes); Queued: {9} packets, {10} dropped; Members: {11}, {12} fan-out copies;",
+			info.m_guid, stats.m_packetsReceived, stats.m_bytesReceived, stats.m_packetsReceived + stats.m_fanoutCopies - stats.m_packetsSent,
+			members > 2 ? 0 : stats.m_bytesReceived - stats.m_bytesSent, stats.m_packetsCoalesced, stats.m_coalescedSends, stats.m_packetsInKernel, stats.m_bytesInKernel,
+			stats.m_packetsQueued, stats.m_packetsQueueDropped, members, stats.m_fanoutCopies);
+		closeChannel(handle);
+		metric_add(m_metrics->m_channelsExpired);
+	}
+
+	// more might be due, come back without sleeping
+	m_expiryPending = budget == 0;
+}
+
+uint64_t ur::relay::expiryTickOf(const channel& ch) const
+{
+	const uint32_t inactiveMs = m_lastTickMs - ch.m_lastUpdated;
+	const auto timeoutMs = static_cast<uint64_t>(m_params.m_cleanupInactiveChannelAfterTime.count());
+	return inactiveMs < timeoutMs ? m_expiryTick + (timeoutMs - inactiveMs) / expiryTickMs + 1 : m_expiryTick;
+}
+
+void ur::relay::updateTickTime()
+{
+	m_lastTickTime = m_clock->now();
+	const auto uptimeMs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(m_lastTickTime - m_startTime).count());
+	m_lastTickMs = static_cast<uint32_t>(uptimeMs);
+	m_expiryTick = uptimeMs / expiryTickMs;
+}
+
+void ur::relay::updatePacketRate() noexcept
+{
+	const auto elapsed = m_lastTickTime - m_rateWindowStart;
+	if (elapsed < rateWindow)
+		return;
+
+	// idle time ends up in single window, so rate falls quickly once traffic stops
+	const double windowRate = double(m_rateWindowDatagrams) / std::chrono::duration<double>(elapsed).count();
+	m_packetRate = m_packetRate * 0.75 + windowRate * 0.25;
+	m_rateWindowStart = m_lastTickTime;
+	m_rateWindowDatagrams = 0;
+}
+
+bool ur::relay::shouldSpin() const noexcept
+{
+	if (m_params.m_latencyMode == latency_mode::Wait)
+		return false;
+
+	const auto budget = std::chrono::microseconds(m_params.m_spinBudgetUs);
+	if (m_lastTickTime - m_lastTraffic >= budget)
+		return false;
+
+	// at that rate next datagram is due within budget
+	return m_params.m_latencyMode == latency_mode::Busy || m_packetRate * std::chrono::duration<double>(budget).count() >= 1.;
+}
+
+void ur::relay::recordLoopTime(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point waited, bool bBlocked, uint64_t processedBefore) noexcept
+{
+	const auto end = std::chrono::steady_clock::now();
+	const auto toNs = [](std::chrono::steady_clock::duration duration)
+	{
+		return static_cast<uint64_t>(std::max<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(), 0));
+	};
+
+	uint64_t waitNs = toNs(waited - start);
+	uint64_t restNs = toNs(end - waited);
+	if (bBlocked)
+	{
+		m_stats.m_loopSleepNs += waitNs;
+		metric_add(m_metrics->m_loopSleepNs, waitNs);
+		waitNs = 0;
+	}
+
+	if (processedDatagrams() != processedBefore)
+	{
+		m_stats.m_loopWorkNs += waitNs + restNs;
+		metric_add(m_metrics->m_loopWorkNs, waitNs + restNs);
+	}
+	else
+	{
+		m_stats.m_loopSpinNs += waitNs + restNs;
+		metric_add(m_metrics->m_loopSpinNs, waitNs + restNs);
+	}
+}
+
+std::pair<bool, ur::handshake_header> ur::relay_helpers::tryDeserializeHeader(hmac_verifier& verifier, const recv_buffer& recvBuffer, size_t recvBytes)
+{
+	auto result = tryParseHeader(recvBuffer, recvBytes);
+	if (result.first && verifier.hasKey() && !verifyMac(verifier, recvBuffer, recvBytes, result.second)) // ignore HMAC validation if key not provided
+		return std::pair<bool, handshake_header>();
+	return result;
+}
+
+std::pair<bool, ur::handshake_header> ur::relay_helpers::tryParseHeader(const recv_buffer& recvBuffer, size_t recvBytes)
+{
+	// not a handshake packet
+	if (recvBytes < sizeof(handshake_header))
+		return std::pair<bool, handshake_header>();
+	else if (std::memcmp(recvBuffer.data(), &handshake_magic_number_be, sizeof(handshake_header::m_magicNumber)) != 0)
+		return std::pair<bool, handshake_header>();
+
+	handshake_header recvHeader{};
+	std::memcpy(&recvHeader, recvBuffer.data(), sizeof(recvHeader));
+
+	recvHeader.m_length = ur::net::ntoh(recvHeader.m_length);
+	recvHeader.m_flags = ur::net::ntoh(recvHeader.m_flags);
+	recvHeader.m_guid = ur::net::ntoh(recvHeader.m_guid);
+
+	if (const uint16_t len = recvHeader.m_length + sizeof(handshake_header); len != recvBytes)
+	{
+		LOG(Debug, RelayHelpers, "Packet length invalid. Expected: {}, received: {}", len, recvBytes);
+	}
+
+	constexpr guid zeroGuid{};
+	if (recvHeader.m_guid == zeroGuid)
+	{
+		LOG(Debug, RelayHelpers, "Packet guid must not be zero'd");
+		return std::pair<bool, handshake_header>();
+	}
+
+	return std::pair<bool, handshake_header>{true, recvHeader};
+}
+
+uint16_t ur::relay_helpers::tryParseRelayPort(const recv_buffer& recvBuffer, size_t recvBytes)
+{
+	const auto [isValid, header] = tryParseHeader(recvBuffer, recvBytes);
+	if (!isValid || !(header.m_flags & handshake_flag_relay_port) || recvBytes < sizeof(handshake_header) + sizeof(handshake_relay_port))
+		return 0;
+
+	handshake_relay_port extension{};
+	std::memcpy(&extension, recvBuffer.data() + sizeof(handshake_header), sizeof(extension));
+	if (net::ntoh(extension.m_header.m_type) != static_cast<uint16_t>(handshake_extension_type::RelayPort) ||
+		net::ntoh(extension.m_header.m_length) < sizeof(handshake_relay_port))
+		return 0;
+
+	return net::ntoh(extension.m_port);
+}
+
+bool ur::relay_helpers::verifyMac(hmac_verifier& verifier, const recv_buffer& recvBuffer, size_t recvBytes, const handshake_header& header)
+{
+	// mac is computed over packet with mac field zero'd
+	if (!verifier.verify(recvBuffer.data(), recvBytes, offsetof(handshake_header, m_mac), header.m_mac))
+	{
+		LOG(Debug, RelayHelpers, "Packet HMAC_sha256 invalid");
+		return false;
+	}
+	return true;
 }
 
 ur::secret_key ur::relay_helpers::makeSecret(std::string_view b64)
@@ -0,0 +1,223 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include "udp-relay/relay_group.hxx"
+
+#include "udp-relay/log.hxx"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#if UR_PLATFORM_LINUX
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace
+{
+	// cpus kept away from scheduler with isolcpus=, listed like "2-3,6"
+	std::vector<int32_t> read_isolated_cpus()
+	{
+		std::vector<int32_t> cpus{};
+#if UR_PLATFORM_LINUX
+		std::ifstream file("/sys/devices/system/cpu/isolated");
+		std::string range{};
+		while (std::getline(file, range, ','))
+		{
+			int32_t first{};
+			int32_t last{};
+			const int parsed = std::sscanf(range.c_str(), "%d-%d", &first, &last);
+			if (parsed < 1)
+				continue;
+			for (int32_t cpu = first; cpu <= (parsed == 2 ? last : first); ++cpu)
+				cpus.push_back(cpu);
+		}
+#endif
+		return cpus;
+	}
+
+	bool pin_thread([[maybe_unused]] std::thread::native_handle_type thread, [[maybe_unused]] int32_t cpu)
+	{
+#if UR_PLATFORM_LINUX
+		cpu_set_t cpuSet;
+		CPU_ZERO(&cpuSet);
+		CPU_SET(cpu, &cpuSet);
+		return pthread_setaffinity_np(thread, sizeof(cpuSet), &cpuSet) == 0;
+#else
+		return false;
+#endif
+	}
+} // namespace
+
+bool ur::relay_group::init(relay_params params, secret_key key)
+{
+	uint32_t workers = std::max<uint32_t>(params.m_workers, 1);
+#if !UR_PLATFORM_LINUX
+	if (workers > 1)
+	{
+		LOG(Warning, Relay, "Multiple workers require SO_REUSEPORT and supported only on linux. Using single worker");
+		workers = 1;
+	}
+#endif
+	params.m_workers = workers;
+
+	m_relays.clear();
+	m_links.reset();
+
+	for (uint32_t i = 0; i < workers; ++i)
+		m_relays.emplace_back(std::make_unique<relay>());
+
+	if (workers > 1)
+	{
+		// rings themselves are allocated by shards on first handoff
+		m_links = std::make_unique<handoff_link[]>(size_t(workers) * workers);
+
+		std::vector<relay*> shards{};
+		for (const auto& shard : m_relays)
+			shards.push_back(shard.get());
+
+		for (uint32_t i = 0; i < workers; ++i)
+		{
+			std::vector<handoff_link*> outgoing(workers);
+			std::vector<handoff_link*> incoming(workers);
+			for (uint32_t j = 0; j < workers; ++j)
+			{
+				if (i == j)
+					continue;
+				outgoing[j] = &m_links[i * workers + j];
+				incoming[j] = &m_links[j * workers + i];
+			}
+			m_relays[i]->setShard(i, shards, outgoing, incoming);
+		}
+	}
+
+	for (uint32_t i = 0; i < workers; ++i)
+	{
+		if (!m_relays[i]->init(params, key))
+		{
+			LOG(Error, Relay, "Failed to initialize relay shard {}", i);
+			return false;
+		}
+
+		// other shards must bind to the very same port
+		if (i == 0)
+			params.m_primaryPort = m_relays[0]->getPort();
+	}
+
+	// shards spread over cores by default, spinning ones prefer isolated cores
+	const int32_t cpuCount = static_cast<int32_t>(std::max(std::thread::hardware_concurrency(), 1U));
+	const std::vector<int32_t> isolated = params.m_latencyMode != latency_mode::Wait && params.m_cpu < 0 ? read_isolated_cpus() : std::vector<int32_t>{};
+	m_cpus.assign(workers, -1);
+	for (uint32_t i = 0; i < workers; ++i)
+	{
+		if (params.m_cpu >= 0)
+			m_cpus[i] = (params.m_cpu + int32_t(i)) % cpuCount;
+		else if (!isolated.empty())
+			m_cpus[i] = isolated[i % isolated.size()];
+		else if (workers > 1)
+			m_cpus[i] = int32_t(i) % cpuCount;
+	}
+
+	if (params.m_latencyMode != latency_mode::Wait && params.m_cpu < 0)
+	{
+		if (isolated.empty())
+		{
+			LOG(Warning, Relay, "No isolated cpus found, spinning workers share cores with other tasks. Isolate some with isolcpus= or pick with --cpu");
+		}
+		else if (isolated.size() < workers)
+		{
+			LOG(Warning, Relay, "{} isolated cpus for {} workers, some of them share cores", isolated.size(), workers);
+		}
+	}
+
+	// segment is named after port, known only once first shard is bound
+	if (params.m_metrics)
+	{
+		if (!m_metrics.create(params.m_primaryPort, workers, true))
+			return false;
+
+		for (uint32_t i = 0; i < workers; ++i)
+			m_relays[i]->setMetrics(&m_metrics.worker(i));
+
+		LOG(Info, Relay, "Metrics published as {}", metrics_segment::nameOf(params.m_primaryPort));
+	}
+
+	if (workers > 1)
+		LOG(Info, Relay, "Relay group initialized with {} workers", workers);
+
+	return true;
+}
+
+void ur::relay_group::run()
+{
+	if (m_relays.size() == 1)
+	{
+#if UR_PLATFORM_LINUX
+		if (m_cpus[0] >= 0 && !pin_thread(pthread_self(), m_cpus[0]))
+			LOG(Warning, Relay, "Failed to pin relay to cpu {}", m_cpus[0]);
+#endif
+		m_relays[0]->run();
+		return;
+	}
+
+	std::vector<std::thread> threads{};
+	threads.reserve(m_relays.size());
+	for (size_t i = 0; i < m_relays.size(); ++i)
+	{
+		threads.emplace_back([shard = m_relays[i].get()]()
+			{ shard->run(); });
+
+		// keep each shard on own core, so its socket, rings and channels stay in that core caches
+		if (m_cpus[i] >= 0 && !pin_thread(threads.back().native_handle(), m_cpus[i]))
+			LOG(Warning, Relay, "Failed to pin shard {} to cpu {}", i, m_cpus[i]);
+	}
+
+	for (auto& thread : threads)
+		thread.join();
+}
+
+void ur::relay_group::stop()
+{
+	for (const auto& shard : m_relays)
+		shard->stop();
+}
+
+void ur::relay_group::stopGracefully()
+{
+	for (const auto& shard : m_relays)
+		shard->stopGracefully();
+}
+
+ur::relay_stats ur::relay_group::getStats() const
+{
+	relay_stats total{};
+	for (const auto& shard : m_relays)
+	{
+		const relay_stats& stats = shard->getStats();
+		total.m_recvBatches += stats.m_recvBatches;
+		total.m_recvDatagrams += stats.m_recvDatagrams;
+		total.m_sendBatches += stats.m_sendBatches;
+		total.m_sendDatagrams += stats.m_sendDatagrams;
+		total.m_sendPartial += stats.m_sendPartial;
+		total.m_sendDropped += stats.m_sendDropped;
+		total.m_recvDropped += stats.m_recvDropped;
+		total.m_egressQueued += stats.m_egressQueued;
+		total.m_egressDropped += stats.m_egressDropped;
+		total.m_fanoutCopies += stats.m_fanoutCopies;
+		total.m_handoffSent += stats.m_handoffSent;
+		total.m_handoffReceived += stats.m_handoffReceived;
+		total.m_handoffDropped += stats.m_handoffDropped;
+		total.m_handshakeCacheHits += stats.m_handshakeCacheHits;
+		total.m_handshakeCacheMisses += stats.m_handshakeCacheMisses;
+		total.m_handshakesShed += stats.m_handshakesShed;
+		total.m_relayPortsAllocated += stats.m_relayPortsAllocated;
+		total.m_relayPortsExhausted += stats.m_relayPortsExhausted;
+		total.m_relayPortStrays += stats.m_relayPortStrays;
+		total.m_loopWorkNs += stats.m_loopWorkNs;
+		total.m_loopSpinNs += stats.m_loopSpinNs;
+		total.m_loopSleepNs += stats.m_loopSleepNs;
+	}
+	return total;
+}
@@ -2,17 +2,24 @@
 
 #include "udp-relay/log.hxx"
 #include "udp-relay/main_helpers.hxx"
-#include "udp-relay/relay.hxx"
+#include "udp-relay/relay_group.hxx"
 
 #include <array>
+#include <charconv>
 #include <csignal>
 #include <print>
 #include <stacktrace>
 
+#if UR_PLATFORM_LINUX
+#include <sys/resource.h>
+#endif
+
 namespace cl
 {
 	static bool printHelp{}; // when true - prints help and exits
 	static ur::relay_params relayParams{};
+	static std::string latencyMode{"wait"};
+	static std::string relayPorts{};
 } // namespace cl
 
 namespace env
@@ -27,10 +34,37 @@ static constexpr auto argList = std::array
 	ur::cl_var_ref{"--log-level", ur::runtime_log_verbosity,												"--log-level 0-4							= set log level no logs - verbose" },
 	ur::cl_var_ref{"--port", cl::relayParams.m_primaryPort,												"--port 0-65535								= main port for accepting requests" },
 	ur::cl_var_ref{"--socketRecvBufferSize", cl::relayParams.m_socketRecvBufferSize,						"--socketRecvBufferSize <value>             = receive buffer size for internal socket" },
+	ur::cl_var_ref{"--socketRecvBufferMax", cl::relayParams.m_socketRecvBufferMax,						"--socketRecvBufferMax <value>              = grow receive buffer up to that size while kernel drops datagrams, 0 disables" },
 	ur::cl_var_ref{"--socketSendBufferSize", cl::relayParams.m_socketSendBufferSize,						"--socketSendBufferSize <value>             = send buffer size for internal socket" },
 	ur::cl_var_ref{"--cleanupTime", cl::relayParams.m_cleanupTime,										"--cleanupTime <value>						= time in ms, how often relay should perform clean check" },
 	ur::cl_var_ref{"--cleanupInactiveAfterTime", cl::relayParams.m_cleanupInactiveChannelAfterTime,		"--cleanupInactiveAfterTime <value>			= time in ms, inactivity timeout for channel" },
+	ur::cl_var_ref{"--expiry-budget", cl::relayParams.m_expiryBudget,									"--expiry-budget <value>						= max channels & routes checked for inactivity per loop iteration, 256 by default" },
+	ur::cl_var_ref{"--handshake-cache", cl::relayParams.m_handshakeCacheSize,							"--handshake-cache <value>					= verified handshakes remembered so repeated ones skip HMAC, 1024 by default, 0 disables" },
+	ur::cl_var_ref{"--handshake-rate", cl::relayParams.m_handshakeRate,									"--handshake-rate <value>					= handshakes per second single address may send before being shed, 64 by default, 0 disables" },
+	ur::cl_var_ref{"--handshake-prefix-rate", cl::relayParams.m_handshakePrefixRate,						"--handshake-prefix-rate <value>			= same for /24 ipv4 or /64 ipv6 prefix per worker, 4096 by default, 0 disables" },
+	ur::cl_var_ref{"--batchSize", cl::relayParams.m_batchSize,											"--batchSize 1-64							= max datagrams received & sent with single syscall" },
+	ur::cl_var_ref{"--egress-queue", cl::relayParams.m_egressQueueSize,									"--egress-queue <value>						= datagrams kept per worker while socket send buffer is full, sent once it drains. 4096 by default, 0 disables" },
+	ur::cl_var_ref{"--egress-channel-limit", cl::relayParams.m_egressChannelLimit,						"--egress-channel-limit <value>				= max datagrams single channel may have queued, 256 by default" },
+	ur::cl_var_ref{"--egress-drop-oldest", cl::relayParams.m_egressDropOldest,							"--egress-drop-oldest						= once queue is full drop oldest datagram of channel rather than new one" },
+	ur::cl_var_ref{"--latency-mode", cl::latencyMode,													"--latency-mode wait|busy|adaptive			= block until datagrams arrive, spin on receives for spin budget after each one, or spin only while packet rate is high" },
+	ur::cl_var_ref{"--spin-budget", cl::relayParams.m_spinBudgetUs,										"--spin-budget <value>						= time in us relay spins without traffic before blocking, 200 by default" },
+	ur::cl_var_ref{"--busy-poll", cl::relayParams.m_busyPollUs,											"--busy-poll <value>						= SO_BUSY_POLL time in us while spinning (linux), 50 by default, 0 disables" },
+	ur::cl_var_ref{"--cpu", cl::relayParams.m_cpu,														"--cpu <value>								= pin worker 0 to that cpu and others to following ones (linux). Spinning workers pick isolated cpus by default" },
+	ur::cl_var_ref{"--max-group-size", cl::relayParams.m_maxGroupSize,									"--max-group-size 2-16						= peers sharing channel guid, each receiving datagrams of all others. 2 by default" },
+	ur::cl_var_ref{"--relay-ports", cl::relayPorts,														"--relay-ports <first>-<last>				= hand channels dedicated relay port from range when peers ask with handshake flag, workers split range" },
 	ur::cl_var_ref{"--ipv6", cl::relayParams.ipv6,														"--ipv6 0|1									= should create and bind to ipv6 socket (dual-stack ipv4/6 mode)" },
+	ur::cl_var_ref{"--workers", cl::relayParams.m_workers,												"--workers <value>							= amount of worker threads sharing the port (linux)" },
+	ur::cl_var_ref{"--io-uring", cl::relayParams.m_ioUring,												"--io-uring									= use io_uring engine (linux), fallback to regular socket calls when unavailable" },
+	ur::cl_var_ref{"--gro", cl::relayParams.m_gro,														"--gro										= coalesce bursts with UDP GRO on receive and forward them with GSO (linux)" },
+	ur::cl_var_ref{"--huge-pages", cl::relayParams.m_hugePages,											"--huge-pages								= keep channel storage in huge pages (linux), fallback to transparent huge pages or regular ones" },
+	ur::cl_var_ref{"--residency", cl::relayParams.m_residency,											"--residency								= log percentiles of time datagrams spend in relay, from kernel receive timestamp to send (linux)" },
+	ur::cl_var_ref{"--metrics", cl::relayParams.m_metrics,												"--metrics									= publish metrics in shared memory for udp-relay-metrics exporter (linux)" },
+	ur::cl_var_ref{"--capture", cl::relayParams.m_capturePath,											"--capture <path>							= trace received datagrams to pcap ring file, workers add .<index> suffix (linux)" },
+	ur::cl_var_ref{"--capture-sample", cl::relayParams.m_captureSample,									"--capture-sample <value>					= trace 1 of that many datagrams, 1 by default" },
+	ur::cl_var_ref{"--capture-snap", cl::relayParams.m_captureSnapLength,								"--capture-snap <value>						= payload bytes kept of each traced datagram, 64 by default" },
+	ur::cl_var_ref{"--capture-size", cl::relayParams.m_captureSizeMb,									"--capture-size <value>						= capture file size in MB, oldest records overwritten once full, 64 by default" },
+	ur::cl_var_ref{"--xdp", cl::relayParams.m_xdpInterface,												"--xdp <interface>							= forward established ipv4 channels in kernel with xdp program attached to interface (linux)" },
+	ur::cl_var_ref{"--xdp-object", cl::relayParams.m_xdpObject,											"--xdp-object <path>						= path to compiled xdp program, relay_fastpath.bpf.o by default" },
 };
 
 static constexpr auto envList = std::array
@@ -41,7 +75,32 @@ static constexpr auto envList = std::array
 
 static void relay_signal_handler(int sig);
 
-static ur::relay g_relay{};
+// parse "<first>-<last>" port range
+static bool parse_port_range(std::string_view range, uint16_t& first, uint16_t& last)
+{
+	const size_t dash = range.find('-');
+	if (dash == std::string_view::npos)
+		return false;
+
+	const auto [firstEnd, firstErr] = std::from_chars(range.data(), range.data() + dash, first);
+	const auto [lastEnd, lastErr] = std::from_chars(range.data() + dash + 1, range.data() + range.size(), last);
+	return firstErr == std::errc{} && lastErr == std::errc{} && firstEnd == range.data() + dash && lastEnd == range.data() + range.size() && first != 0 && first <= last;
+}
+
+// every dedicated port takes file descriptor
+static void raise_fd_limit()
+{
+#if UR_PLATFORM_LINUX
+	rlimit limit{};
+	if (::getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+	{
+		limit.rlim_cur = limit.rlim_max;
+		::setrlimit(RLIMIT_NOFILE, &limit);
+	}
+#endif
+}
+
+static ur::relay_group g_relay{};
 static int exit_code{};
 
 int main(int argc, char* argv[], char* envp[])
@@ -65,6 +124,28 @@ int main(int argc, char* argv[], char* envp[])
 		return 0;
 	}
 
+	if (const auto latencyMode = ur::latency_mode_from_string(cl::latencyMode))
+	{
+		cl::relayParams.m_latencyMode = *latencyMode;
+	}
+	else
+	{
+		LOG(Error, Relay, "Unknown latency mode {}", cl::latencyMode);
+		ur_shutdown();
+		return 1;
+	}
+
+	if (!cl::relayPorts.empty())
+	{
+		if (!parse_port_range(cl::relayPorts, cl::relayParams.m_relayPortFirst, cl::relayParams.m_relayPortLast))
+		{
+			LOG(Error, Relay, "Invalid relay port range {}, expected <first>-<last>", cl::relayPorts);
+			ur_shutdown();
+			return 1;
+		}
+		raise_fd_limit();
+	}
+
 	if (g_relay.init(cl::relayParams, ur::relay_helpers::makeSecret(env::secretKey)))
 	{
 		g_relay.run();
@@ -0,0 +1,882 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include "udp-relay/channel_arena.hxx"
+#include "udp-relay/clock.hxx"
+#include "udp-relay/flat_map.hxx"
+#include "udp-relay/guid.hxx"
+#include "udp-relay/hmac.hxx"
+#include "udp-relay/log.hxx"
+#include "udp-relay/main_helpers.hxx"
+#include "udp-relay/net/memory_transport.hxx"
+#include "udp-relay/net/socket_address.hxx"
+#include "udp-relay/relay.hxx"
+#include "udp-relay/version.hxx"
+
+#if UR_PLATFORM_LINUX
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <print>
+#include <random>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace cl
+{
+	static bool printHelp{};
+	static std::vector<int32_t> sizes{};
+	static int32_t lookups{10000000};
+	static int32_t channels{1000000};
+	static bool hugePages{};
+	static int32_t handshakes{1000000};
+	static std::vector<int32_t> expiryChannels{};
+	static int32_t hashes{10000000};
+	static int32_t logs{1000000};
+	static int32_t relayChannels{1000000};
+	static std::string json{};
+} // namespace cl
+
+// clang-format off
+static constexpr auto argList = std::array
+{
+	ur::cl_var_ref{"--help", cl::printHelp,			"--help							= print help" },
+	ur::cl_var_ref{"--sizes", cl::sizes,			"--sizes <value> <value> ...	= map sizes to benchmark, 1000 100000 10000000 by default" },
+	ur::cl_var_ref{"--lookups", cl::lookups,		"--lookups <value>				= lookups per measurement, 10000000 by default" },
+	ur::cl_var_ref{"--channels", cl::channels,		"--channels <value>				= open channels in channel storage benchmark, 1000000 by default" },
+	ur::cl_var_ref{"--huge-pages", cl::hugePages,	"--huge-pages					= back channel arena with huge pages" },
+	ur::cl_var_ref{"--handshakes", cl::handshakes,	"--handshakes <value>			= handshakes verified per measurement, 1000000 by default" },
+	ur::cl_var_ref{"--expiry", cl::expiryChannels,	"--expiry <value> <value> ...	= channels in expiry sweep benchmark, 10000 100000 1000000 by default" },
+	ur::cl_var_ref{"--hashes", cl::hashes,			"--hashes <value>				= hashes per measurement, 10000000 by default" },
+	ur::cl_var_ref{"--logs", cl::logs,				"--logs <value>					= log calls per measurement, 1000000 by default" },
+	ur::cl_var_ref{"--relay", cl::relayChannels,	"--relay <value>				= channels opened, fed & expired by relay over memory transport, 1000000 by default" },
+	ur::cl_var_ref{"--json", cl::json,				"--json <path>					= also write results as json to path, - for stdout instead of text" },
+};
+// clang-format on
+
+static std::mt19937_64 g_random{42};
+
+// keeps results observable, so compiler doesn't drop lookups
+static volatile uint64_t g_sink{};
+
+// single measurement as written to json report
+struct bench_result
+{
+	std::string m_name;	   // what was measured, e.g. "map.lookup"
+	std::string m_variant; // implementation or input kind
+	uint64_t m_size{};	   // entries, channels or bytes measurement ran with
+	double m_value{};
+	std::string_view m_unit;
+};
+
+static std::vector<bench_result> g_results{};
+
+static void report(std::string_view name, std::string_view variant, uint64_t size, double value, std::string_view unit)
+{
+	g_results.push_back(bench_result{std::string(name), std::string(variant), size, value, unit});
+}
+
+// human readable line, suppressed when json goes to stdout
+template <typename... Args>
+static void printText(std::format_string<Args...> format, Args&&... args)
+{
+	if (cl::json != "-")
+		std::println(format, std::forward<Args>(args)...);
+}
+
+static std::string jsonEscape(std::string_view value)
+{
+	std::string result{};
+	for (const char c : value)
+	{
+		if (c == '"' || c == '\\')
+			result += '\\';
+		result += c;
+	}
+	return result;
+}
+
+static bool writeJson(const std::string& path)
+{
+	std::string out = std::format("{{\n\t\"version\": \"{}.{}.{}\",\n\t\"timestamp\": {},\n\t\"results\": [",
+		ur::getVersionMajor(), ur::getVersionMinor(), ur::getVersionPatch(),
+		std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+	for (size_t i = 0; i < g_results.size(); ++i)
+	{
+		const bench_result& result = g_results[i];
+		out += std::format("{}\n\t\t{{\"name\": \"{}\", \"variant\": \"{}\", \"size\": {}, \"value\": {:.6g}, \"unit\": \"{}\"}}",
+			i ? "," : "", jsonEscape(result.m_name), jsonEscape(result.m_variant), result.m_size, result.m_value, result.m_unit);
+	}
+	out += "\n\t]\n}\n";
+
+	if (path == "-")
+	{
+		std::fwrite(out.data(), 1, out.size(), stdout);
+		return true;
+	}
+
+	FILE* file = std::fopen(path.c_str(), "wb");
+	if (file == nullptr)
+	{
+		std::println("Failed to open {}", path);
+		return false;
+	}
+	const bool written = std::fwrite(out.data(), 1, out.size(), file) == out.size();
+	return std::fclose(file) == 0 && written;
+}
+
+static std::vector<ur::net::socket_address> makeAddresses(size_t count, bool v4Mapped)
+{
+	std::vector<ur::net::socket_address> addresses{};
+	addresses.reserve(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		const uint32_t ip = static_cast<uint32_t>(g_random());
+		const uint16_t port = static_cast<uint16_t>(g_random());
+		if (v4Mapped)
+		{
+			std::array<std::byte, 16> ip6{};
+			ip6[10] = ip6[11] = std::byte{0xFF};
+			std::memcpy(ip6.data() + 12, &ip, sizeof(ip));
+			addresses.push_back(ur::net::socket_address::make_ipv6(ip6, port));
+		}
+		else
+		{
+			addresses.push_back(ur::net::socket_address::make_ipv4(ip, port));
+		}
+	}
+	return addresses;
+}
+
+static std::vector<guid> makeGuids(size_t count)
+{
+	std::vector<guid> guids{};
+	guids.reserve(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		const uint64_t high = g_random();
+		const uint64_t low = g_random();
+		guids.emplace_back(uint32_t(high >> 32), uint32_t(high), uint32_t(low >> 32), uint32_t(low));
+	}
+	return guids;
+}
+
+// random existing keys in lookup order
+template <typename Key>
+static std::vector<Key> makeProbes(const std::vector<Key>& keys, size_t count)
+{
+	std::vector<Key> probes{};
+	probes.reserve(count);
+	for (size_t i = 0; i < count; ++i)
+		probes.push_back(keys[g_random() % keys.size()]);
+	return probes;
+}
+
+template <typename Map, typename Key>
+static double measureLookups(const Map& map, std::span<const Key> probes)
+{
+	uint64_t found{};
+	const auto start = std::chrono::steady_clock::now();
+	for (const Key& key : probes)
+		found += map.find(key) != map.end();
+	const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+	g_sink = g_sink + found;
+	return double(probes.size()) / elapsed.count();
+}
+
+template <typename Key, typename Value>
+static void benchMaps(std::string_view name, const std::vector<Key>& keys, size_t lookups)
+{
+	std::vector<Key> probes = makeProbes(keys, lookups);
+
+	double flatRate{};
+	{
+		ur::flat_map<Key, Value> flatMap{};
+		for (const Key& key : keys)
+			flatMap.try_emplace(key);
+		flatRate = measureLookups(flatMap, std::span<const Key>(probes));
+	}
+
+	double stdRate{};
+	{
+		std::unordered_map<Key, Value> stdMap{};
+		for (const Key& key : keys)
+			stdMap.try_emplace(key);
+		stdRate = measureLookups(stdMap, std::span<const Key>(probes));
+	}
+
+	printText("{:<14} {:>10} entries: flat_map {:>8.2f} M lookups/s, unordered_map {:>8.2f} M lookups/s, x{:.2f}",
+		name, keys.size(), flatRate / 1e6, stdRate / 1e6, flatRate / stdRate);
+	report("map.lookup", std::format("{}/flat_map", name), keys.size(), flatRate / 1e6, "M/s");
+	report("map.lookup", std::format("{}/unordered_map", name), keys.size(), stdRate / 1e6, "M/s");
+}
+
+// last level cache misses of calling thread in user space, unavailable without hardware counters (e.g. most VMs)
+class llc_miss_counter
+{
+public:
+	llc_miss_counter() noexcept
+	{
+#if UR_PLATFORM_LINUX
+		perf_event_attr attr{};
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_CACHE_MISSES;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		m_fd = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+	}
+
+	llc_miss_counter(const llc_miss_counter&) = delete;
+	llc_miss_counter& operator=(const llc_miss_counter&) = delete;
+
+	~llc_miss_counter() noexcept
+	{
+#if UR_PLATFORM_LINUX
+		if (m_fd != -1)
+			::close(m_fd);
+#endif
+	}
+
+	void start() noexcept
+	{
+#if UR_PLATFORM_LINUX
+		if (m_fd != -1)
+		{
+			::ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+			::ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+
+	// misses since start() or nullopt if counter is unavailable
+	std::optional<uint64_t> stop() noexcept
+	{
+#if UR_PLATFORM_LINUX
+		uint64_t value{};
+		if (m_fd != -1 && ::ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0) == 0 && ::read(m_fd, &value, sizeof(value)) == sizeof(value))
+			return value;
+#endif
+		return std::nullopt;
+	}
+
+private:
+	int m_fd{-1};
+};
+
+// channel storage relay used before channel_arena: whole channel in single struct, kept in deque of optional slots
+struct legacy_channel
+{
+	guid m_guid{};
+	ur::net::socket_address m_peerA{};
+	ur::net::socket_address m_peerB{};
+	std::chrono::steady_clock::time_point m_lastUpdated{};
+	ur::channel_stats m_stats{};
+};
+
+struct legacy_channel_slot
+{
+	std::optional<legacy_channel> m_channel{};
+	uint32_t m_generation{};
+};
+
+struct channel_bench_result
+{
+	double m_rate{};					 // packets per second
+	std::optional<uint64_t> m_llcMisses{}; // per packet * 1000
+	size_t m_bytesPerChannel{};
+};
+
+// measured loops are kept out of main(), where reloads of spilled locals made them far slower than relay's own code
+#if defined(_MSC_VER)
+#define UR_BENCH_NOINLINE __declspec(noinline)
+#else
+#define UR_BENCH_NOINLINE __attribute__((noinline))
+#endif
+
+// simulate forwarding to random channels: resolve handle, pick destination, update activity and counters
+template <typename Storage, typename ForwardFn>
+UR_BENCH_NOINLINE static channel_bench_result measureForwarding(Storage& storage, std::span<const ur::channel_handle> probes, ForwardFn forward)
+{
+	llc_miss_counter counter{};
+	uint64_t checksum{};
+
+	const auto start = std::chrono::steady_clock::now();
+	counter.start();
+	for (const ur::channel_handle& handle : probes)
+		checksum += forward(storage, handle);
+	const auto misses = counter.stop();
+	const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+
+	g_sink = g_sink + checksum;
+
+	channel_bench_result result{};
+	result.m_rate = double(probes.size()) / elapsed.count();
+	if (misses)
+		result.m_llcMisses = *misses * 1000 / probes.size();
+	return result;
+}
+
+static void benchChannelStorage(size_t channelCount, size_t lookups)
+{
+	const std::vector<ur::net::socket_address> addresses = makeAddresses(channelCount * 2, false);
+	const std::vector<guid> guids = makeGuids(channelCount);
+	const auto now = std::chrono::steady_clock::now();
+
+	std::vector<ur::channel_handle> handles{};
+	handles.reserve(channelCount);
+
+	channel_bench_result legacyResult{};
+	{
+		std::deque<legacy_channel_slot> slots{};
+		for (size_t i = 0; i < channelCount; ++i)
+		{
+			slots.emplace_back().m_channel.emplace(guids[i], addresses[i * 2], addresses[i * 2 + 1], now);
+			handles.push_back(ur::channel_handle{uint32_t(i), 0});
+		}
+
+		const std::vector<ur::channel_handle> probes = makeProbes(handles, lookups);
+		legacyResult = measureForwarding(slots, probes, [now](std::deque<legacy_channel_slot>& storage, const ur::channel_handle& handle) -> uint64_t
+			{
+				legacy_channel_slot& slot = storage[handle.m_index];
+				if (slot.m_generation != handle.m_generation)
+					return 0;
+
+				legacy_channel& ch = *slot.m_channel;
+				ch.m_lastUpdated = now;
+				ch.m_stats.m_packetsReceived++;
+				ch.m_stats.m_bytesReceived += 100;
+				const uint16_t port = ch.m_peerB.getPort();
+				ch.m_stats.m_packetsSent++;
+				ch.m_stats.m_bytesSent += 100;
+				return port;
+			});
+		legacyResult.m_bytesPerChannel = sizeof(legacy_channel_slot);
+	}
+
+	handles.clear();
+
+	channel_bench_result arenaResult{};
+	{
+		ur::channel_arena arena{};
+		arena.setHugePages(cl::hugePages);
+		for (size_t i = 0; i < channelCount; ++i)
+		{
+			const auto handle = arena.allocate();
+			if (!handle)
+				return;
+
+			ur::channel& ch = *arena.resolve(*handle);
+			ch.m_peerA = addresses[i * 2];
+			ch.m_peerB = addresses[i * 2 + 1];
+			arena.infoAt(handle->m_index).m_guid = guids[i];
+			handles.push_back(*handle);
+		}
+
+		const std::vector<ur::channel_handle> probes = makeProbes(handles, lookups);
+		arenaResult = measureForwarding(arena, probes, [](ur::channel_arena& storage, const ur::channel_handle& handle) -> uint64_t
+			{
+				ur::channel* const ch = storage.resolve(handle);
+				if (ch == nullptr)
+					return 0;
+
+				ch->m_lastUpdated = 1;
+				ch->m_packetsReceived++;
+				ch->m_bytesReceived += 100;
+				const uint16_t port = ch->m_peerB.getPort();
+				ch->m_packetsSent++;
+				ch->m_bytesSent += 100;
+				return port;
+			});
+		arenaResult.m_bytesPerChannel = arena.reservedBytes() / channelCount;
+	}
+
+	const auto formatMisses = [](const std::optional<uint64_t>& misses)
+	{
+		return misses ? std::format("{:.3f}", double(*misses) / 1000.) : std::string("n/a");
+	};
+
+	printText("{:<14} {:>10} channels: deque {:>3} B/channel {:>8.2f} M packets/s {:>6} LLC misses/packet, arena {:>3} B/channel {:>8.2f} M packets/s {:>6} LLC misses/packet, x{:.2f}",
+		"channels", channelCount,
+		legacyResult.m_bytesPerChannel, legacyResult.m_rate / 1e6, formatMisses(legacyResult.m_llcMisses),
+		arenaResult.m_bytesPerChannel, arenaResult.m_rate / 1e6, formatMisses(arenaResult.m_llcMisses),
+		arenaResult.m_rate / legacyResult.m_rate);
+	report("channel.forward", "deque", channelCount, legacyResult.m_rate / 1e6, "M/s");
+	report("channel.forward", "arena", channelCount, arenaResult.m_rate / 1e6, "M/s");
+	if (arenaResult.m_llcMisses)
+		report("channel.llc_misses", "arena", channelCount, double(*arenaResult.m_llcMisses) / 1000., "misses/packet");
+}
+
+template <typename Verify>
+UR_BENCH_NOINLINE static double measureHandshakes(const ur::recv_buffer& packet, size_t packetSize, size_t count, Verify verify)
+{
+	uint64_t valid{};
+	const auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < count; ++i)
+		valid += verify(packet, packetSize);
+	const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+	g_sink = g_sink + valid;
+	return double(count) / elapsed.count();
+}
+
+static void benchHandshakeMac(size_t packetSize, size_t count)
+{
+	const ur::secret_key key = ur::relay_helpers::makeSecret("");
+
+	ur::recv_buffer packet{};
+	for (auto& el : packet)
+		el = static_cast<std::byte>(g_random());
+	std::memset(packet.data() + offsetof(ur::handshake_header, m_mac), 0, sizeof(ur::hmac_sha256));
+	const ur::hmac_sha256 mac = ur::relay_helpers::makeHMAC(key, packet.data(), packetSize);
+	std::memcpy(packet.data() + offsetof(ur::handshake_header, m_mac), &mac, sizeof(mac));
+
+	// previous path: whole buffer copied to zero mac field, key hashed again by one-shot HMAC()
+	const double oneShotRate = measureHandshakes(packet, packetSize, count, [&key](const ur::recv_buffer& recvBuffer, size_t recvBytes) -> uint64_t
+		{
+			ur::hmac_sha256 expected;
+			std::memcpy(&expected, recvBuffer.data() + offsetof(ur::handshake_header, m_mac), sizeof(expected));
+
+			ur::recv_buffer recvBufferZeroMac = recvBuffer;
+			std::memset(recvBufferZeroMac.data() + offsetof(ur::handshake_header, m_mac), 0, sizeof(ur::hmac_sha256));
+			const auto computed = ur::relay_helpers::makeHMAC(key, recvBufferZeroMac.data(), recvBytes);
+			return std::memcmp(&computed, &expected, sizeof(computed)) == 0;
+		});
+
+	ur::hmac_verifier verifier{};
+	if (!verifier.init(key))
+		return;
+
+	const double verifierRate = measureHandshakes(packet, packetSize, count, [&verifier](const ur::recv_buffer& recvBuffer, size_t recvBytes) -> uint64_t
+		{
+			ur::hmac_sha256 expected;
+			std::memcpy(&expected, recvBuffer.data() + offsetof(ur::handshake_header, m_mac), sizeof(expected));
+			return verifier.verify(recvBuffer.data(), recvBytes, offsetof(ur::handshake_header, m_mac), expected);
+		});
+
+	printText("{:<14} {:>10} bytes: copy & HMAC() {:>8.2f} M handshakes/s, hmac_verifier {:>8.2f} M handshakes/s, x{:.2f}",
+		"handshake mac", packetSize, oneShotRate / 1e6, verifierRate / 1e6, verifierRate / oneShotRate);
+	report("handshake.mac", "copy_hmac", packetSize, oneShotRate / 1e6, "M/s");
+	report("handshake.mac", "hmac_verifier", packetSize, verifierRate / 1e6, "M/s");
+}
+
+// handshake as peers send it, mac made with key
+static ur::recv_buffer makeHandshake(const ur::secret_key& key)
+{
+	ur::handshake_header header{};
+	header.m_guid = makeGuids(1).front();
+
+	ur::recv_buffer packet{};
+	std::memcpy(packet.data(), &header, sizeof(header));
+	const ur::hmac_sha256 mac = ur::relay_helpers::makeHMAC(key, packet.data(), sizeof(header));
+	std::memcpy(packet.data() + offsetof(ur::handshake_header, m_mac), &mac, sizeof(mac));
+	return packet;
+}
+
+static void benchHeaderParse(size_t count)
+{
+	const ur::secret_key key = ur::relay_helpers::makeSecret("");
+	ur::hmac_verifier verifier{};
+	if (!verifier.init(key))
+		return;
+
+	const ur::recv_buffer valid = makeHandshake(key);
+
+	ur::recv_buffer invalidMagic = valid;
+	invalidMagic[0] ^= std::byte{0xFF};
+
+	ur::recv_buffer badMac = valid;
+	badMac[offsetof(ur::handshake_header, m_mac)] ^= std::byte{0xFF};
+
+	const auto deserialize = [&verifier](const ur::recv_buffer& recvBuffer, size_t recvBytes) -> uint64_t
+	{
+		return ur::relay_helpers::tryDeserializeHeader(verifier, recvBuffer, recvBytes).first;
+	};
+
+	const std::pair<std::string_view, const ur::recv_buffer*> cases[]{{"valid", &valid}, {"invalid_magic", &invalidMagic}, {"bad_mac", &badMac}};
+	for (const auto& [variant, packet] : cases)
+	{
+		const double rate = measureHandshakes(*packet, sizeof(ur::handshake_header), count, deserialize);
+		printText("{:<14} {:>14}: tryDeserializeHeader {:>8.2f} M/s, {:>8.1f} ns", "header parse", variant, rate / 1e6, 1e9 / rate);
+		report("header.deserialize", variant, sizeof(ur::handshake_header), rate / 1e6, "M/s");
+	}
+
+	const double makeRate = measureHandshakes(valid, sizeof(ur::handshake_header), count, [&key](const ur::recv_buffer& recvBuffer, size_t recvBytes) -> uint64_t
+		{
+			return ur::relay_helpers::makeHMAC(key, recvBuffer.data(), recvBytes)[0] != std::byte{};
+		});
+	printText("{:<14} {:>14}: makeHMAC {:>8.2f} M/s, {:>8.1f} ns", "header mac", "one-shot", makeRate / 1e6, 1e9 / makeRate);
+	report("header.make_hmac", "one-shot", sizeof(ur::handshake_header), makeRate / 1e6, "M/s");
+}
+
+template <typename Key>
+UR_BENCH_NOINLINE static double measureHashes(std::span<const Key> keys, size_t count)
+{
+	// key set fits in cache, measures hash function rather than memory
+	const size_t mask = keys.size() - 1;
+	std::size_t checksum{};
+	const auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < count; ++i)
+		checksum += std::hash<Key>{}(keys[i & mask]);
+	const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+	g_sink = g_sink + checksum;
+	return double(count) / elapsed.count();
+}
+
+static void benchHashes(size_t count)
+{
+	constexpr size_t keyCount = 4096;
+	const auto ipv4 = makeAddresses(keyCount, false);
+	const auto ipv4Mapped = makeAddresses(keyCount, true);
+	const auto guids = makeGuids(keyCount);
+
+	const std::pair<std::string_view, double> rates[]{
+		{"socket_address/ipv4", measureHashes(std::span(ipv4), count)},
+		{"socket_address/ipv4-mapped", measureHashes(std::span(ipv4Mapped), count)},
+		{"guid", measureHashes(std::span(guids), count)},
+	};
+
+	for (const auto& [variant, rate] : rates)
+	{
+		printText("{:<14} {:>26}: {:>8.2f} M hashes/s, {:>6.2f} ns", "std::hash", variant, rate / 1e6, 1e9 / rate);
+		report("hash", variant, keyCount, rate / 1e6, "M/s");
+	}
+}
+
+// insert & erase rates of tables relay keeps channels in, at given table size
+template <typename Key>
+static void benchMapChurn(std::string_view name, const std::vector<Key>& keys, const std::vector<Key>& fresh)
+{
+	ur::flat_map<Key, ur::channel_handle> map{};
+
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < keys.size(); ++i)
+		map.try_emplace(keys[i], ur::channel_handle{uint32_t(i), 0});
+	const double insertRate = double(keys.size()) / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// steady state as relay sees it: channel closed, other one opened, table size doesn't change
+	start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < fresh.size(); ++i)
+	{
+		map.erase(keys[i]);
+		map.try_emplace(fresh[i], ur::channel_handle{uint32_t(i), 1});
+	}
+	const double churnRate = double(fresh.size()) / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	start = std::chrono::steady_clock::now();
+	size_t erased{};
+	for (size_t i = fresh.size(); i < keys.size(); ++i)
+		erased += map.erase(keys[i]);
+	for (const Key& key : fresh)
+		erased += map.erase(key);
+	const double eraseRate = double(erased) / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	g_sink = g_sink + erased;
+
+	printText("{:<14} {:>10} entries: insert {:>8.2f} M/s, erase+insert {:>8.2f} M/s, erase {:>8.2f} M/s",
+		name, keys.size(), insertRate / 1e6, churnRate / 1e6, eraseRate / 1e6);
+	report("map.insert", name, keys.size(), insertRate / 1e6, "M/s");
+	report("map.churn", name, keys.size(), churnRate / 1e6, "M/s");
+	report("map.erase", name, keys.size(), eraseRate / 1e6, "M/s");
+}
+
+// relay driven by hand over memory transport with virtual clock, without network stack or wall time
+struct memory_relay
+{
+	ur::net::memory_transport m_transport{4096};
+	ur::virtual_clock m_clock{};
+	ur::worker_metrics m_metrics{};
+	ur::relay_params m_params{};
+	std::unique_ptr<ur::relay> m_relay{std::make_unique<ur::relay>()};
+
+	bool init()
+	{
+		if (!ur_is_init())
+			ur_init();
+
+		m_transport.setDiscardSent(true);
+		m_params.m_handshakeRate = 0;
+		m_params.m_handshakePrefixRate = 0;
+		m_params.m_hugePages = cl::hugePages;
+
+		m_relay->setTransport(&m_transport);
+		m_relay->setClock(&m_clock);
+		m_relay->setMetrics(&m_metrics);
+		return m_relay->init(m_params, ur::secret_key{});
+	}
+
+	// distinct address of every peer without storing them
+	static ur::net::socket_address peerOf(size_t i)
+	{
+		return ur::net::socket_address::make_ipv4(ur::net::hton32(0x0A000000U | uint32_t(i >> 14)), uint16_t(1024 + (i & 0x3FFF)));
+	}
+
+	// relay takes inbound ring whenever it fills up
+	void push(const ur::net::socket_address& from, const void* data, size_t size)
+	{
+		while (!m_transport.push(from, data, size))
+			m_relay->poll();
+	}
+
+	void drain()
+	{
+		while (m_transport.pendingReceive())
+			m_relay->poll();
+	}
+
+	// channel i joins peers 2i & 2i+1
+	void openChannels(size_t count)
+	{
+		ur::handshake_header header{};
+		for (size_t i = 0; i < count; ++i)
+		{
+			header.m_guid = ur::net::hton(guid(0x5EED, uint32_t(i), uint32_t(uint64_t(i) >> 32), 1));
+			push(peerOf(i * 2), &header, sizeof(header));
+			push(peerOf(i * 2 + 1), &header, sizeof(header));
+			m_clock.advance(1us);
+		}
+		drain();
+	}
+
+	uint64_t openChannelCount() const noexcept
+	{
+		return m_metrics.m_channelsEstablished.load(std::memory_order_relaxed) + m_metrics.m_channelsPending.load(std::memory_order_relaxed);
+	}
+};
+
+// relay's inactivity sweep: every channel is due on expiry wheel at once, half of them saw traffic and are re-armed,
+// the rest are closed with their guid & address mappings, within relay's expiry budget per iteration
+static void benchExpiry(size_t channelCount)
+{
+	// line per closed channel would dominate
+	const ur::log_level verbosity = ur::runtime_log_verbosity;
+	ur::runtime_log_verbosity = ur::log_level::Warning;
+
+	memory_relay harness{};
+	if (!harness.init())
+	{
+		ur::runtime_log_verbosity = verbosity;
+		return;
+	}
+	harness.openChannels(channelCount);
+
+	// odd channels stay inactive
+	const auto timeout = harness.m_params.m_cleanupInactiveChannelAfterTime;
+	harness.m_clock.advance(timeout / 2);
+	const std::array<std::byte, 64> payload{};
+	for (size_t i = 0; i < channelCount; i += 2)
+		harness.push(memory_relay::peerOf(i * 2), payload.data(), payload.size());
+	harness.drain();
+
+	harness.m_clock.advance(timeout / 2 + 1s);
+	const uint64_t remaining = harness.openChannelCount() - channelCount / 2;
+
+	size_t iterations{};
+	double worstIteration{};
+	const auto start = std::chrono::steady_clock::now();
+	while (harness.openChannelCount() > remaining)
+	{
+		const auto iterationStart = std::chrono::steady_clock::now();
+		harness.m_relay->poll();
+		++iterations;
+		worstIteration = std::max(worstIteration, std::chrono::duration<double>(std::chrono::steady_clock::now() - iterationStart).count());
+	}
+	const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	ur::runtime_log_verbosity = verbosity;
+
+	printText("{:<14} {:>10} channels: {:>8.1f} ns/channel, {:>6} iterations, worst iteration {:>8.1f} us, total {:>8.2f} ms",
+		"expiry sweep", channelCount, elapsed * 1e9 / double(channelCount), iterations, worstIteration * 1e6, elapsed * 1e3);
+	report("expiry.sweep", "per_channel", channelCount, elapsed * 1e9 / double(channelCount), "ns");
+	report("expiry.sweep", "worst_iteration", channelCount, worstIteration * 1e6, "us");
+}
+
+template <typename LogFn>
+UR_BENCH_NOINLINE static double measureLogs(size_t count, size_t burst, LogFn logFn)
+{
+	// queue of logging thread holds 4096 records, let it drain between bursts so calls measure enqueue rather than drop
+	double elapsed{};
+	for (size_t done = 0; done < count; done += burst)
+	{
+		const size_t calls = std::min(burst, count - done);
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < calls; ++i)
+			logFn(uint32_t(done + i));
+		elapsed += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if (burst < count)
+		{
+			ur::log_flush();
+			std::this_thread::sleep_for(2ms);
+		}
+	}
+	return double(count) / elapsed;
+}
+
+static void benchLog(size_t count)
+{
+	const auto addr = makeAddresses(1, false).front();
+	const guid channelGuid = makeGuids(1).front();
+	const auto logFn = [&addr, &channelGuid](uint32_t i)
+	{
+		LOG(Info, Microbench, "Forwarded {} bytes from {} in channel \"{}\"", i, addr, channelGuid);
+	};
+
+	const ur::log_level verbosity = ur::runtime_log_verbosity;
+
+	ur::runtime_log_verbosity = ur::log_level::Warning;
+	const double filteredRate = measureLogs(count, count, logFn);
+
+	// records formatted by logging thread go nowhere, so output doesn't skew results or mix with them
+	std::fflush(stdout);
+#if UR_PLATFORM_LINUX
+	const int savedStdout = ::dup(STDOUT_FILENO);
+	const int devNull = ::open("/dev/null", O_WRONLY);
+	if (savedStdout != -1 && devNull != -1)
+		::dup2(devNull, STDOUT_FILENO);
+#endif
+
+	ur::runtime_log_verbosity = ur::log_level::Info;
+	const uint64_t droppedBefore = ur::log_dropped();
+	const double queuedRate = measureLogs(count, 1024, logFn);
+	ur::log_shutdown(); // drain every record before output is restored
+	const uint64_t dropped = ur::log_dropped() - droppedBefore;
+	ur::runtime_log_verbosity = verbosity;
+
+#if UR_PLATFORM_LINUX
+	if (savedStdout != -1 && devNull != -1)
+		::dup2(savedStdout, STDOUT_FILENO);
+	if (savedStdout != -1)
+		::close(savedStdout);
+	if (devNull != -1)
+		::close(devNull);
+#endif
+
+	printText("{:<14} {:>10} calls: filtered {:>8.2f} ns, queued {:>8.2f} ns, {} dropped", "LOG", count, 1e9 / filteredRate, 1e9 / queuedRate, dropped);
+	report("log", "filtered", count, 1e9 / filteredRate, "ns");
+	report("log", "queued", count, 1e9 / queuedRate, "ns");
+}
+
+// whole relay over memory transport with virtual clock: handshakes, forwarding and expiry
+static void benchRelay(size_t channelCount, size_t datagramCount)
+{
+	// line per opened & closed channel would dominate
+	const ur::log_level verbosity = ur::runtime_log_verbosity;
+	ur::runtime_log_verbosity = ur::log_level::Warning;
+
+	memory_relay harness{};
+	if (!harness.init())
+	{
+		ur::runtime_log_verbosity = verbosity;
+		return;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	harness.openChannels(channelCount);
+	const double openElapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	const uint64_t established = harness.m_metrics.m_channelsEstablished.load(std::memory_order_relaxed);
+
+	const std::array<std::byte, 64> payload{};
+	const uint64_t sentBefore = harness.m_transport.getSentDatagrams();
+	start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < datagramCount; ++i)
+		harness.push(memory_relay::peerOf(g_random() % (channelCount * 2)), payload.data(), payload.size());
+	harness.drain();
+	const double forwardElapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	const double forwardRate = double(harness.m_transport.getSentDatagrams() - sentBefore) / forwardElapsed;
+
+	// jump past inactivity timeout, every channel is due and closed within expiry budget per iteration
+	harness.m_clock.advance(harness.m_params.m_cleanupInactiveChannelAfterTime + 1s);
+	size_t iterations{};
+	start = std::chrono::steady_clock::now();
+	while (harness.openChannelCount() != 0)
+	{
+		harness.m_relay->poll();
+		++iterations;
+	}
+	const double expireElapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	ur::runtime_log_verbosity = verbosity;
+
+	printText("{:<14} {:>10} channels: open {:>8.1f} ns/channel ({} established), forward {:>8.2f} M/s, expire {:>8.1f} ns/channel in {} iterations",
+		"relay memory", channelCount, openElapsed * 1e9 / double(channelCount), established, forwardRate / 1e6, expireElapsed * 1e9 / double(channelCount), iterations);
+	report("relay.open", "memory", channelCount, openElapsed * 1e9 / double(channelCount), "ns");
+	report("relay.forward", "memory", channelCount, forwardRate / 1e6, "M/s");
+	report("relay.expire", "memory", channelCount, expireElapsed * 1e9 / double(channelCount), "ns");
+}
+
+int main(int argc, char* argv[])
+{
+	ur::parseArgs(argList, argc, argv);
+
+	if (cl::printHelp)
+	{
+		ur::printArgsHelp(argList);
+		return 0;
+	}
+
+	if (cl::sizes.empty())
+		cl::sizes = {1000, 100000, 10000000};
+
+	if (cl::expiryChannels.empty())
+		cl::expiryChannels = {10000, 100000, 1000000};
+
+	for (const int32_t size : cl::sizes)
+	{
+		benchMaps<ur::net::socket_address, guid>("ipv4", makeAddresses(size, false), cl::lookups);
+		benchMaps<ur::net::socket_address, guid>("ipv4-mapped", makeAddresses(size, true), cl::lookups);
+		benchMaps<guid, uint64_t>("guid", makeGuids(size), cl::lookups);
+	}
+
+	for (const int32_t size : cl::sizes)
+	{
+		// a tenth of channels replaced by new ones
+		benchMapChurn("guid", makeGuids(size), makeGuids(size / 10));
+		benchMapChurn("ipv4", makeAddresses(size, false), makeAddresses(size / 10, false));
+	}
+
+	if (cl::hashes > 0)
+		benchHashes(cl::hashes);
+
+	if (cl::channels > 0)
+		benchChannelStorage(cl::channels, cl::lookups);
+
+	if (cl::handshakes > 0)
+	{
+		benchHandshakeMac(sizeof(ur::handshake_header), cl::handshakes);
+		benchHandshakeMac(sizeof(ur::recv_buffer), cl::handshakes);
+		benchHeaderParse(cl::handshakes);
+	}
+
+	for (const int32_t channels : cl::expiryChannels)
+	{
+		if (channels > 0)
+			benchExpiry(channels);
+	}
+
+	if (cl::relayChannels > 0)
+		benchRelay(cl::relayChannels, cl::lookups);
+
+	if (cl::logs > 0)
+		benchLog(cl::logs);
+
+	if (!cl::json.empty() && !writeJson(cl::json))
+		return 1;
+
+	return 0;
+}
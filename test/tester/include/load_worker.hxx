@@ -0,0 +1,178 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include "udp-relay/guid.hxx"
+#include "udp-relay/latency_histogram.hxx"
+#include "udp-relay/net/event_loop.hxx"
+#include "udp-relay/net/udpsocket.hxx"
+#include "udp-relay/relay.hxx"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+struct load_params
+{
+	ur::net::socket_address m_relayAddr{};
+
+	// first local address peers bind to
+	ur::net::socket_address m_bindAddr{};
+
+	// number of consecutive ipv4 addresses peers are spread over, starting from m_bindAddr
+	uint32_t m_bindSpread{1};
+
+	// pairs of peers driven by worker, each peer has own socket
+	uint32_t m_pairs{};
+
+	// datagrams per second sent by worker while measuring, independent of responses
+	double m_rate{};
+
+	// handshakes per second sent by worker while establishing
+	double m_handshakeRate{};
+
+	// datagrams sent back to back by single peer with one send call
+	uint32_t m_burst{1};
+
+	// datagram sizes, each picked with equal probability
+	std::vector<uint32_t> m_sizes{};
+
+	ur::secret_key m_secretKey{};
+
+	// ask relay for dedicated port of every pair with handshake flag, pair is established once both peers got it
+	bool m_relayPorts{};
+};
+
+struct load_stats
+{
+	// time from scheduled send to receive by other peer, ns. Counts from schedule, so stalls of generator or relay
+	// show up in datagrams delayed by them instead of being left out
+	ur::latency_histogram m_latency{};
+
+	// time from actual send to receive by other peer, ns
+	ur::latency_histogram m_serviceLatency{};
+
+	uint64_t m_sent{};
+	uint64_t m_bytesSent{};
+	uint64_t m_sendFailures{};
+	uint64_t m_received{};
+
+	// bursts sent over 1ms behind schedule, generator couldn't keep up with rate
+	uint64_t m_lateBursts{};
+
+	std::chrono::nanoseconds m_measured{};
+};
+
+// header of datagrams exchanged by peers, rest of datagram is pre-built filler
+struct load_packet
+{
+	uint32_t m_magic{};
+	uint32_t m_pair{};
+	uint64_t m_seq{};
+	int64_t m_scheduledNs{}; // steady clock
+	int64_t m_sentNs{};		 // steady clock
+};
+
+enum class load_phase : uint8_t
+{
+	Establish, // handshake every pair, keep established ones alive
+	Measure,   // open-loop send at configured rate
+	Drain,	   // stop sending, receive what's still in flight
+	Stop
+};
+
+// event loop thread driving its own share of peer pairs
+class load_worker
+{
+public:
+	load_worker() = default;
+	load_worker(const load_worker&) = delete;
+	load_worker& operator=(const load_worker&) = delete;
+
+	bool init(load_params params);
+
+	void run();
+
+	void setPhase(load_phase phase) noexcept { m_phase.store(phase, std::memory_order_release); }
+
+	// pairs with both peers hearing back from relay
+	uint32_t getEstablished() const noexcept { return m_establishedPairs.load(std::memory_order_relaxed); }
+
+	uint32_t getPairs() const noexcept { return m_params.m_pairs; }
+
+	// valid once run() returned
+	const load_stats& getStats() const noexcept { return m_stats; }
+
+private:
+	struct peer
+	{
+		ur::net::udpsocket m_socket{};
+		ur::net::socket_address m_sendAddr{}; // relay address data goes to, dedicated port once relay answered with one
+		std::chrono::steady_clock::time_point m_lastControl{}; // last handshake or keep alive
+		uint32_t m_pair{};
+		bool m_heard{};
+	};
+
+	struct pair_state
+	{
+		guid m_guid{};
+		bool m_established{};
+	};
+
+	void processIncoming(peer& to, std::chrono::steady_clock::time_point now);
+
+	// handshake pairs relay hasn't answered yet or keep established ones alive
+	void maintainPeers(std::chrono::steady_clock::time_point now, bool establish);
+
+	// send bursts due by now, return time of the next one
+	std::chrono::steady_clock::time_point sendScheduled(std::chrono::steady_clock::time_point now);
+
+	load_params m_params{};
+
+	std::vector<peer> m_peers{};
+
+	std::vector<pair_state> m_pairs{};
+
+	// peers of established pairs, taking turns in sending while measuring
+	std::vector<uint32_t> m_senders{};
+
+	// signed handshake of every pair, built once and resent as is
+	std::vector<ur::recv_buffer> m_handshakes{};
+
+	// sizes of next datagrams, shuffled once and walked in circle
+	std::vector<uint32_t> m_sizeTable{};
+
+	// send buffers filled with random bytes once, only load_packet in front is rewritten per send
+	std::vector<ur::recv_buffer> m_sendBuffers{};
+
+	std::vector<ur::net::datagram> m_sendBatch{};
+
+	std::vector<ur::recv_buffer> m_recvBuffers{};
+
+	std::vector<ur::net::datagram> m_recvBatch{};
+
+	ur::net::event_loop m_eventLoop{};
+
+	ur::hmac_verifier m_hmac{}; // checks relay port answers are signed by relay
+
+	load_stats m_stats{};
+
+	std::atomic<load_phase> m_phase{load_phase::Establish};
+
+	std::atomic<uint32_t> m_establishedPairs{};
+
+	std::chrono::steady_clock::time_point m_phaseStart{};
+
+	std::chrono::steady_clock::time_point m_nextBurst{};
+
+	uint64_t m_handshakesSent{};
+
+	uint64_t m_seq{};
+
+	size_t m_maintainCursor{};
+
+	size_t m_senderCursor{};
+
+	size_t m_sizeCursor{};
+};
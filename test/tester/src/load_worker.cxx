@@ -0,0 +1,354 @@
+// Copyright(c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include "load_worker.hxx"
+
+#include "udp-relay/log.hxx"
+#include "udp-relay/net/network_utils.hxx"
+#include "udp-relay/utils.hxx"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+	// distinct from handshake magic, so relay forwards datagrams without parsing
+	constexpr uint32_t load_magic_be = ur::net::hton32(0x4C4F4144);
+
+	// handshake resend interval until relay answers
+	constexpr auto handshakeRetry = 250ms;
+
+	// established pairs send a small datagram that often, so relay won't expire idle channels
+	constexpr auto keepAliveInterval = 10s;
+
+	// peers checked for handshake or keep alive per loop iteration
+	constexpr size_t maintainBudget = 4096;
+
+	// bursts sent per loop iteration at most, so receiving isn't starved when generator falls behind
+	constexpr size_t burstBudget = 256;
+
+	constexpr size_t sizeTableSize = 4096;
+
+	constexpr size_t recvBatchSize = 64;
+
+	int64_t steadyNs(std::chrono::steady_clock::time_point time) noexcept
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+	}
+} // namespace
+
+bool load_worker::init(load_params params)
+{
+	if (params.m_pairs == 0 || params.m_sizes.empty() || params.m_burst == 0)
+	{
+		LOG(Error, LoadWorker, "Nothing to drive, pairs, sizes and burst must be non-zero");
+		return false;
+	}
+
+	if (!m_eventLoop.init())
+	{
+		LOG(Error, LoadWorker, "Failed to init event loop");
+		return false;
+	}
+
+	if (!m_hmac.init(params.m_secretKey))
+	{
+		LOG(Error, LoadWorker, "Failed to prepare message authentication");
+		return false;
+	}
+
+	const bool useIpv6 = params.m_relayAddr.isIpv6();
+	uint32_t firstBindIp{};
+	std::memcpy(&firstBindIp, params.m_bindAddr.getRawIp().data(), sizeof(firstBindIp));
+	firstBindIp = ur::net::ntoh32(firstBindIp);
+
+	// every peer needs own address for relay to tell them apart, hence socket per peer
+	m_peers.resize(size_t(params.m_pairs) * 2);
+	m_pairs.resize(params.m_pairs);
+	m_handshakes.resize(params.m_pairs);
+	for (uint32_t i = 0; i < params.m_pairs; ++i)
+	{
+		pair_state& pair = m_pairs[i];
+		pair.m_guid = guid::newGuid();
+
+		ur::handshake_header header{};
+		header.m_guid = ur::net::hton(pair.m_guid);
+		if (params.m_relayPorts)
+			header.m_flags = ur::net::hton16(ur::handshake_flag_relay_port);
+		ur::recv_buffer& handshake = m_handshakes[i];
+		std::memcpy(handshake.data(), &header, sizeof(header));
+		const ur::hmac_sha256 mac = ur::relay_helpers::makeHMAC(params.m_secretKey, handshake.data(), sizeof(header));
+		std::memcpy(handshake.data() + offsetof(ur::handshake_header, m_mac), &mac, sizeof(mac));
+	}
+
+	for (size_t i = 0; i < m_peers.size(); ++i)
+	{
+		peer& p = m_peers[i];
+		p.m_pair = static_cast<uint32_t>(i / 2);
+		p.m_sendAddr = params.m_relayAddr;
+
+		auto bindAddr = params.m_bindAddr;
+		if (bindAddr.isIpv4() && params.m_bindSpread > 1)
+			bindAddr = ur::net::socket_address::make_ipv4(ur::net::hton32(firstBindIp + static_cast<uint32_t>(i % params.m_bindSpread)), 0);
+
+		p.m_socket = ur::net::udpsocket::make(useIpv6);
+		if (!p.m_socket.isValid())
+		{
+			LOG(Error, LoadWorker, "Failed to create socket for peer {}. Might be out of file descriptors", i);
+			return false;
+		}
+
+		if (useIpv6 && !p.m_socket.setOnlyIpv6(false))
+		{
+			LOG(Error, LoadWorker, "Failed set socket ipv6 to dual-stack mode");
+			return false;
+		}
+
+		if (!p.m_socket.bind(bindAddr))
+		{
+			LOG(Error, LoadWorker, "Failed bind socket to {}. Might be out of ports, spread peers with --bind-spread", bindAddr);
+			return false;
+		}
+
+		if (!p.m_socket.setNonBlocking(true) || !m_eventLoop.add(p.m_socket, &p))
+		{
+			LOG(Error, LoadWorker, "Failed to register socket of peer {}", i);
+			return false;
+		}
+	}
+
+	m_sizeTable.resize(sizeTableSize);
+	for (uint32_t& size : m_sizeTable)
+	{
+		const uint32_t picked = params.m_sizes[ur::randRange<size_t>(0, params.m_sizes.size() - 1)];
+		size = std::clamp<uint32_t>(picked, sizeof(load_packet), sizeof(ur::recv_buffer));
+	}
+
+	m_sendBuffers.resize(params.m_burst);
+	for (ur::recv_buffer& buffer : m_sendBuffers)
+		std::generate(buffer.begin(), buffer.end(), []() -> std::byte
+			{ return static_cast<std::byte>(ur::randRange<uint32_t>(0, UINT8_MAX)); });
+
+	m_sendBatch.resize(params.m_burst);
+	for (size_t i = 0; i < m_sendBatch.size(); ++i)
+	{
+		m_sendBatch[i].m_buffer = m_sendBuffers[i].data();
+		m_sendBatch[i].m_addr = params.m_relayAddr;
+	}
+
+	m_recvBuffers.resize(recvBatchSize);
+	m_recvBatch.resize(recvBatchSize);
+	for (size_t i = 0; i < m_recvBatch.size(); ++i)
+	{
+		m_recvBatch[i].m_buffer = m_recvBuffers[i].data();
+		m_recvBatch[i].m_bufferSize = static_cast<uint32_t>(m_recvBuffers[i].size());
+	}
+
+	m_params = std::move(params);
+	return true;
+}
+
+void load_worker::run()
+{
+	std::array<ur::net::event, 256> events{};
+
+	load_phase current = load_phase::Establish;
+	m_phaseStart = std::chrono::steady_clock::now();
+
+	while (true)
+	{
+		auto now = std::chrono::steady_clock::now();
+
+		const load_phase phase = m_phase.load(std::memory_order_acquire);
+		if (phase != current)
+		{
+			if (current == load_phase::Measure)
+				m_stats.m_measured = now - m_phaseStart;
+
+			if (phase == load_phase::Measure)
+			{
+				// only pairs relay answered to take part, others would count as loss
+				for (size_t i = 0; i < m_peers.size(); ++i)
+				{
+					if (m_pairs[m_peers[i].m_pair].m_established)
+						m_senders.push_back(static_cast<uint32_t>(i));
+				}
+				m_nextBurst = now;
+			}
+			else if (phase == load_phase::Stop)
+			{
+				break;
+			}
+
+			current = phase;
+			m_phaseStart = now;
+		}
+
+		std::chrono::microseconds timeout = 1ms;
+		if (current == load_phase::Establish || current == load_phase::Measure)
+			maintainPeers(now, current == load_phase::Establish);
+
+		if (current == load_phase::Measure)
+		{
+			// event loop sleeps in whole milliseconds, spin when next burst is closer than that
+			const auto untilNext = std::chrono::duration_cast<std::chrono::microseconds>(sendScheduled(now) - now);
+			timeout = untilNext < 1ms ? 0us : std::min<std::chrono::microseconds>(untilNext, 1ms);
+		}
+
+		const int32_t count = m_eventLoop.wait(events, timeout);
+		if (count <= 0)
+			continue;
+
+		now = std::chrono::steady_clock::now();
+		for (int32_t i = 0; i < count; ++i)
+		{
+			if (events[i].m_flags & ur::net::Readable)
+				processIncoming(*static_cast<peer*>(events[i].m_userData), now);
+		}
+	}
+}
+
+void load_worker::processIncoming(peer& to, std::chrono::steady_clock::time_point now)
+{
+	// read until socket would block, edge-triggered event loop won't report remaining data again
+	while (true)
+	{
+		const int32_t count = to.m_socket.recvBatch(m_recvBatch);
+		if (count <= 0)
+			return;
+
+		const int64_t recvNs = steadyNs(now);
+		for (int32_t i = 0; i < count; ++i)
+		{
+			const ur::net::datagram& dgram = m_recvBatch[i];
+			if (dgram.m_bytes < 0)
+				continue;
+
+			// relay answers with dedicated port once other peer is mapped, data goes there from now on
+			if (m_params.m_relayPorts && !to.m_heard)
+			{
+				const auto& recvBuffer = *static_cast<const ur::recv_buffer*>(dgram.m_buffer);
+				const uint16_t relayPort = ur::relay_helpers::tryParseRelayPort(recvBuffer, dgram.m_bytes);
+				if (relayPort == 0 || (m_hmac.hasKey() && !ur::relay_helpers::verifyMac(m_hmac, recvBuffer, dgram.m_bytes, ur::relay_helpers::tryParseHeader(recvBuffer, dgram.m_bytes).second)))
+					continue;
+				to.m_sendAddr.setPort(relayPort);
+			}
+
+			// anything coming back from relay means other peer is mapped
+			if (!to.m_heard)
+			{
+				to.m_heard = true;
+
+				pair_state& pair = m_pairs[to.m_pair];
+				const peer& other = m_peers[size_t(to.m_pair) * 2 + (&to == &m_peers[size_t(to.m_pair) * 2] ? 1 : 0)];
+				if (other.m_heard && !pair.m_established)
+				{
+					pair.m_established = true;
+					m_establishedPairs.fetch_add(1, std::memory_order_relaxed);
+				}
+			}
+
+			if (size_t(dgram.m_bytes) < sizeof(load_packet))
+				continue;
+
+			load_packet packet{};
+			std::memcpy(&packet, dgram.m_buffer, sizeof(packet));
+			if (packet.m_magic != load_magic_be || packet.m_seq == 0) // zero sequence is keep alive
+				continue;
+
+			++m_stats.m_received;
+			m_stats.m_latency.record(static_cast<uint64_t>(std::max<int64_t>(recvNs - packet.m_scheduledNs, 0)));
+			m_stats.m_serviceLatency.record(static_cast<uint64_t>(std::max<int64_t>(recvNs - packet.m_sentNs, 0)));
+		}
+
+		if (size_t(count) < m_recvBatch.size())
+			return;
+		now = std::chrono::steady_clock::now();
+	}
+}
+
+void load_worker::maintainPeers(std::chrono::steady_clock::time_point now, bool establish)
+{
+	// handshakes are paced, since relay rate limits them per source and prefix
+	const double elapsed = std::chrono::duration<double>(now - m_phaseStart).count();
+	const uint64_t allowed = static_cast<uint64_t>(elapsed * m_params.m_handshakeRate) + 1;
+	uint64_t handshakesDue = establish && allowed > m_handshakesSent ? allowed - m_handshakesSent : 0;
+
+	const size_t budget = std::min(maintainBudget, m_peers.size());
+	for (size_t examined = 0; examined < budget; ++examined)
+	{
+		peer& p = m_peers[m_maintainCursor];
+		m_maintainCursor = (m_maintainCursor + 1) % m_peers.size();
+
+		if (m_pairs[p.m_pair].m_established)
+		{
+			if (now - p.m_lastControl < keepAliveInterval)
+				continue;
+
+			load_packet keepAlive{};
+			keepAlive.m_magic = load_magic_be;
+			keepAlive.m_pair = p.m_pair;
+			p.m_socket.sendTo(&keepAlive, sizeof(keepAlive), p.m_sendAddr);
+			p.m_lastControl = now;
+		}
+		else if (handshakesDue != 0 && now - p.m_lastControl >= handshakeRetry)
+		{
+			p.m_socket.sendTo(m_handshakes[p.m_pair].data(), sizeof(ur::handshake_header), m_params.m_relayAddr);
+			p.m_lastControl = now;
+			--handshakesDue;
+			++m_handshakesSent;
+		}
+	}
+
+	// unused allowance isn't banked, otherwise it would come out as single burst later
+	if (establish && allowed > m_handshakesSent + 1)
+		m_handshakesSent = allowed - 1;
+}
+
+std::chrono::steady_clock::time_point load_worker::sendScheduled(std::chrono::steady_clock::time_point now)
+{
+	if (m_senders.empty() || m_params.m_rate <= 0)
+		return now + 1s;
+
+	const auto burstInterval = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(m_params.m_burst / m_params.m_rate));
+
+	for (size_t bursts = 0; m_nextBurst <= now && bursts < burstBudget; ++bursts)
+	{
+		if (now - m_nextBurst > 1ms)
+			++m_stats.m_lateBursts;
+
+		const peer& from = m_peers[m_senders[m_senderCursor]];
+		m_senderCursor = (m_senderCursor + 1) % m_senders.size();
+
+		// open-loop latency counts from when burst was due, not when generator got to it
+		const int64_t scheduledNs = steadyNs(m_nextBurst);
+		const int64_t sentNs = steadyNs(std::chrono::steady_clock::now());
+		for (ur::net::datagram& dgram : m_sendBatch)
+		{
+			dgram.m_addr = from.m_sendAddr;
+			const load_packet packet{.m_magic = load_magic_be, .m_pair = from.m_pair, .m_seq = ++m_seq, .m_scheduledNs = scheduledNs, .m_sentNs = sentNs};
+			std::memcpy(dgram.m_buffer, &packet, sizeof(packet));
+			dgram.m_bufferSize = m_sizeTable[m_sizeCursor];
+			m_sizeCursor = (m_sizeCursor + 1) % m_sizeTable.size();
+		}
+
+		const int32_t sent = from.m_socket.sendBatch(m_sendBatch);
+		if (sent > 0)
+		{
+			for (const ur::net::datagram& dgram : m_sendBatch)
+			{
+				if (dgram.m_bytes > 0)
+					m_stats.m_bytesSent += dgram.m_bytes;
+			}
+		}
+		m_stats.m_sent += std::max(sent, 0);
+		m_stats.m_sendFailures += m_sendBatch.size() - std::max(sent, 0);
+
+		m_nextBurst += burstInterval;
+	}
+
+	return m_nextBurst;
+}
@@ -2,27 +2,48 @@
 
 #include "udp-relay/log.hxx"
 #include "udp-relay/main_helpers.hxx"
+#include "udp-relay/net/network_utils.hxx"
+#include "udp-relay/version.hxx"
 
-#include "client.hxx"
+#include "load_worker.hxx"
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <chrono>
 #include <csignal>
-#include <functional>
+#include <cstdio>
+#include <format>
+#include <memory>
 #include <stacktrace>
 #include <thread>
+#include <vector>
+
+#if UR_PLATFORM_LINUX
+#include <sys/resource.h>
+#endif
 
 using namespace std::chrono_literals;
 
 namespace cl
 {
 	static bool printHelp{};
-	static int32_t maxClients{2};
 	static std::string relayAddr{};
 	static uint16_t relayPort{6060};
-	static int32_t shutdownAfter{15};
-	static std::chrono::milliseconds sendIntervalMs{24ms};
 	static bool useIpv6{false};
+	static int32_t threads{2};
+	static int32_t pairs{64};
+	static int32_t rate{10000};
+	static std::vector<int32_t> sizes{64, 512, 1200};
+	static int32_t burst{4};
+	static int32_t duration{10};
+	static int32_t establishTimeout{30};
+	static int32_t handshakeRate{2000};
+	static std::string bindAddr{};
+	static int32_t bindSpread{1};
+	static std::chrono::milliseconds drain{1000ms};
+	static std::string report{};
+	static bool relayPorts{};
 } // namespace cl
 
 namespace env
@@ -33,13 +54,23 @@ namespace env
 // clang-format off
 static constexpr auto argList = std::array
 {
-	ur::cl_var_ref{"--help", cl::printHelp,									"--help											= print help" },
-	ur::cl_var_ref{"--max-clients", cl::maxClients,							"--max-clients									= number of clients to create, should be power of 2" },
-	ur::cl_var_ref{"--relay-addr", cl::relayAddr,								"--relay-addr <value> <value> <value> <value>	= space separated address of relay server, 127 0 0 1 dy default" },
-	ur::cl_var_ref{"--relay-port", cl::relayPort,								"--relay-port <value>							= relay server port, 6060 by default" },
-	ur::cl_var_ref{"--shutdown-after", cl::shutdownAfter,						"--shutdown-after <value>						= time in seconds after which test will end" },
-	ur::cl_var_ref{"--send-interval-ms", cl::sendIntervalMs,					"--send-interval-ms <value>						= how often client should send" },
-	ur::cl_var_ref{"--ipv6", cl::useIpv6,										"--ipv6 0|1										= use ipv6" },
+	ur::cl_var_ref{"--help", cl::printHelp,							"--help									= print help" },
+	ur::cl_var_ref{"--relay-addr", cl::relayAddr,						"--relay-addr <value>					= address of relay server, 127.0.0.1 by default" },
+	ur::cl_var_ref{"--relay-port", cl::relayPort,						"--relay-port <value>					= relay server port, 6060 by default" },
+	ur::cl_var_ref{"--ipv6", cl::useIpv6,								"--ipv6 0|1								= use ipv6" },
+	ur::cl_var_ref{"--threads", cl::threads,							"--threads <value>						= event loop threads, pairs are split between them. 2 by default" },
+	ur::cl_var_ref{"--pairs", cl::pairs,								"--pairs <value>						= simulated peer pairs, each peer takes a socket. 64 by default" },
+	ur::cl_var_ref{"--rate", cl::rate,									"--rate <value>							= datagrams per second sent in total regardless of responses, 10000 by default" },
+	ur::cl_var_ref{"--sizes", cl::sizes,								"--sizes <value> <value> ...			= datagram sizes picked with equal probability, 64 512 1200 by default" },
+	ur::cl_var_ref{"--burst", cl::burst,								"--burst <value>						= datagrams sent back to back by one peer with single send call, 4 by default" },
+	ur::cl_var_ref{"--duration", cl::duration,							"--duration <value>						= seconds of measured sending, 10 by default" },
+	ur::cl_var_ref{"--establish-timeout", cl::establishTimeout,		"--establish-timeout <value>			= seconds to wait for relay to answer every pair, 30 by default" },
+	ur::cl_var_ref{"--handshake-rate", cl::handshakeRate,				"--handshake-rate <value>				= handshakes per second in total while establishing, 2000 by default" },
+	ur::cl_var_ref{"--bind-addr", cl::bindAddr,						"--bind-addr <value>					= local address peers bind to, any by default" },
+	ur::cl_var_ref{"--bind-spread", cl::bindSpread,					"--bind-spread <value>					= spread peers over that many consecutive ipv4 addresses starting from --bind-addr, 1 by default" },
+	ur::cl_var_ref{"--drain", cl::drain,								"--drain <value>						= time in ms to wait for datagrams in flight after sending stopped, 1000 by default" },
+	ur::cl_var_ref{"--relay-ports", cl::relayPorts,					"--relay-ports							= ask relay for dedicated port of each pair and send data there, relay needs --relay-ports range" },
+	ur::cl_var_ref{"--report", cl::report,								"--report <path>						= write machine readable report in json, - for stdout" },
 };
 
 static constexpr auto envList = std::array
@@ -48,12 +79,58 @@ static constexpr auto envList = std::array
 };
 // clang-format on
 
-static std::array<relay_client, 1024> g_clients{};
-static bool g_running{};
+static std::atomic_bool g_running{true};
 static int exit_code{};
 
 static void tester_signal_handler(int sig);
 
+// sleep up to duration, return early if interrupted
+static bool sleep_while_running(std::chrono::milliseconds duration)
+{
+	const auto until = std::chrono::steady_clock::now() + duration;
+	while (g_running && std::chrono::steady_clock::now() < until)
+		std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(100ms, until - std::chrono::steady_clock::now()));
+	return g_running;
+}
+
+static void raise_fd_limit(size_t needed)
+{
+#if UR_PLATFORM_LINUX
+	rlimit limit{};
+	if (::getrlimit(RLIMIT_NOFILE, &limit) != 0)
+		return;
+
+	if (limit.rlim_cur < limit.rlim_max)
+	{
+		limit.rlim_cur = limit.rlim_max;
+		::setrlimit(RLIMIT_NOFILE, &limit);
+	}
+
+	if (limit.rlim_cur < needed)
+		LOG(Warning, RelayTester, "Open files limit {} is below {} sockets needed", limit.rlim_cur, needed);
+#else
+	(void)needed;
+#endif
+}
+
+static bool write_report(const std::string& path, const std::string& report)
+{
+	if (path == "-")
+	{
+		std::fwrite(report.data(), 1, report.size(), stdout);
+		return true;
+	}
+
+	FILE* file = std::fopen(path.c_str(), "wb");
+	if (file == nullptr)
+	{
+		LOG(Error, RelayTester, "Failed to open {}", path);
+		return false;
+	}
+	const bool written = std::fwrite(report.data(), 1, report.size(), file) == report.size();
+	return std::fclose(file) == 0 && written;
+}
+
 int main(int argc, char* argv[], [[maybe_unused]] char* envp[])
 {
 	ur_init();
@@ -93,71 +170,149 @@ int main(int argc, char* argv[], [[maybe_unused]] char* envp[])
 		return 1;
 	}
 
-	if (cl::maxClients % 2 != 0)
+	auto bindAddr = relayAddr.isIpv6() ? ur::net::socket_address::make_ipv6(ur::net::anyIpv6(), 0) : ur::net::socket_address::make_ipv4(ur::net::anyIpv4(), 0);
+	if (!cl::bindAddr.empty())
 	{
-		++cl::maxClients;
+		bindAddr = ur::net::socket_address::from_string(cl::bindAddr);
+		if (bindAddr.isNull() || bindAddr.isIpv6() != relayAddr.isIpv6())
+		{
+			LOG(Error, RelayTester, "Invalid bind addr {}", cl::bindAddr);
+			return 1;
+		}
 	}
-	if (cl::maxClients > 1024)
+
+	cl::threads = std::clamp(cl::threads, 1, std::max(cl::pairs, 1));
+	if (cl::pairs <= 0 || cl::rate < 0 || cl::burst <= 0 || cl::sizes.empty() || cl::handshakeRate <= 0)
 	{
-		cl::maxClients = 1024;
+		LOG(Error, RelayTester, "Pairs, burst, sizes and handshake rate must be positive");
+		return 1;
 	}
 
+	raise_fd_limit(size_t(cl::pairs) * 2 + 64);
+
 	LOG(Info, RelayTester, "Using relay address: {}", relayAddr);
-	LOG(Info, RelayTester, "Starting {0} clients", cl::maxClients);
+	LOG(Info, RelayTester, "Starting {} pairs on {} threads", cl::pairs, cl::threads);
+
+	std::vector<uint32_t> sizes{};
+	for (const int32_t size : cl::sizes)
+		sizes.push_back(static_cast<uint32_t>(std::max(size, 0)));
 
-	for (int32_t i = 0; i < cl::maxClients; i += 2)
+	std::vector<std::unique_ptr<load_worker>> workers{};
+	for (int32_t i = 0; i < cl::threads; ++i)
 	{
-		relay_client_params params{};
-		params.m_guid = guid::newGuid();
-		params.m_sendIntervalMs = cl::sendIntervalMs;
+		load_params params{};
 		params.m_relayAddr = relayAddr;
-
-		auto clientA = &g_clients[i];
-		auto clientB = &g_clients[i + 1];
-
-		clientA->init(params, ur::relay_helpers::makeSecret(env::secretKey));
-		clientB->init(params, ur::relay_helpers::makeSecret(env::secretKey));
-
-		std::thread(std::bind(&relay_client::run, clientA)).detach();
-		std::thread(std::bind(&relay_client::run, clientB)).detach();
+		params.m_bindAddr = bindAddr;
+		params.m_bindSpread = static_cast<uint32_t>(std::max(cl::bindSpread, 1));
+		params.m_pairs = static_cast<uint32_t>(cl::pairs / cl::threads + (i < cl::pairs % cl::threads ? 1 : 0));
+		params.m_rate = double(cl::rate) * params.m_pairs / cl::pairs;
+		params.m_handshakeRate = double(cl::handshakeRate) * params.m_pairs / cl::pairs;
+		params.m_burst = static_cast<uint32_t>(cl::burst);
+		params.m_sizes = sizes;
+		params.m_secretKey = ur::relay_helpers::makeSecret(env::secretKey);
+		params.m_relayPorts = cl::relayPorts;
+
+		auto worker = std::make_unique<load_worker>();
+		if (!worker->init(std::move(params)))
+			return 1;
+		workers.push_back(std::move(worker));
 	}
 
-	const auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads{};
+	for (auto& worker : workers)
+		threads.emplace_back(&load_worker::run, worker.get());
 
-	LOG(Info, RelayTester, "Clients started. Probing relay for {0} seconds", cl::shutdownAfter);
-
-	g_running = true;
-	while (g_running)
+	const auto totalEstablished = [&workers]()
 	{
-		std::this_thread::sleep_for(1s);
+		uint32_t established{};
+		for (const auto& worker : workers)
+			established += worker->getEstablished();
+		return established;
+	};
 
-		const auto now = std::chrono::steady_clock::now();
+	const auto setPhase = [&workers](load_phase phase)
+	{
+		for (auto& worker : workers)
+			worker->setPhase(phase);
+	};
 
-		if (cl::shutdownAfter > 0 && std::chrono::duration_cast<std::chrono::seconds>(now - start).count() > cl::shutdownAfter)
-		{
-			LOG(Info, RelayTester, "Times up. Stopping clients.");
+	// wait for relay to answer every pair, pairs left unanswered are left out of measurement
+	const auto establishStart = std::chrono::steady_clock::now();
+	while (g_running && totalEstablished() < uint32_t(cl::pairs) && std::chrono::steady_clock::now() - establishStart < std::chrono::seconds(cl::establishTimeout))
+	{
+		sleep_while_running(1s);
+		LOG(Info, RelayTester, "Established {} of {} pairs", totalEstablished(), cl::pairs);
+	}
 
-			for (int32_t i = 0; i < cl::maxClients; ++i)
-				g_clients[i].stopSending();
+	const uint32_t established = totalEstablished();
+	if (established == 0)
+	{
+		LOG(Error, RelayTester, "Relay didn't establish any pair");
+		g_running = false;
+	}
 
-			std::this_thread::sleep_for(2s);
+	if (g_running)
+	{
+		LOG(Info, RelayTester, "Sending {} datagrams per second for {} seconds over {} pairs", cl::rate, cl::duration, established);
+		setPhase(load_phase::Measure);
+		sleep_while_running(std::chrono::seconds(cl::duration));
 
-			for (int32_t i = 0; i < cl::maxClients; ++i)
-				g_clients[i].stop();
+		setPhase(load_phase::Drain);
+		sleep_while_running(cl::drain);
+	}
 
-			g_running = false;
+	setPhase(load_phase::Stop);
+	for (auto& thread : threads)
+		thread.join();
 
-			std::this_thread::sleep_for(2s);
+	load_stats total{};
+	for (const auto& worker : workers)
+	{
+		const load_stats& stats = worker->getStats();
+		total.m_latency.merge(stats.m_latency);
+		total.m_serviceLatency.merge(stats.m_serviceLatency);
+		total.m_sent += stats.m_sent;
+		total.m_bytesSent += stats.m_bytesSent;
+		total.m_sendFailures += stats.m_sendFailures;
+		total.m_received += stats.m_received;
+		total.m_lateBursts += stats.m_lateBursts;
+		total.m_measured = std::max(total.m_measured, stats.m_measured);
+	}
 
-			for (int32_t i = 0; i < cl::maxClients; ++i)
-			{
-				const auto& client = g_clients[i];
+	const double seconds = std::chrono::duration<double>(total.m_measured).count();
+	const double ppsSent = seconds > 0 ? double(total.m_sent) / seconds : 0.;
+	const double ppsReceived = seconds > 0 ? double(total.m_received) / seconds : 0.;
+	const double lossPercent = total.m_sent ? (1. - double(total.m_received) / double(total.m_sent)) * 100. : 0.;
+	const auto percentileUs = [](const ur::latency_histogram& latency, double percent)
+	{
+		return double(latency.percentile(percent)) / 1000.;
+	};
 
-				const double successRate = client.getPacketsSent() != 0 ? static_cast<double>(client.getPacketsRecv()) / static_cast<double>(client.getPacketsSent()) : 0.;
+	LOG(Info, RelayTester, "Sent/Recv packets: {} / {} ({:.3f} % loss). Achieved {:.0f} pps of {} targeted, {} bursts late, {} send failures",
+		total.m_sent, total.m_received, lossPercent, ppsSent, cl::rate, total.m_lateBursts, total.m_sendFailures);
+	LOG(Info, RelayTester, "Latency p50/p99/p99.9/max: {:.1f} / {:.1f} / {:.1f} / {:.1f} us",
+		percentileUs(total.m_latency, 50.), percentileUs(total.m_latency, 99.), percentileUs(total.m_latency, 99.9), double(total.m_latency.max()) / 1000.);
+	LOG(Info, RelayTester, "From actual send p50/p99/p99.9/max: {:.1f} / {:.1f} / {:.1f} / {:.1f} us",
+		percentileUs(total.m_serviceLatency, 50.), percentileUs(total.m_serviceLatency, 99.), percentileUs(total.m_serviceLatency, 99.9), double(total.m_serviceLatency.max()) / 1000.);
 
-				LOG(Info, RelayTester, "\"{4}\". Median/Average latency: {0} / {1} ms. Sent/Recv packets: {2} / {3} ({5:.1f} %)", client.getMedianLatency(), client.getAverageLatency(), client.getPacketsSent(), client.getPacketsRecv(), client.getGuid().toString(), successRate * 100.);
-			}
-		}
+	if (!cl::report.empty())
+	{
+		std::string report = std::format("{{\n\t\"version\": \"{}.{}.{}\",\n\t\"timestamp\": {},\n",
+			ur::getVersionMajor(), ur::getVersionMinor(), ur::getVersionPatch(),
+			std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+		report += std::format("\t\"threads\": {},\n\t\"pairs\": {},\n\t\"established_pairs\": {},\n\t\"duration_s\": {:.3f},\n\t\"rate_target\": {},\n",
+			cl::threads, cl::pairs, established, seconds, cl::rate);
+		report += std::format("\t\"sent\": {},\n\t\"received\": {},\n\t\"send_failures\": {},\n\t\"late_bursts\": {},\n\t\"bytes_sent\": {},\n",
+			total.m_sent, total.m_received, total.m_sendFailures, total.m_lateBursts, total.m_bytesSent);
+		report += std::format("\t\"pps_sent\": {:.1f},\n\t\"pps_received\": {:.1f},\n\t\"loss_percent\": {:.4f},\n",
+			ppsSent, ppsReceived, lossPercent);
+		report += std::format("\t\"latency_ns\": {{\"p50\": {}, \"p90\": {}, \"p99\": {}, \"p99.9\": {}, \"max\": {}}},\n",
+			total.m_latency.percentile(50.), total.m_latency.percentile(90.), total.m_latency.percentile(99.), total.m_latency.percentile(99.9), total.m_latency.max());
+		report += std::format("\t\"service_latency_ns\": {{\"p50\": {}, \"p90\": {}, \"p99\": {}, \"p99.9\": {}, \"max\": {}}}\n}}\n",
+			total.m_serviceLatency.percentile(50.), total.m_serviceLatency.percentile(90.), total.m_serviceLatency.percentile(99.), total.m_serviceLatency.percentile(99.9), total.m_serviceLatency.max());
+
+		if (!write_report(cl::report, report))
+			exit_code = 1;
 	}
 
 	ur_shutdown();
@@ -173,8 +328,7 @@ void tester_signal_handler(int sig)
 	{
 	case SIGINT:
 	case SIGTERM:
-		for (auto& client : g_clients)
-			client.stop();
+		g_running = false;
 		break;
 	case SIGILL:
 	case SIGFPE:
@@ -187,4 +341,4 @@ void tester_signal_handler(int sig)
 	}
 
 	exit_code = 128 + sig;
-}
\ No newline at end of file
+}